@@ -0,0 +1,74 @@
+//===--- DesignUnitConsumer.h - Receive design units as they are parsed ---===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// \brief Defines the DesignUnitConsumer interface, which Sema hands each
+/// design unit to as soon as the parser finishes it.
+///
+//===----------------------------------------------------------------------===//
+
+#ifndef VLANG_AST_DESIGNUNITCONSUMER_H
+#define VLANG_AST_DESIGNUNITCONSUMER_H
+
+#include "vlang/AST/Instance.h"
+#include "vlang/AST/Parameter.h"
+#include "vlang/Basic/LLVM.h"
+#include "vlang/Basic/SourceLocation.h"
+#include "vlang/Basic/TokenKinds.h"
+#include "llvm/ADT/ArrayRef.h"
+
+namespace vlang {
+
+class IdentifierInfo;
+
+/// DesignUnit - The parse results of one module, interface or program.
+struct DesignUnit {
+  /// Keyword - kw_module, kw_macromodule, kw_interface or kw_program.
+  tok::TokenKind Keyword;
+
+  /// Name - The name of the unit, null if it was missing.
+  IdentifierInfo *Name;
+
+  /// Loc, EndLoc - The design unit keyword and its end keyword.  EndLoc is
+  /// invalid if the end keyword was missing.
+  SourceLocation Loc;
+  SourceLocation EndLoc;
+
+  /// Parameters - The parameters and localparams of the unit, in source
+  /// order.  Their values can be computed with a ConstantEvaluator until
+  /// HandleDesignUnit returns.
+  ArrayRef<ParameterDecl> Parameters;
+
+  /// Instances - The instances of the unit, in source order.
+  ArrayRef<InstanceRecord> Instances;
+
+  /// PortConnections - The port connections the instances refer to.
+  ArrayRef<PortConnection> PortConnections;
+
+  ArrayRef<PortConnection> getPortConnections(const InstanceRecord &I) const {
+    return PortConnections.slice(I.FirstConnection, I.NumConnections);
+  }
+};
+
+/// DesignUnitConsumer - Receives each design unit as soon as it has been
+/// parsed.  Everything Sema built for a unit, its expressions, parameters
+/// and instance records included, is released when HandleDesignUnit
+/// returns, so the memory of a parse is bounded by its largest design unit.
+/// A consumer must copy whatever it wants to keep.
+class DesignUnitConsumer {
+public:
+  virtual ~DesignUnitConsumer();
+
+  /// HandleDesignUnit - Called once for every design unit, in source order.
+  virtual void HandleDesignUnit(const DesignUnit &Unit) = 0;
+};
+
+} // end namespace vlang
+
+#endif
@@ -0,0 +1,419 @@
+//===--- Expr.h - Classes for representing expressions ----------*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// \brief Defines the Expr interface and subclasses.
+///
+/// Expressions are allocated from the BumpPtrAllocator of Sema and are never
+/// destroyed individually; they go away with the allocator.  Every node
+/// starts with the same 8 byte header (class, two bytes of subclass data and
+/// the location), children are plain pointers into the same arena, and
+/// variable length operand lists are stored directly after the node, so a
+/// binary operator takes 24 bytes and nothing needs a destructor.
+///
+//===----------------------------------------------------------------------===//
+
+#ifndef VLANG_AST_EXPR_H
+#define VLANG_AST_EXPR_H
+
+#include "vlang/Basic/LLVM.h"
+#include "vlang/Basic/SourceLocation.h"
+#include "vlang/Basic/TokenKinds.h"
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/AlignOf.h"
+#include "llvm/Support/Allocator.h"
+#include "llvm/Support/Casting.h"
+#include "llvm/Support/DataTypes.h"
+#include "llvm/Support/MathExtras.h"
+#include <algorithm>
+
+namespace vlang {
+
+class IdentifierInfo;
+
+/// Expr - The base of all expressions.
+class Expr {
+public:
+  enum ExprClass {
+    NumberLiteralClass,
+    StringLiteralClass,
+    NameExprClass,
+    MemberExprClass,
+    SelectExprClass,
+    UnaryOperatorClass,
+    BinaryOperatorClass,
+    ConditionalOperatorClass,
+    ConcatenationClass,
+    MultipleConcatenationClass,
+    CallExprClass,
+    MinTypMaxExprClass
+  };
+
+private:
+  uint8_t Class;
+
+protected:
+  /// SubclassFlags, SubclassData - Small fields the subclasses pack into the
+  /// header, such as the operator kind of an operator or the radix of a
+  /// number.
+  uint8_t SubclassFlags;
+  uint16_t SubclassData;
+
+  SourceLocation Loc;
+
+  Expr(ExprClass C, SourceLocation L)
+    : Class(C), SubclassFlags(0), SubclassData(0), Loc(L) {}
+
+public:
+  ExprClass getExprClass() const { return (ExprClass)Class; }
+
+  /// getExprLoc - The location that identifies the expression: the operator
+  /// of an operator, the '[' of a select, the '(' of a call, the '{' of a
+  /// concatenation, and the first token of everything else.
+  SourceLocation getExprLoc() const { return Loc; }
+
+  // Expressions are only ever created in an arena.
+  void *operator new(size_t Bytes, llvm::BumpPtrAllocator &C,
+                     unsigned Alignment = 8) throw() {
+    return C.Allocate(Bytes, Alignment);
+  }
+  void operator delete(void *, llvm::BumpPtrAllocator &, unsigned) throw() {}
+
+  // Nodes with trailing operands are constructed in memory obtained from the
+  // arena by the caller.
+  void *operator new(size_t, void *Mem) throw() { return Mem; }
+  void operator delete(void *, void *) throw() {}
+
+private:
+  void *operator new(size_t) LLVM_DELETED_FUNCTION;
+  void operator delete(void *) LLVM_DELETED_FUNCTION;
+};
+
+/// NumberLiteral - An integral or real number.  The digits are kept as
+/// written, including underscores and x/z digits.  Integral numbers are also
+/// decoded into two planes of (getWidth() + 63) / 64 words each, least
+/// significant word first: a bit is X if it is set in both planes, Z if it
+/// is only set in the unknown plane, and 0 or 1 otherwise.
+class NumberLiteral : public Expr {
+  const char *Digits;
+  const uint64_t *Words;
+  uint32_t NumDigits;
+  uint32_t Width;
+
+public:
+  enum {
+    Signed   = 0x1,   ///< Written with an 's' base.
+    Sized    = 0x2,   ///< Written with an explicit size.
+    Based    = 0x4,   ///< Written with a base.
+    Unbased  = 0x8,   ///< An unbased unsized literal: '0, '1, 'x or 'z.
+    Decoded  = 0x10,  ///< The value planes are set.
+    HasXZ    = 0x20   ///< Some bit of the value is X or Z.
+  };
+
+  NumberLiteral(SourceLocation L, StringRef D, unsigned W, unsigned Radix,
+                unsigned Flags)
+    : Expr(NumberLiteralClass, L), Digits(D.data()), Words(0),
+      NumDigits(D.size()), Width(W) {
+    SubclassFlags = Flags;
+    SubclassData = Radix;
+  }
+
+  StringRef getDigits() const { return StringRef(Digits, NumDigits); }
+  unsigned getRadix() const { return SubclassData; }
+
+  /// getWidth - The width of the value: the explicit size of a sized
+  /// number, 1 for an unbased unsized literal, and at least 32 for other
+  /// unsized numbers.  A number that could not be decoded keeps its
+  /// explicit size, or 0.
+  unsigned getWidth() const { return Width; }
+
+  bool isSigned() const { return SubclassFlags & Signed; }
+  bool isSized() const { return SubclassFlags & Sized; }
+  bool isBased() const { return SubclassFlags & Based; }
+  bool isUnbasedUnsized() const { return SubclassFlags & Unbased; }
+
+  /// isDecoded - Whether the value planes are available.  They are not for
+  /// real numbers and numbers with invalid digits.
+  bool isDecoded() const { return SubclassFlags & Decoded; }
+  bool hasUnknownBits() const { return SubclassFlags & HasXZ; }
+
+  unsigned getNumWords() const { return (Width + 63) / 64; }
+  ArrayRef<uint64_t> getValueWords() const {
+    return ArrayRef<uint64_t>(Words, isDecoded() ? getNumWords() : 0);
+  }
+  ArrayRef<uint64_t> getUnknownWords() const {
+    return ArrayRef<uint64_t>(Words + getNumWords(),
+                              isDecoded() ? getNumWords() : 0);
+  }
+
+  /// setValue - Set the decoded value: \p W words of value bits followed by
+  /// as many unknown bits, in the same arena as the number.
+  void setValue(unsigned W, const uint64_t *V, bool XZ) {
+    Width = W;
+    Words = V;
+    SubclassFlags |= Decoded | (XZ ? HasXZ : 0);
+  }
+
+  static bool classof(const Expr *E) {
+    return E->getExprClass() == NumberLiteralClass;
+  }
+};
+
+/// StringLiteral - A string literal, without the quotes and with escapes
+/// left as written.
+class StringLiteral : public Expr {
+  const char *Text;
+  uint32_t Length;
+
+public:
+  StringLiteral(SourceLocation L, StringRef T)
+    : Expr(StringLiteralClass, L), Text(T.data()), Length(T.size()) {}
+
+  StringRef getString() const { return StringRef(Text, Length); }
+
+  static bool classof(const Expr *E) {
+    return E->getExprClass() == StringLiteralClass;
+  }
+};
+
+/// NameExpr - A reference to a simple identifier.  Hierarchical names are
+/// built from a NameExpr and MemberExprs.
+class NameExpr : public Expr {
+  IdentifierInfo *Name;
+
+public:
+  NameExpr(SourceLocation L, IdentifierInfo *II)
+    : Expr(NameExprClass, L), Name(II) {}
+
+  IdentifierInfo *getName() const { return Name; }
+
+  static bool classof(const Expr *E) {
+    return E->getExprClass() == NameExprClass;
+  }
+};
+
+/// MemberExpr - One '.' step of a hierarchical name or member access.
+class MemberExpr : public Expr {
+  Expr *Base;
+  IdentifierInfo *Member;
+
+public:
+  MemberExpr(Expr *B, SourceLocation MemberLoc, IdentifierInfo *II)
+    : Expr(MemberExprClass, MemberLoc), Base(B), Member(II) {}
+
+  Expr *getBase() const { return Base; }
+  IdentifierInfo *getMember() const { return Member; }
+
+  static bool classof(const Expr *E) {
+    return E->getExprClass() == MemberExprClass;
+  }
+};
+
+/// SelectExpr - A bit select, part select or indexed part select.
+class SelectExpr : public Expr {
+  Expr *Base;
+  Expr *Index;
+  Expr *Width;
+
+public:
+  enum SelectKind {
+    BitSelect,      ///< base[index]
+    PartSelect,     ///< base[msb:lsb]
+    IndexedUp,      ///< base[index+:width]
+    IndexedDown     ///< base[index-:width]
+  };
+
+  /// \p W is the lsb of a part select, the width of an indexed part select
+  /// and null for a bit select.
+  SelectExpr(Expr *B, SourceLocation LBracketLoc, SelectKind K, Expr *I,
+             Expr *W)
+    : Expr(SelectExprClass, LBracketLoc), Base(B), Index(I), Width(W) {
+    SubclassData = K;
+  }
+
+  SelectKind getSelectKind() const { return (SelectKind)SubclassData; }
+  Expr *getBase() const { return Base; }
+  Expr *getIndex() const { return Index; }
+  Expr *getWidth() const { return Width; }
+
+  Expr *getMSB() const { return Index; }
+  Expr *getLSB() const { return Width; }
+
+  static bool classof(const Expr *E) {
+    return E->getExprClass() == SelectExprClass;
+  }
+};
+
+/// UnaryOperator - A unary or reduction operator.
+class UnaryOperator : public Expr {
+  Expr *Operand;
+
+public:
+  UnaryOperator(SourceLocation OpLoc, tok::TokenKind Op, Expr *E)
+    : Expr(UnaryOperatorClass, OpLoc), Operand(E) {
+    SubclassData = Op;
+  }
+
+  tok::TokenKind getOpcode() const { return (tok::TokenKind)SubclassData; }
+  Expr *getSubExpr() const { return Operand; }
+
+  static bool classof(const Expr *E) {
+    return E->getExprClass() == UnaryOperatorClass;
+  }
+};
+
+/// BinaryOperator - A binary operator, identified by the token that spells
+/// it.
+class BinaryOperator : public Expr {
+  Expr *LHS;
+  Expr *RHS;
+
+public:
+  BinaryOperator(SourceLocation OpLoc, tok::TokenKind Op, Expr *L, Expr *R)
+    : Expr(BinaryOperatorClass, OpLoc), LHS(L), RHS(R) {
+    SubclassData = Op;
+  }
+
+  tok::TokenKind getOpcode() const { return (tok::TokenKind)SubclassData; }
+  Expr *getLHS() const { return LHS; }
+  Expr *getRHS() const { return RHS; }
+
+  static bool classof(const Expr *E) {
+    return E->getExprClass() == BinaryOperatorClass;
+  }
+};
+
+/// ConditionalOperator - cond ? lhs : rhs.
+class ConditionalOperator : public Expr {
+  Expr *Cond;
+  Expr *LHS;
+  Expr *RHS;
+
+public:
+  ConditionalOperator(SourceLocation QuestionLoc, Expr *C, Expr *L, Expr *R)
+    : Expr(ConditionalOperatorClass, QuestionLoc), Cond(C), LHS(L), RHS(R) {}
+
+  Expr *getCond() const { return Cond; }
+  Expr *getTrueExpr() const { return LHS; }
+  Expr *getFalseExpr() const { return RHS; }
+
+  static bool classof(const Expr *E) {
+    return E->getExprClass() == ConditionalOperatorClass;
+  }
+};
+
+/// Concatenation - { expr, expr, ... }.  The operands follow the node.
+class Concatenation : public Expr {
+  uint32_t NumExprs;
+
+  /// getTrailingOffset - The operands start at the first pointer aligned
+  /// offset after the node.
+  static size_t getTrailingOffset() {
+    return llvm::RoundUpToAlignment(sizeof(Concatenation),
+                                    llvm::alignOf<Expr *>());
+  }
+
+  Expr **getTrailingExprs() const {
+    char *Mem = reinterpret_cast<char *>(const_cast<Concatenation *>(this));
+    return reinterpret_cast<Expr **>(Mem + getTrailingOffset());
+  }
+
+public:
+  Concatenation(SourceLocation LBraceLoc, ArrayRef<Expr *> Exprs)
+    : Expr(ConcatenationClass, LBraceLoc), NumExprs(Exprs.size()) {
+    std::copy(Exprs.begin(), Exprs.end(), getTrailingExprs());
+  }
+
+  /// totalSizeToAlloc - The size to allocate for \p NumExprs operands.
+  static size_t totalSizeToAlloc(unsigned NumExprs) {
+    return getTrailingOffset() + NumExprs * sizeof(Expr *);
+  }
+
+  ArrayRef<Expr *> getExprs() const {
+    return ArrayRef<Expr *>(getTrailingExprs(), NumExprs);
+  }
+  unsigned getNumExprs() const { return NumExprs; }
+
+  static bool classof(const Expr *E) {
+    return E->getExprClass() == ConcatenationClass;
+  }
+};
+
+/// MultipleConcatenation - { count { expr, ... } }.
+class MultipleConcatenation : public Expr {
+  Expr *Count;
+  Concatenation *Inner;
+
+public:
+  MultipleConcatenation(SourceLocation LBraceLoc, Expr *C, Concatenation *I)
+    : Expr(MultipleConcatenationClass, LBraceLoc), Count(C), Inner(I) {}
+
+  Expr *getCount() const { return Count; }
+  Concatenation *getConcatenation() const { return Inner; }
+
+  static bool classof(const Expr *E) {
+    return E->getExprClass() == MultipleConcatenationClass;
+  }
+};
+
+/// CallExpr - A function or task call.  The arguments follow the node, and
+/// omitted arguments are null.
+class CallExpr : public Expr {
+  Expr *Callee;
+  uint32_t NumArgs;
+
+  Expr **getTrailingArgs() const {
+    return reinterpret_cast<Expr **>(const_cast<CallExpr *>(this) + 1);
+  }
+
+public:
+  CallExpr(Expr *Fn, SourceLocation LParenLoc, ArrayRef<Expr *> Args)
+    : Expr(CallExprClass, LParenLoc), Callee(Fn), NumArgs(Args.size()) {
+    std::copy(Args.begin(), Args.end(), getTrailingArgs());
+  }
+
+  /// totalSizeToAlloc - The size to allocate for \p NumArgs arguments.
+  static size_t totalSizeToAlloc(unsigned NumArgs) {
+    return sizeof(CallExpr) + NumArgs * sizeof(Expr *);
+  }
+
+  Expr *getCallee() const { return Callee; }
+  ArrayRef<Expr *> getArgs() const {
+    return ArrayRef<Expr *>(getTrailingArgs(), NumArgs);
+  }
+  unsigned getNumArgs() const { return NumArgs; }
+
+  static bool classof(const Expr *E) {
+    return E->getExprClass() == CallExprClass;
+  }
+};
+
+/// MinTypMaxExpr - min : typ : max.
+class MinTypMaxExpr : public Expr {
+  Expr *Min;
+  Expr *Typ;
+  Expr *Max;
+
+public:
+  MinTypMaxExpr(Expr *Mn, Expr *T, Expr *Mx)
+    : Expr(MinTypMaxExprClass, Mn->getExprLoc()), Min(Mn), Typ(T), Max(Mx) {}
+
+  Expr *getMin() const { return Min; }
+  Expr *getTyp() const { return Typ; }
+  Expr *getMax() const { return Max; }
+
+  static bool classof(const Expr *E) {
+    return E->getExprClass() == MinTypMaxExprClass;
+  }
+};
+
+} // end namespace vlang
+
+#endif
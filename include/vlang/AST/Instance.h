@@ -0,0 +1,87 @@
+//===--- Instance.h - Module, primitive and gate instances ------*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// \brief Defines the flat records that describe instances and their port
+/// connections.
+///
+/// Netlists consist almost entirely of instances whose ports are connected
+/// to nets or to constant bit selects of nets.  Those connections are kept
+/// directly in the record instead of as expressions, and the records of all
+/// instances are stored back to back in two arrays owned by Sema.
+///
+//===----------------------------------------------------------------------===//
+
+#ifndef VLANG_AST_INSTANCE_H
+#define VLANG_AST_INSTANCE_H
+
+#include "vlang/Basic/SourceLocation.h"
+#include "vlang/Basic/TokenKinds.h"
+#include "llvm/Support/DataTypes.h"
+
+namespace vlang {
+
+class Expr;
+class IdentifierInfo;
+
+/// PortConnection - One named or ordered port connection of a module or
+/// primitive instance, or one terminal of a gate.
+struct PortConnection {
+  enum ConnectionKind {
+    Unconnected,    ///< .port() or an empty ordered connection.
+    Net,            ///< A net: Net is set.
+    NetBit,         ///< A constant bit select of a net: Net and Bit are set.
+    Expression      ///< Anything else: Actual is set if it could be built.
+  };
+
+  /// Port - The port of a named connection, null for ordered connections.
+  IdentifierInfo *Port;
+
+  union {
+    IdentifierInfo *Net;
+    Expr *Actual;
+  };
+
+  SourceLocation PortLoc;
+  SourceLocation Loc;
+  uint32_t Bit;
+  uint8_t Kind;
+
+  ConnectionKind getKind() const { return (ConnectionKind)Kind; }
+  bool isNamed() const { return Port != 0; }
+};
+
+/// InstanceRecord - One instance of a module, a user defined primitive or a
+/// gate.
+struct InstanceRecord {
+  /// Definition - The module or primitive instantiated, null for gates.
+  IdentifierInfo *Definition;
+
+  /// Name - The instance name, null for unnamed gates.
+  IdentifierInfo *Name;
+
+  /// Loc - The instance name, or the '(' of an unnamed gate.
+  SourceLocation Loc;
+
+  /// GateKind - The gate keyword, or tok::identifier for modules and
+  /// primitives.
+  uint16_t GateKind;
+
+  /// FirstConnection, NumConnections - The port connections of the instance
+  /// in Sema::PortConnections.
+  uint32_t FirstConnection;
+  uint32_t NumConnections;
+
+  tok::TokenKind getGateKind() const { return (tok::TokenKind)GateKind; }
+  bool isGate() const { return GateKind != tok::identifier; }
+};
+
+} // end namespace vlang
+
+#endif
@@ -0,0 +1,50 @@
+//===--- Parameter.h - Parameter and localparam declarations ----*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// \brief Defines ParameterDecl, the record of one parameter or localparam
+/// of a design unit.
+///
+//===----------------------------------------------------------------------===//
+
+#ifndef VLANG_AST_PARAMETER_H
+#define VLANG_AST_PARAMETER_H
+
+#include "vlang/Basic/SourceLocation.h"
+#include "llvm/Support/DataTypes.h"
+
+namespace vlang {
+
+class Expr;
+class IdentifierInfo;
+
+/// ParameterDecl - One parameter, localparam or specparam, from the
+/// parameter port list or the body of a design unit.
+struct ParameterDecl {
+  enum {
+    Local = 0x1,    ///< A localparam, or a parameter that cannot be overridden.
+    Port  = 0x2     ///< Declared in the parameter port list.
+  };
+
+  IdentifierInfo *Name;
+
+  /// Init - The default value, null if there is none or it could not be
+  /// built.
+  Expr *Init;
+
+  SourceLocation Loc;
+  uint8_t Flags;
+
+  bool isLocal() const { return Flags & Local; }
+  bool isPort() const { return Flags & Port; }
+};
+
+} // end namespace vlang
+
+#endif
@@ -0,0 +1,63 @@
+//===--- vlang/Basic/CharScan.h - Vectorized character scanning -*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// \brief Scanners that skip runs of one character class at a time, for the
+/// lexer's inner loops.  On x86 an SSE2 or AVX2 implementation is picked at
+/// runtime; everywhere else, and on older CPUs, a scalar loop is used.
+///
+/// Every scanner reads at most up to \p End, and relies on the character at
+/// \p End ending the run.  The NUL terminator of a MemoryBuffer does.
+///
+/// The digit decoders of based literals live here too; they classify
+/// characters the same way and use the same dispatch, with SSSE3 for the
+/// byte shuffles.
+///
+//===----------------------------------------------------------------------===//
+
+#ifndef VLANG_BASIC_CHARSCAN_H
+#define VLANG_BASIC_CHARSCAN_H
+
+#include "vlang/Basic/LLVM.h"
+#include "llvm/Support/DataTypes.h"
+
+namespace vlang {
+namespace charscan {
+
+/// \brief Return the first character at or after \p Ptr that is not an
+/// identifier body character, as defined by isIdentifierBody().
+const char *skipIdentifierBody(const char *Ptr, const char *End);
+
+/// \brief Return the first character at or after \p Ptr that is not
+/// horizontal whitespace, as defined by isHorizontalWhitespace().
+const char *skipHorizontalWhitespace(const char *Ptr, const char *End);
+
+/// \brief Return the first '\\n', '\\r' or '\\0' at or after \p Ptr.  This is
+/// the body of a line comment, up to where an escaped newline, the end of the
+/// line or the end of the buffer has to be checked for.
+const char *findLineCommentEnd(const char *Ptr, const char *End);
+
+/// \brief Decode 16 hexadecimal digits, most significant first, into the
+/// value and unknown bit planes of a 64-bit word.  x and X set both bits of
+/// a digit, z, Z and ? set only the unknown bit.  Returns false, without
+/// touching \p Value or \p Unknown, if any character is not a digit.
+bool decodeHexWord(const char *Digits, uint64_t &Value, uint64_t &Unknown);
+
+/// \brief Decode 64 binary digits, most significant first, into the value
+/// and unknown bit planes of a 64-bit word, like decodeHexWord().
+bool decodeBinaryWord(const char *Digits, uint64_t &Value, uint64_t &Unknown);
+
+/// \brief The name of the implementation selected for this CPU: "avx2",
+/// "sse2" or "scalar".
+const char *getImplementationName();
+
+} // end namespace charscan
+} // end namespace vlang
+
+#endif
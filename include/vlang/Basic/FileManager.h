@@ -24,6 +24,7 @@
 #include "llvm/ADT/StringMap.h"
 #include "llvm/ADT/StringRef.h"
 #include "llvm/Support/Allocator.h"
+#include "llvm/Support/Mutex.h"
 // FIXME: Enhance libsystem to support inode and other fields in stat.
 #include <sys/types.h>
 
@@ -117,9 +118,16 @@ public:
 /// on "inode", so that a file with two names (e.g. symlinked) will be treated
 /// as a single file.
 ///
+/// A single FileManager may be shared by several compilations running on
+/// different threads; all lookups are serialized through an internal lock.
+///
 class FileManager : public RefCountedBase<FileManager> {
   FileSystemOptions FileSystemOpts;
 
+  /// \brief Serializes access to the caches below.  Recursive, since lookups
+  /// of files also look up their directories.
+  mutable llvm::sys::Mutex Lock;
+
   class UniqueDirContainer;
   class UniqueFileContainer;
 
@@ -159,6 +167,18 @@ class FileManager : public RefCountedBase<FileManager> {
   /// \brief Storage for canonical names that we have computed.
   llvm::BumpPtrAllocator CanonicalNameStorage;
 
+  /// \brief File contents handed out by getSharedBufferForFile, owned by the
+  /// FileManager.  One buffer is kept per FileEntry.
+  llvm::DenseMap<const FileEntry *, llvm::MemoryBuffer *> SharedBuffers;
+
+  /// \brief Shared buffers whose FileEntry was invalidated.  Clients may
+  /// still point into them, so they are only freed with the FileManager.
+  SmallVector<llvm::MemoryBuffer *, 4> StaleSharedBuffers;
+
+  /// \brief Whether SourceManagers should take file contents from
+  /// getSharedBufferForFile instead of reading their own copy.
+  bool ShareFileBuffers;
+
   /// \brief Each FileEntry we create is assigned a unique ID #.
   ///
   unsigned NextFileUID;
@@ -166,6 +186,7 @@ class FileManager : public RefCountedBase<FileManager> {
   // Statistics.
   unsigned NumDirLookups, NumFileLookups;
   unsigned NumDirCacheMisses, NumFileCacheMisses;
+  unsigned NumSharedBufferHits;
 
   // Caching.
   OwningPtr<FileSystemStatCache> StatCache;
@@ -240,6 +261,21 @@ public:
   llvm::MemoryBuffer *getBufferForFile(StringRef Filename,
                                        std::string *ErrorStr = 0);
 
+  /// \brief Return the contents of \p Entry, reading the file only the first
+  /// time it is requested.
+  ///
+  /// The buffer is owned by the FileManager and lives as long as it does, so
+  /// every SourceManager using this FileManager sees the same copy.  The file
+  /// is read without holding the lock; threads that read it concurrently all
+  /// get the first copy stored.  Returns null if the file could not be read.
+  const llvm::MemoryBuffer *getSharedBufferForFile(const FileEntry *Entry,
+                                                   std::string *ErrorStr = 0);
+
+  /// \brief Make SourceManagers built on this FileManager use
+  /// getSharedBufferForFile for file contents.
+  void setShareFileBuffers(bool Share = true) { ShareFileBuffers = Share; }
+  bool sharesFileBuffers() const { return ShareFileBuffers; }
+
   /// \brief Get the 'stat' information for the given \p Path.
   ///
   /// If the path is relative, it will be resolved against the WorkingDir of the
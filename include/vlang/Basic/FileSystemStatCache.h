@@ -17,6 +17,7 @@
 
 #include "vlang/Basic/LLVM.h"
 #include "llvm/ADT/OwningPtr.h"
+#include "llvm/ADT/SmallString.h"
 #include "llvm/ADT/StringMap.h"
 #include <sys/stat.h>
 #include <sys/types.h>
@@ -101,6 +102,68 @@ public:
                                bool isFile, int *FileDescriptor);
 };
 
+/// \brief A stat cache that persists negative lookups across runs.
+///
+/// Most of the stat traffic of a compile is include-path probing for files
+/// that do not exist.  This cache remembers those misses in a file on disk,
+/// together with the inode and modification time of the directory each miss
+/// was made in.  A remembered miss is trusted as long as its directory is
+/// unchanged, which costs one stat of the directory per run instead of one
+/// per probe.  Lookups of existing paths always go to the file system, since
+/// their contents are about to be read anyway.
+class PersistentStatCache : public FileSystemStatCache {
+  /// \brief Identity of a directory the last time it was seen.
+  struct DirStamp {
+    ino_t Inode;
+    time_t ModTime;
+    bool Exists;
+    DirStamp() : Inode(0), ModTime(0), Exists(false) {}
+  };
+
+  /// \brief Directory stamps loaded from the cache file.
+  llvm::StringMap<DirStamp> LoadedDirs;
+
+  /// \brief Directory stamps observed by this process.
+  llvm::StringMap<DirStamp> CurrentDirs;
+
+  /// \brief Absolute paths known not to exist, mapped to whether the miss
+  /// was confirmed by this process (rather than just loaded).
+  llvm::StringMap<bool> Missing;
+
+  /// \brief The working directory, used to make probed paths absolute.
+  SmallString<128> WorkingDir;
+
+  unsigned NumHits, NumMisses;
+
+  /// \brief Stat \p Dir now, bypassing CurrentDirs.
+  static DirStamp statDir(StringRef Dir);
+
+  /// \brief Return the current stamp of \p Dir, stat'ing it at most once.
+  const DirStamp &getCurrentStamp(StringRef Dir);
+
+  /// \brief Whether \p Dir still matches the stamp in the cache file.
+  bool isUnchanged(StringRef Dir);
+
+public:
+  PersistentStatCache();
+
+  /// \brief Read the cache file at \p Path.  A missing or malformed file
+  /// just leaves the cache empty.
+  void load(StringRef Path);
+
+  /// \brief Write the cache back to \p Path.  The file is replaced
+  /// atomically, so concurrent compilations may share one cache file.
+  ///
+  /// \returns \c true and sets \p Error on failure.
+  bool save(StringRef Path, std::string &Error);
+
+  unsigned getNumHits() const { return NumHits; }
+  unsigned getNumMisses() const { return NumMisses; }
+
+  virtual LookupResult getStat(const char *Path, struct stat &StatBuf,
+                               bool isFile, int *FileDescriptor);
+};
+
 } // end namespace vlang
 
 #endif
@@ -16,6 +16,7 @@
 #ifndef LLVM_VLANG_BASIC_IDENTIFIERTABLE_H
 #define LLVM_VLANG_BASIC_IDENTIFIERTABLE_H
 
+#include "vlang/Basic/KeywordTable.h"
 #include "vlang/Basic/LLVM.h"
 #include "vlang/Basic/OperatorKinds.h"
 #include "vlang/Basic/TokenKinds.h"
@@ -24,6 +25,7 @@
 #include "llvm/Support/PointerLikeTypeTraits.h"
 #include <cassert>
 #include <string>
+#include <vector>
 
 namespace llvm {
 	template <typename T> struct DenseMapInfo;
@@ -263,9 +265,33 @@ namespace vlang {
 
 		IdentifierInfoLookup* ExternalLookup;
 
+		/// \brief The keyword flags enabled by the language options, see
+		/// keywords::getKeywordMask().
+		unsigned KeywordMask;
+
+		/// \brief The IdentifierInfo of each keyword, by its slot in the
+		/// keyword table, once getIdentifierOrKeyword() has seen it.
+		std::vector<IdentifierInfo*> KeywordInfos;
+
+		/// \brief Make a new IdentifierInfo for \p Entry, classifying it as a
+		/// keyword if its name is one.
+		IdentifierInfo *CreateIdentifierInfo(
+			llvm::StringMapEntry<IdentifierInfo*> &Entry) {
+			void *Mem = getAllocator().Allocate<IdentifierInfo>();
+			IdentifierInfo *II = new (Mem) IdentifierInfo();
+			Entry.setValue(II);
+
+			// Make sure getName() knows how to find the IdentifierInfo
+			// contents.
+			II->Entry = &Entry;
+
+			II->TokenID = keywords::lookup(Entry.getKey(), KeywordMask);
+			return II;
+		}
+
 	public:
-		/// \brief Create the identifier table, populating it with info about the
-		/// language keywords for the language specified by \p LangOpts.
+		/// \brief Create the identifier table.  Identifiers are classified as
+		/// keywords of the language specified by \p LangOpts when first added.
 		IdentifierTable(const LangOptions &LangOpts,
 			IdentifierInfoLookup* externalLookup = 0);
 
@@ -303,14 +329,22 @@ namespace vlang {
 			}
 
 			// Lookups failed, make a new IdentifierInfo.
-			void *Mem = getAllocator().Allocate<IdentifierInfo>();
-			II = new (Mem) IdentifierInfo();
-			Entry.setValue(II);
-
-			// Make sure getName() knows how to find the IdentifierInfo
-			// contents.
-			II->Entry = &Entry;
+			return *CreateIdentifierInfo(Entry);
+		}
 
+		/// \brief Return the identifier token info for \p Name, as get()
+		/// does.  This is the lookup the lexer uses: keywords, which make up
+		/// much of any Verilog source, are found with the keyword perfect hash
+		/// instead of a probe of the string map.
+		IdentifierInfo &getIdentifierOrKeyword(StringRef Name) {
+			tok::TokenKind Kind;
+			int Slot = keywords::lookupSlot(Name, KeywordMask, Kind);
+			if (Slot < 0)
+				return get(Name);
+
+			IdentifierInfo *&II = KeywordInfos[Slot];
+			if (!II)
+				II = &get(Name);
 			return *II;
 		}
 
@@ -333,15 +367,8 @@ namespace vlang {
 
 			IdentifierInfo *II = Entry.getValue();
 			if (!II) {
-
 				// Lookups failed, make a new IdentifierInfo.
-				void *Mem = getAllocator().Allocate<IdentifierInfo>();
-				II = new (Mem) IdentifierInfo();
-				Entry.setValue(II);
-
-				// Make sure getName() knows how to find the IdentifierInfo
-				// contents.
-				II->Entry = &Entry;
+				II = CreateIdentifierInfo(Entry);
 			}
 
 			return *II;
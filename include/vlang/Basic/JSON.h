@@ -0,0 +1,28 @@
+//===--- vlang/Basic/JSON.h - Helpers for writing JSON ----------*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// \brief Helpers for the JSON the driver writes: time traces and statistics.
+///
+//===----------------------------------------------------------------------===//
+
+#ifndef VLANG_BASIC_JSON_H
+#define VLANG_BASIC_JSON_H
+
+#include "vlang/Basic/LLVM.h"
+#include "llvm/ADT/StringRef.h"
+
+namespace vlang {
+
+/// writeJSONString - Write \p Str as a quoted JSON string.
+void writeJSONString(raw_ostream &OS, StringRef Str);
+
+} // end namespace vlang
+
+#endif
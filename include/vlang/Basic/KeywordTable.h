@@ -0,0 +1,90 @@
+//===--- KeywordTable.h - Perfect hash lookup of keywords -------*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// \brief Classifies keywords and compiler directive names with a minimal
+/// perfect hash generated from TokenKinds.def by vlang-tblgen.
+///
+/// The hash is two level: the hash of a name picks a bucket, and the bucket's
+/// displacement, chosen at build time so that no two keywords collide, picks
+/// the one table slot the name can be in.  The table has exactly one slot per
+/// keyword.  A lookup is therefore one pass over the name and a single string
+/// compare, without touching the identifier table.
+///
+//===----------------------------------------------------------------------===//
+
+#ifndef VLANG_BASIC_KEYWORDTABLE_H
+#define VLANG_BASIC_KEYWORDTABLE_H
+
+#include "vlang/Basic/LLVM.h"
+#include "vlang/Basic/TokenKinds.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/DataTypes.h"
+
+namespace vlang {
+
+class LangOptions;
+
+namespace keywords {
+
+/// \brief The first level hash of a keyword spelling (32-bit FNV-1a).
+inline uint32_t hashName(StringRef Name) {
+  uint32_t H = 2166136261u;
+  for (const char *I = Name.begin(), *E = Name.end(); I != E; ++I)
+    H = (H ^ (unsigned char)*I) * 16777619u;
+  return H;
+}
+
+/// \brief Map the hash \p H onto [0, \p N) without a division.
+inline uint32_t reduce(uint32_t H, uint32_t N) {
+  return uint32_t((uint64_t(H) * N) >> 32);
+}
+
+/// \brief The second level hash, which mixes the displacement of a bucket
+/// into the hash of the name.
+inline uint32_t hashSlot(uint32_t H, uint32_t Displacement) {
+  H ^= Displacement * 0x9E3779B9u;
+  H ^= H >> 16;
+  H *= 0x85EBCA6Bu;
+  H ^= H >> 13;
+  H *= 0xC2B2AE35u;
+  H ^= H >> 16;
+  return H;
+}
+
+/// \brief Return the KEY* flags from TokenKinds.def that are enabled by
+/// \p LangOpts.  Keywords flagged KEYALL are enabled under any mask.
+unsigned getKeywordMask(const LangOptions &LangOpts);
+
+/// \brief The number of keywords and directive names, which is also the
+/// number of slots in the table.
+unsigned getNumKeywords();
+
+/// \brief Find \p Name among the keywords, or among the directive names if
+/// it starts with a backtick.  Returns its slot, in [0, getNumKeywords()),
+/// and sets \p Kind, or returns -1 if \p Name is not a keyword or directive
+/// enabled in \p Mask.
+int lookupSlot(StringRef Name, unsigned Mask, tok::TokenKind &Kind);
+
+/// \brief Classify \p Name as a keyword, or as a directive name if it starts
+/// with a backtick.  Returns tok::identifier if \p Name is not a keyword or
+/// directive enabled in \p Mask.
+inline tok::TokenKind lookup(StringRef Name, unsigned Mask) {
+  tok::TokenKind Kind;
+  return lookupSlot(Name, Mask, Kind) < 0 ? tok::identifier : Kind;
+}
+
+/// \brief Classify the directive \p Name, spelled without the backtick.
+/// Returns tok::identifier if it is not a compiler directive.
+tok::TokenKind lookupDirective(StringRef Name);
+
+} // end namespace keywords
+} // end namespace vlang
+
+#endif
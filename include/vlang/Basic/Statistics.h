@@ -0,0 +1,51 @@
+//===--- vlang/Basic/Statistics.h - Frontend statistics ---------*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// \brief Defines StatisticsReport, which collects the counters of the
+/// frontend components of one parse so they can be printed as JSON.
+///
+//===----------------------------------------------------------------------===//
+
+#ifndef VLANG_BASIC_STATISTICS_H
+#define VLANG_BASIC_STATISTICS_H
+
+#include "vlang/Basic/LLVM.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/Support/DataTypes.h"
+
+namespace vlang {
+
+/// StatisticsReport - Named counters, grouped by the component that keeps
+/// them.  Components add theirs with a ReportStats method.
+class StatisticsReport {
+  struct Counter {
+    const char *Group;
+    const char *Name;
+    uint64_t Value;
+  };
+  SmallVector<Counter, 64> Counters;
+
+public:
+  /// add - Record \p Value as the counter \p Name of \p Group.  Both names
+  /// must be string literals.
+  void add(const char *Group, const char *Name, uint64_t Value) {
+    Counter C = { Group, Name, Value };
+    Counters.push_back(C);
+  }
+
+  /// printJSON - Print the counters as a JSON object with one member object
+  /// per group, in the order the groups were first added.  Nested lines are
+  /// indented by \p Indent more spaces than the first.
+  void printJSON(raw_ostream &OS, unsigned Indent = 0) const;
+};
+
+} // end namespace vlang
+
+#endif
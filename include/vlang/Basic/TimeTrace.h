@@ -0,0 +1,109 @@
+//===--- vlang/Basic/TimeTrace.h - Chrome trace time profiling --*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// \brief Defines TimeTraceProfiler, which records how long the phases of a
+/// parse take and writes them as Chrome trace events, for chrome://tracing
+/// or Perfetto.
+///
+/// A profiler belongs to one parse and is only used from the thread running
+/// it.  The driver gives each parse its own, and merges their events into one
+/// trace file with one track per parse.
+///
+//===----------------------------------------------------------------------===//
+
+#ifndef VLANG_BASIC_TIMETRACE_H
+#define VLANG_BASIC_TIMETRACE_H
+
+#include "vlang/Basic/LLVM.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/Compiler.h"
+#include <chrono>
+#include <string>
+#include <vector>
+
+namespace vlang {
+
+class TimeTraceProfiler {
+  TimeTraceProfiler(const TimeTraceProfiler &) LLVM_DELETED_FUNCTION;
+  void operator=(const TimeTraceProfiler &) LLVM_DELETED_FUNCTION;
+
+  typedef std::chrono::steady_clock Clock;
+
+  /// Entry - One traced region.  Name is always a string literal.
+  struct Entry {
+    const char *Name;
+    std::string Detail;
+    Clock::time_point Start;
+    Clock::duration Duration;
+    bool Open;
+    bool Dropped;
+  };
+
+  std::vector<Entry> Entries;
+  Clock::duration Granularity;
+
+public:
+  /// TimeTraceProfiler - Record regions that take at least \p GranularityUS
+  /// microseconds; shorter ones are dropped when they end.
+  explicit TimeTraceProfiler(unsigned GranularityUS = 500);
+
+  /// begin - Start a region called \p Name, whose event shows \p Detail, such
+  /// as a file or macro name.  Returns the ID to pass to end().
+  unsigned begin(const char *Name, StringRef Detail = StringRef());
+
+  /// end - End the region \p ID.  Regions do not have to end in the reverse
+  /// order they began in.
+  void end(unsigned ID);
+
+  /// setDetail - Replace the detail of the open region \p ID, for regions
+  /// whose name is only known after they began.
+  void setDetail(unsigned ID, StringRef Detail);
+
+  /// endAll - End every region that is still open, such as the files of a
+  /// parse that stopped at the end of a chunk.
+  void endAll();
+
+  /// writeEvents - Write the recorded regions as complete ("X") events on
+  /// track \p Tid.  Each event is preceded by a comma, so the output can
+  /// follow any other event of the "traceEvents" array.  Timestamps count
+  /// from when the first profiler was created, so the tracks of several
+  /// profilers line up.
+  void writeEvents(raw_ostream &OS, unsigned Tid) const;
+};
+
+/// TimeTraceScope - Traces the region from its construction to its
+/// destruction.  Does nothing if the profiler is null, so call sites do not
+/// have to check whether profiling is enabled.
+class TimeTraceScope {
+  TimeTraceScope(const TimeTraceScope &) LLVM_DELETED_FUNCTION;
+  void operator=(const TimeTraceScope &) LLVM_DELETED_FUNCTION;
+
+  TimeTraceProfiler *Profiler;
+  unsigned ID;
+
+public:
+  TimeTraceScope(TimeTraceProfiler *P, const char *Name,
+                 StringRef Detail = StringRef())
+    : Profiler(P), ID(P ? P->begin(Name, Detail) : 0) {}
+
+  void setDetail(StringRef Detail) {
+    if (Profiler)
+      Profiler->setDetail(ID, Detail);
+  }
+
+  ~TimeTraceScope() {
+    if (Profiler)
+      Profiler->end(ID);
+  }
+};
+
+} // end namespace vlang
+
+#endif
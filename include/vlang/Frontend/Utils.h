@@ -17,8 +17,10 @@
 #include "vlang/Diag/Diagnostic.h"
 #include "llvm/ADT/IntrusiveRefCntPtr.h"
 #include "llvm/ADT/StringRef.h"
+#include <string>
 
 namespace llvm {
+class MemoryBuffer;
 class raw_fd_ostream;
 class Triple;
 }
@@ -28,6 +30,7 @@ namespace vlang {
 class DependencyOutputOptions;
 class DiagnosticsEngine;
 class DiagnosticOptions;
+class FileEntry;
 class FileManager;
 class HeaderSearch;
 class HeaderSearchOptions;
@@ -64,6 +67,14 @@ void DoPrintPreprocessedInput(Preprocessor &PP, raw_ostream* OS,
 void AttachDependencyFileGen(Preprocessor &PP,
                              const DependencyOutputOptions &Opts);
 
+/// ScanDependencyFile - Write the dependency file of \p MainFile, finding its
+/// `include files with a DependencyScanner rather than by preprocessing it.
+/// The command line macros of \p PPOpts are defined first.
+void ScanDependencyFile(HeaderSearch &HeaderInfo, const FileEntry *MainFile,
+                        const PreprocessorOptions &PPOpts,
+                        const DependencyOutputOptions &Opts,
+                        DiagnosticsEngine &Diags);
+
 /// AttachDependencyGraphGen - Create a dependency graph generator, and attach
 /// it to the given preprocessor.
   void AttachDependencyGraphGen(Preprocessor &PP, StringRef OutputFile,
@@ -86,6 +97,29 @@ void AttachHeaderIncludeGen(Preprocessor &PP, bool ShowAllHeaders = false,
 /// a seekable stream.
 void CacheTokens(Preprocessor &PP, llvm::raw_fd_ostream* OS);
 
+/// DesignUnitBoundary - Where a chunk found by FindDesignUnitBoundaries
+/// starts, and the directives that were in effect there.
+struct DesignUnitBoundary {
+  /// Offset - The first byte of the design unit that starts the chunk.
+  unsigned Offset;
+
+  /// Preamble - Directive lines, such as the last `timescale before the
+  /// chunk, that the chunk's preprocessor must see before its first token.
+  std::string Preamble;
+};
+
+/// FindDesignUnitBoundaries - Find the offsets in \p Buffer at which
+/// top-level design units start, so that each chunk between two of them can
+/// be parsed by its own preprocessor and parser.  Chunks are at least
+/// \p MinChunkSize bytes.  Only the part of the file before the first
+/// directive other than `timescale is split, since later chunks could
+/// depend on its effects.  The last `timescale before each boundary is
+/// carried in its Preamble.
+void FindDesignUnitBoundaries(const llvm::MemoryBuffer *Buffer,
+                              const LangOptions &LangOpts,
+                              unsigned MinChunkSize,
+                              SmallVectorImpl<DesignUnitBoundary> &Boundaries);
+
 }  // end namespace vlang
 
 #endif
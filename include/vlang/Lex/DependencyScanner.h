@@ -0,0 +1,126 @@
+//===--- DependencyScanner.h - Directive-only `include scanner --*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file defines the DependencyScanner interface.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_VLANG_LEX_DEPENDENCYSCANNER_H
+#define LLVM_VLANG_LEX_DEPENDENCYSCANNER_H
+
+#include "vlang/Basic/LLVM.h"
+#include "vlang/Basic/SourceManager.h"
+#include "llvm/ADT/StringMap.h"
+#include <string>
+#include <vector>
+
+namespace vlang {
+
+class DiagnosticsEngine;
+class FileEntry;
+class HeaderSearch;
+
+/// DependencyScanner - Finds the files a source file `includes without
+/// running the Lexer or the Preprocessor.
+///
+/// Each file is searched with memchr for backticks, skipping comments and
+/// string literals, and only the directives that decide which files are
+/// included are looked at: `define and `undef, the `ifdef family, and
+/// `include itself, whose operand may be a macro defined as a file name.
+/// Everything else, macro uses included, is skipped, so a directive that
+/// only a macro expansion produces is not seen.  Include files are resolved
+/// with HeaderSearch::LookupFile, as the preprocessor resolves them.
+class DependencyScanner {
+public:
+  /// ScannedFile - A file the scan entered, and whether it is a system file.
+  struct ScannedFile {
+    const FileEntry *File;
+    SrcMgr::CharacteristicKind FileType;
+  };
+
+private:
+  HeaderSearch &HeaderInfo;
+  DiagnosticsEngine &Diags;
+
+  /// Macros - The body of each macro defined so far.  Only object-like
+  /// bodies are used, as the operand of `include.
+  llvm::StringMap<std::string> Macros;
+
+  /// ConditionalInfo - One open `ifdef/`ifndef.
+  struct ConditionalInfo {
+    bool ParentActive;   // The enclosing region is being scanned.
+    bool FoundTaken;     // A branch of this conditional was taken.
+  };
+  std::vector<ConditionalInfo> Conditionals;
+
+  /// Active - False while skipping a branch that is not taken.
+  bool Active;
+
+  std::vector<ScannedFile> Files;
+  std::vector<std::string> MissingFiles;
+  unsigned IncludeDepth;
+  bool SuppressIncludeNotFoundError;
+
+  unsigned NumDirectives, NumIncludes;
+  uint64_t NumBytesScanned;
+
+  void ScanFile(const FileEntry *File, SrcMgr::CharacteristicKind FileType);
+  const char *HandleDirective(const char *CurPtr, const char *BufferEnd,
+                              const FileEntry *File,
+                              SrcMgr::CharacteristicKind FileType);
+  const char *HandleInclude(const char *CurPtr, const char *BufferEnd,
+                            const FileEntry *File,
+                            SrcMgr::CharacteristicKind FileType);
+  const char *HandleDefine(const char *CurPtr, const char *BufferEnd);
+
+  enum ConditionalKind { CK_Ifdef, CK_Ifndef, CK_Elsif, CK_Else, CK_Endif };
+  void HandleConditional(ConditionalKind Kind, StringRef MacroName);
+
+  DependencyScanner(const DependencyScanner &) LLVM_DELETED_FUNCTION;
+  void operator=(const DependencyScanner &) LLVM_DELETED_FUNCTION;
+
+public:
+  DependencyScanner(HeaderSearch &HeaderInfo, DiagnosticsEngine &Diags);
+
+  /// defineMacro - Define \p Name as \p Body before scanning, as -D would.
+  void defineMacro(StringRef Name, StringRef Body = "1") {
+    Macros[Name] = Body;
+  }
+
+  /// undefineMacro - Undefine \p Name before scanning, as -U would.
+  void undefineMacro(StringRef Name) { Macros.erase(Name); }
+
+  /// SetSuppressIncludeNotFoundError - Only record `include files that can
+  /// not be found, rather than diagnosing them.
+  void SetSuppressIncludeNotFoundError(bool Suppress) {
+    SuppressIncludeNotFoundError = Suppress;
+  }
+
+  /// scan - Scan \p MainFile and every file it includes.
+  void scan(const FileEntry *MainFile);
+
+  /// Files - Every file entered, the main file first, in the order they were
+  /// entered.  A file included more than once is listed each time.
+  typedef std::vector<ScannedFile>::const_iterator file_iterator;
+  file_iterator files_begin() const { return Files.begin(); }
+  file_iterator files_end() const { return Files.end(); }
+
+  /// MissingFiles - The names of `include files that were not found.
+  typedef std::vector<std::string>::const_iterator missing_iterator;
+  missing_iterator missing_begin() const { return MissingFiles.begin(); }
+  missing_iterator missing_end() const { return MissingFiles.end(); }
+
+  unsigned getNumDirectives() const { return NumDirectives; }
+  unsigned getNumIncludes() const { return NumIncludes; }
+  uint64_t getNumBytesScanned() const { return NumBytesScanned; }
+};
+
+}  // end namespace vlang
+
+#endif
@@ -31,6 +31,7 @@ class FileEntry;
 class FileManager;
 class HeaderSearchOptions;
 class IdentifierInfo;
+class StatisticsReport;
 
 /// \brief The preprocessor keeps track of this information for each
 /// file that is \#included.
@@ -171,6 +172,8 @@ class HeaderSearch {
   // Various statistics we track for performance analysis.
   unsigned NumIncluded;
   unsigned NumMultiIncludeFileOptzn;
+  unsigned NumLookups;
+  unsigned NumLookupCacheHits;
 
   // HeaderSearch doesn't support default or copy construction.
   HeaderSearch(const HeaderSearch&) LLVM_DELETED_FUNCTION;
@@ -377,7 +380,10 @@ public:
   }
   search_dir_iterator system_dir_end() const { return SearchDirs.end(); }
   
-  void PrintStats();
+  void PrintStats(raw_ostream &OS);
+
+  /// ReportStats - Add the `include and lookup counters to \p R.
+  void ReportStats(StatisticsReport &R) const;
   
   size_t getTotalMemory() const;
 
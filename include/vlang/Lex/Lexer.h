@@ -26,6 +26,7 @@ class DiagnosticsEngine;
 class SourceManager;
 class Preprocessor;
 class DiagnosticBuilder;
+struct PTHToken;
 
 /// ConflictMarkerKind - Kinds of conflict marker which the lexer might be
 /// recovering from.
@@ -84,6 +85,17 @@ class Lexer : public PreprocessorLexer {
   // CurrentConflictMarkerState - The kind of conflict marker we are handling.
   ConflictMarkerKind CurrentConflictMarkerState;
 
+  // Pre-tokenized form of this buffer, if the PTHManager has one.  CachedTok
+  // is the next token to replay, valid while BufferPtr == CachedTokPtr.
+  const PTHToken *CachedToksBegin;
+  const PTHToken *CachedToksEnd;
+  const PTHToken *CachedTok;
+  const char *CachedTokPtr;
+
+  // NumTokensLexed - Tokens lexed since the preprocessor last collected the
+  // count, for its statistics.
+  unsigned NumTokensLexed;
+
   Lexer(const Lexer &) LLVM_DELETED_FUNCTION;
   void operator=(const Lexer &) LLVM_DELETED_FUNCTION;
   friend class Preprocessor;
@@ -125,6 +137,7 @@ public:
   void Lex(Token &Result) {
     // Start a new token.
     Result.startToken();
+    ++NumTokensLexed;
 
     // NOTE, any changes here should also change code after calls to
     // Preprocessor::HandleDirective
@@ -194,6 +207,16 @@ public:
 
   const char *getBufferStart() const { return BufferStart; }
 
+  /// setTokenCache - Replay tokens from the given pre-tokenized form of this
+  /// buffer wherever possible, instead of scanning characters.  The tokens
+  /// must outlive the lexer, and be sorted ranges inside the buffer, as
+  /// PTHManager::getTokens checks.
+  void setTokenCache(const PTHToken *Begin, const PTHToken *End) {
+    CachedToksBegin = CachedTok = Begin;
+    CachedToksEnd = End;
+    CachedTokPtr = BufferPtr;
+  }
+
   /// ReadToEndOfLine - Read the rest of the current preprocessor line as an
   /// uninterpreted string.  This switches the lexer out of directive mode.
   void ReadToEndOfLine(SmallVectorImpl<char> *Result = 0);
@@ -416,6 +439,10 @@ private:
   ///
   void LexTokenInternal(Token &Result);
 
+  /// LexFromTokenCache - Form the next token from the token cache.  Returns
+  /// false if it has to be lexed from characters instead.
+  bool LexFromTokenCache(Token &Result);
+
   /// FormTokenWithChars - When we lex a token, we have identified a span
   /// starting at BufferPtr, going to TokEnd that forms the token.  This method
   /// takes that range and assigns it to the token as its location and size.  In
@@ -531,11 +558,17 @@ private:
   // Other lexer functions.
 
   void SkipBytes(unsigned Bytes, bool StartOfLine);
+
+  /// SkipExcludedLines - Move BufferPtr to the next line whose first
+  /// non-blank character is a backtick, or to the end of the buffer, without
+  /// forming any tokens.  Used to skip the body of a false conditional.
+  void SkipExcludedLines();
   
   // Helper functions to lex the remainder of a token of the specific type.
   void LexAnyIdentifier      (Token &Result, const char *CurPtr, bool isMacroReference);
   void LexMacroIdentifier    (Token &Result, const char *CurPtr);
   void LexIdentifier         (Token &Result, const char *CurPtr);
+  void LexEscapedIdentifier  (Token &Result, const char *CurPtr);
   void LexNumericConstant    (Token &Result, const char *CurPtr);
   void LexStringLiteral      (Token &Result, const char *CurPtr,
                               tok::TokenKind Kind);
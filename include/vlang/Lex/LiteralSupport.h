@@ -184,6 +184,22 @@ private:
   void DiagnoseLexingError(SourceLocation Loc);
 };
 
+/// getIntegralLiteralWidth - The number of bits the digits of an integral
+/// literal of the given radix take, ignoring underscores.  For decimal
+/// numbers this is an upper bound.
+unsigned getIntegralLiteralWidth(StringRef Digits, unsigned Radix);
+
+/// decodeIntegralLiteral - Decode the digits of an integral literal, as
+/// written after the base and with underscores, into two bit planes of
+/// (Width + 63) / 64 words each, least significant word first.  A bit whose
+/// Unknown bit is set is X if its Value bit is set and Z otherwise.
+///
+/// The number is truncated or extended to Width bits; it is extended with X
+/// or Z if its leftmost digit is x or z, and with zeros otherwise.  Returns
+/// false and sets \p BadDigit if a digit is not valid in the radix.
+bool decodeIntegralLiteral(StringRef Digits, unsigned Radix, unsigned Width,
+                           uint64_t *Value, uint64_t *Unknown, char &BadDigit);
+
 }  // end namespace vlang
 
 #endif
@@ -0,0 +1,106 @@
+//===--- MacroExpansionCache.h - Memoized macro substitution ----*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file defines the MacroExpansionCache interface.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_VLANG_MACROEXPANSIONCACHE_H
+#define LLVM_VLANG_MACROEXPANSIONCACHE_H
+
+#include "vlang/Basic/LLVM.h"
+#include "vlang/Basic/SourceLocation.h"
+#include "vlang/Lex/Token.h"
+#include "llvm/ADT/DenseMap.h"
+#include <vector>
+
+namespace vlang {
+  class MacroArgs;
+  class MacroInfo;
+  class Preprocessor;
+
+/// MacroExpansionCache - Remembers the body of a function-like macro with its
+/// arguments substituted, keyed by the macro and the spellings of the
+/// arguments, so that invoking the macro again with the same arguments
+/// replays the substitution instead of redoing it.
+///
+/// Only substitutions that depend on nothing but the spellings of the
+/// arguments are cached: if an argument is pre-expanded, the result also
+/// depends on the macros defined at the time, and is not cached.  An entry
+/// records where each token came from, so a replay takes argument tokens,
+/// and with them their source locations, from the invocation being expanded.
+class MacroExpansionCache {
+public:
+  /// Where a token of a cached substitution comes from.  Non-negative values
+  /// are the index of the token in the unexpanded arguments.
+  enum { FromBody = -1, FromStringify = -2 };
+
+  /// Substitution - One argument substituted into the body, either as its
+  /// tokens or stringified.  DefLoc is the location of the parameter name in
+  /// the macro definition and DefLocEnd is that of the stringify operator's
+  /// parameter name.
+  struct Substitution {
+    unsigned Begin, End;
+    SourceLocation DefLoc, DefLocEnd;
+  };
+
+  /// Entry - The substituted body for one set of arguments.
+  struct Entry {
+    unsigned Hash;
+    std::vector<Token> Args;
+    std::vector<Token> Tokens;
+    std::vector<int> Origins;
+    std::vector<Substitution> Substitutions;
+  };
+
+private:
+  /// MaxEntriesPerMacro - Invocations whose arguments keep changing would
+  /// otherwise fill the cache with entries that are never used again.  Once
+  /// a macro has this many, the oldest is replaced.
+  enum { MaxEntriesPerMacro = 16 };
+
+  struct MacroEntries {
+    std::vector<Entry> Entries;
+    unsigned NextVictim;
+    MacroEntries() : NextVictim(0) {}
+  };
+
+  llvm::DenseMap<const MacroInfo *, MacroEntries> Cache;
+
+  unsigned NumHits, NumMisses, NumInvalidated;
+
+public:
+  MacroExpansionCache() : NumHits(0), NumMisses(0), NumInvalidated(0) {}
+
+  /// lookup - Return the cached substitution of \p MI for \p Args, or null.
+  /// \p Hash is set to the hash of the arguments, to pass to insert().
+  /// \p Cacheable is cleared if an argument names a macro, since whether it
+  /// is pre-expanded then depends on more than its spelling.
+  const Entry *lookup(const MacroInfo *MI, const MacroArgs *Args,
+                      unsigned &Hash, bool &Cacheable, const Preprocessor &PP);
+
+  /// insert - Return a new, empty entry for \p MI invoked with \p Args, for
+  /// the caller to fill in.  The entry may replace an older one of \p MI.
+  Entry &insert(const MacroInfo *MI, const MacroArgs *Args, unsigned Hash);
+
+  /// invalidate - Forget the substitutions of \p MI, which is being undefined
+  /// or redefined.
+  void invalidate(const MacroInfo *MI);
+
+  unsigned getNumHits() const { return NumHits; }
+  unsigned getNumMisses() const { return NumMisses; }
+  unsigned getNumInvalidated() const { return NumInvalidated; }
+
+  /// getMemorySize - The bytes held by cached entries.
+  size_t getMemorySize() const;
+};
+
+}  // end namespace vlang
+
+#endif
@@ -48,12 +48,35 @@ class MacroInfo {
   /// \brief This is the list of tokens that the macro is defined to.
   SmallVector<Token, 8> ReplacementTokens;
 
+public:
+  /// \brief One step of the plan a function-like macro is expanded by.
+  ///
+  /// Begin and End index the replacement tokens the step covers: a run of
+  /// tokens copied as they are, a parameter replaced by its argument, or a
+  /// ` operator and the parameter it stringifies.
+  struct ExpansionStep {
+    enum StepKind { CopyTokens, SubstituteArg, StringifyArg };
+    StepKind Kind;
+    unsigned ArgNo;
+    unsigned Begin, End;
+  };
+
+private:
+  /// \brief The replacement tokens of a function-like macro, split into the
+  /// steps that expand it, so that parameters are looked up once, when the
+  /// macro is defined, rather than on every expansion.
+  SmallVector<ExpansionStep, 4> ExpansionPlan;
+
   /// \brief Length in characters of the macro definition.
   mutable unsigned DefinitionLength;
   mutable bool IsDefinitionLengthCached : 1;
 
   /// \brief True if this macro is function-like, false if it is object-like.
   bool IsFunctionLike : 1;
+
+  /// \brief True if the expansion plan substitutes or stringifies a
+  /// parameter, so that expanding the macro changes its tokens.
+  bool UsesArguments : 1;
   
 private:
   //===--------------------------------------------------------------------===//
@@ -213,6 +236,18 @@ public:
     ReplacementTokens.push_back(Tok);
   }
 
+  /// \brief Split the replacement tokens into the steps that expand a
+  /// function-like macro.  Called once the whole body has been read.
+  void computeExpansionPlan();
+
+  typedef SmallVector<ExpansionStep, 4>::const_iterator plan_iterator;
+  plan_iterator plan_begin() const { return ExpansionPlan.begin(); }
+  plan_iterator plan_end() const { return ExpansionPlan.end(); }
+
+  /// \brief Return true if expanding this macro substitutes or stringifies
+  /// any of its arguments.
+  bool usesArguments() const { return UsesArguments; }
+
   /// \brief Return true if this macro is enabled.
   ///
   /// In other words, that we are not currently in an expansion of this macro.
@@ -15,6 +15,8 @@
 #ifndef LLVM_VLANG_MULTIPLEINCLUDEOPT_H
 #define LLVM_VLANG_MULTIPLEINCLUDEOPT_H
 
+#include "vlang/Basic/SourceLocation.h"
+
 namespace vlang {
 class IdentifierInfo;
 
@@ -32,21 +34,44 @@ class MultipleIncludeOpt {
   /// \#endif can be easily detected.
   bool ReadAnyTokens;
 
-  /// ReadAnyTokens - This is set to false when a file is first opened and true
-  /// any time a token is returned to the client or a (non-multiple-include)
-  /// directive is parsed.  When the final #endif is parsed this is reset back
-  /// to false, that way any tokens before the first #ifdef or after the last
-  /// #endif can be easily detected.
+  /// DidMacroExpansion - This is set to true any time a macro is expanded
+  /// with this lexer as the current buffer.  A macro expansion on the
+  /// \`ifndef line means the guard could evaluate differently elsewhere.
   bool DidMacroExpansion;
 
+  /// ImmediatelyAfterTopLevelIfndef - True between the top-level \`ifndef and
+  /// the next token or directive.  A \`define seen in this state is the one
+  /// that is expected to define the guard.
+  bool ImmediatelyAfterTopLevelIfndef;
+
   /// TheMacro - The controlling macro for a file, if valid.
   ///
   const IdentifierInfo *TheMacro;
+
+  /// DefinedMacro - The macro defined right after the top-level \`ifndef.
+  const IdentifierInfo *DefinedMacro;
+
+  SourceLocation MacroLoc;
+  SourceLocation DefinedLoc;
 public:
   MultipleIncludeOpt() {
     ReadAnyTokens = false;
     DidMacroExpansion = false;
+    ImmediatelyAfterTopLevelIfndef = false;
     TheMacro = 0;
+    DefinedMacro = 0;
+  }
+
+  SourceLocation GetMacroLocation() const { return MacroLoc; }
+  SourceLocation GetDefinedLocation() const { return DefinedLoc; }
+
+  void resetImmediatelyAfterTopLevelIfndef() {
+    ImmediatelyAfterTopLevelIfndef = false;
+  }
+
+  void SetDefinedMacro(IdentifierInfo *M, SourceLocation Loc) {
+    DefinedMacro = M;
+    DefinedLoc = Loc;
   }
 
   /// Invalidate - Permanently mark this file as not being suitable for the
@@ -55,16 +80,26 @@ public:
     // If we have read tokens but have no controlling macro, the state-machine
     // below can never "accept".
     ReadAnyTokens = true;
+    ImmediatelyAfterTopLevelIfndef = false;
     TheMacro = 0;
   }
 
-  /// getHasReadAnyTokensVal - This is used for the \#ifndef hande-shake at the
+  /// getHasReadAnyTokensVal - This is used for the \`ifndef hande-shake at the
   /// top of the file when reading preprocessor directives.  Otherwise, reading
   /// the "ifndef x" would count as reading tokens.
   bool getHasReadAnyTokensVal() const { return ReadAnyTokens; }
 
+  /// getImmediatelyAfterTopLevelIfndef - Whether the directive being read
+  /// directly follows the top-level \`ifndef line.
+  bool getImmediatelyAfterTopLevelIfndef() const {
+    return ImmediatelyAfterTopLevelIfndef;
+  }
+
   // If a token is read, remember that we have seen a side-effect in this file.
-  void ReadToken() { ReadAnyTokens = true; }
+  void ReadToken() {
+    ReadAnyTokens = true;
+    ImmediatelyAfterTopLevelIfndef = false;
+  }
 
   /// ExpandedMacro - When a macro is expanded with this lexer as the current
   /// buffer, this method is called to disable the MIOpt if needed.
@@ -77,7 +112,7 @@ public:
   /// ensures that this is only called if there are no tokens read before the
   /// \#ifndef.  The caller is required to do this, because reading the \#if
   /// line obviously reads in in tokens.
-  void EnterTopLevelIFNDEF(const IdentifierInfo *M) {
+  void EnterTopLevelIFNDEF(const IdentifierInfo *M, SourceLocation Loc) {
     // If the macro is already set, this is after the top-level #endif.
     if (TheMacro)
       return Invalidate();
@@ -91,7 +126,9 @@ public:
 
     // Remember that we're in the #if and that we have the macro.
     ReadAnyTokens = true;
+    ImmediatelyAfterTopLevelIfndef = true;
     TheMacro = M;
+    MacroLoc = Loc;
   }
 
   /// \brief Invoked when a top level conditional (except \`ifndef) is found.
@@ -122,6 +159,12 @@ public:
       return TheMacro;
     return 0;
   }
+
+  /// \brief If the top-level \`ifndef was directly followed by a \`define,
+  /// return the macro it defined.
+  const IdentifierInfo *GetDefinedMacro() const {
+    return DefinedMacro;
+  }
 };
 
 }  // end namespace vlang
@@ -190,6 +190,14 @@ public:
   /// \param IfLoc the source location of the \`ifdef/\`ifndef directive.
   virtual void Endif(SourceLocation Loc, SourceLocation IfLoc) {
   }
+
+  /// \brief Hook called whenever a well-formed \`timescale is seen.
+  /// \param Loc the source location of the directive.
+  /// \param UnitTok the time unit, such as "1ns".
+  /// \param PrecisionTok the time precision.
+  virtual void Timescale(SourceLocation Loc, const Token &UnitTok,
+                         const Token &PrecisionTok) {
+  }
 };
 
 /// \brief Simple wrapper class for chaining callbacks.
@@ -304,6 +312,12 @@ public:
     First->Endif(Loc, IfLoc);
     Second->Endif(Loc, IfLoc);
   }
+
+  virtual void Timescale(SourceLocation Loc, const Token &UnitTok,
+                         const Token &PrecisionTok) {
+    First->Timescale(Loc, UnitTok, PrecisionTok);
+    Second->Timescale(Loc, UnitTok, PrecisionTok);
+  }
 };
 
 }  // end namespace vlang
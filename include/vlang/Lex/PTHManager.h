@@ -0,0 +1,149 @@
+//===--- PTHManager.h - Manager object for pre-tokenized files --*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+//  This file defines the PTHManager interface, which reads token cache files
+//  written by CacheTokens(), and can keep the tokens of files lexed in memory.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_VLANG_PTHMANAGER_H
+#define LLVM_VLANG_PTHMANAGER_H
+
+#include "vlang/Basic/LLVM.h"
+#include "vlang/Basic/LangOptions.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/OwningPtr.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/Support/DataTypes.h"
+#include "llvm/Support/Mutex.h"
+#include <vector>
+
+namespace llvm {
+  class MemoryBuffer;
+}
+
+namespace vlang {
+
+class DiagnosticsEngine;
+class FileEntry;
+
+/// PTHToken - One raw token of a pre-tokenized file, as it is laid out in the
+/// token cache.  Comments are recorded as well, with kind tok::comment, so
+/// that comment handlers still see them when tokens are replayed.
+struct PTHToken {
+  uint32_t Offset;  // Offset of the first character in the source file.
+  uint32_t Length;  // Length of the token's spelling in the source file.
+  uint16_t Kind;    // The tok::TokenKind of the raw token.
+  uint16_t Flags;   // Token::TokenFlags of the raw token.
+};
+
+/// The layout of a token cache file.  Everything is in host byte order; the
+/// version field doubles as a byte order check.
+///
+///   PTHFileHeader
+///   PTHFileRecord[NumFiles]
+///   file names, each NUL terminated
+///   PTHToken[] for each file, 4-byte aligned
+struct PTHFileHeader {
+  char Magic[4];       // "VPTH"
+  uint32_t Version;
+  uint32_t NumFiles;
+  uint32_t Reserved;
+};
+
+struct PTHFileRecord {
+  uint64_t Size;         // Size of the source file when it was cached.
+  int64_t ModTime;       // Modification time of the source file.
+  uint32_t NameOffset;   // Offset of the file name from the start of the cache.
+  uint32_t NameLength;
+  uint32_t TokenOffset;  // Offset of the first PTHToken.
+  uint32_t NumTokens;
+};
+
+enum { PTHVersion = 1 };
+
+/// PTHManager - Provides access to the tokens of a token cache file, and of
+/// files lexed in memory.  The cache file is mapped into memory and never
+/// modified, and the files lexed in memory are guarded by a lock, so one
+/// PTHManager can be shared by any number of preprocessors, including ones
+/// running on different threads.
+class PTHManager {
+  /// Buf - The memory mapped token cache, or null if there is none.
+  OwningPtr<const llvm::MemoryBuffer> Buf;
+
+  /// Files - The cached files, keyed by the name they were entered as.
+  llvm::StringMap<const PTHFileRecord *> Files;
+
+  /// LexedFile - The tokens of a file lexed in memory, and the buffer they
+  /// were lexed from.
+  struct LexedFile {
+    const llvm::MemoryBuffer *Buffer;
+    std::vector<PTHToken> Tokens;
+  };
+
+  /// LexFiles - Whether files that are not in the cache file are lexed the
+  /// first time they are asked for, so that later preprocessors replay them.
+  bool LexFiles;
+  LangOptions LangOpts;
+
+  /// LexedFiles - The files lexed in memory.  A null entry is a file that
+  /// another thread is lexing.
+  llvm::DenseMap<const FileEntry *, LexedFile *> LexedFiles;
+  llvm::sys::Mutex Lock;
+
+  PTHManager(const llvm::MemoryBuffer *buf);
+
+  bool getLexedTokens(const FileEntry *FE, const llvm::MemoryBuffer *Buffer,
+                      const PTHToken *&Begin, const PTHToken *&End);
+
+  PTHManager(const PTHManager &) LLVM_DELETED_FUNCTION;
+  void operator=(const PTHManager &) LLVM_DELETED_FUNCTION;
+
+public:
+  ~PTHManager();
+
+  /// Create - Map the token cache file at \p FileName.  Returns null and
+  /// reports a diagnostic if the file is missing or malformed.
+  static PTHManager *Create(StringRef FileName, DiagnosticsEngine &Diags);
+
+  /// CreateInMemory - Create a PTHManager without a token cache file, which
+  /// lexes each file the first time it is asked for.
+  static PTHManager *CreateInMemory(const LangOptions &LangOpts);
+
+  /// setLexFiles - Lex the files that are not in the token cache file the
+  /// first time they are asked for, with \p Opts, and keep their tokens
+  /// until the PTHManager is destroyed.  This only pays off when the same
+  /// file is preprocessed more than once.
+  void setLexFiles(const LangOptions &Opts) {
+    LexFiles = true;
+    LangOpts = Opts;
+  }
+
+  /// getTokens - Look up the cached tokens for \p FE, whose contents are
+  /// \p Buffer.  Returns false if the file is not in the cache, if it changed
+  /// since it was cached, or if the tokens don't fit in \p Buffer, as they
+  /// can't if the cache is corrupt or the file was edited without changing
+  /// its size or modification time.  Files lexed in memory are only replayed
+  /// for the buffer they were lexed from, so they are only shared between
+  /// preprocessors that share their FileManager's buffers.
+  bool getTokens(const FileEntry *FE, const llvm::MemoryBuffer *Buffer,
+                 const PTHToken *&Begin, const PTHToken *&End);
+
+  /// LexRawTokens - Lex \p Buffer in raw mode, keeping comments, and record
+  /// every token.
+  static void LexRawTokens(const llvm::MemoryBuffer *Buffer,
+                           const LangOptions &LangOpts,
+                           std::vector<PTHToken> &Tokens);
+
+  unsigned getNumFiles() const { return Files.size(); }
+};
+
+}  // end namespace vlang
+
+#endif
@@ -19,6 +19,7 @@
 #include "vlang/Basic/SourceLocation.h"
 #include "vlang/Basic/Systask.h"
 #include "vlang/Lex/Lexer.h"
+#include "vlang/Lex/MacroExpansionCache.h"
 #include "vlang/Lex/MacroInfo.h"
 #include "vlang/Lex/PPCallbacks.h"
 #include "vlang/Lex/TokenLexer.h"
@@ -49,6 +50,9 @@ class CodeCompletionHandler;
 class DirectoryLookup;
 class PreprocessingRecord;
 class PreprocessorOptions;
+class PTHManager;
+class StatisticsReport;
+class TimeTraceProfiler;
 
 /// \brief Stores token information for comparing actual tokens with
 /// predefined values.  Only handles simple tokens and identifiers.
@@ -88,6 +92,18 @@ class Preprocessor : public RefCountedBase<Preprocessor> {
   /// \brief External source of macros.
   ExternalPreprocessorSource *ExternalSource;
 
+  /// PTH - Pre-tokenized forms of source files, if any.  Not owned, so one
+  /// token cache can be shared by several preprocessors.
+  PTHManager *PTH;
+
+  /// TimeTrace - The profiler the files entered and the macros expanded are
+  /// traced with, null if time tracing is disabled.  Not owned.
+  TimeTraceProfiler *TimeTrace;
+
+  /// FileTraceIDs - The regions of the files on the include stack, innermost
+  /// last.
+  SmallVector<unsigned, 8> FileTraceIDs;
+
   /// BP - A BumpPtrAllocator object used to quickly allocate and release
   ///  objects internal to the Preprocessor.
   llvm::BumpPtrAllocator BP;
@@ -256,7 +272,13 @@ class Preprocessor : public RefCountedBase<Preprocessor> {
   unsigned NumEnteredSourceFiles, MaxIncludeStackDepth;
   unsigned NumMacroExpanded, NumFnMacroExpanded, NumBuiltinMacroExpanded;
   unsigned NumFastMacroExpanded, NumTokenPaste, NumFastTokenPaste;
-  unsigned NumSkipped;
+  unsigned NumSkipped, NumSkippedLines, NumBacktracks;
+  uint64_t NumTokensLexed, NumBytesEntered;
+
+  /// CountSkippedLines - Whether NumSkippedLines is kept.  Counting the lines
+  /// of a skipped block costs a second pass over it, so it is only done when
+  /// statistics are requested.
+  bool CountSkippedLines;
 
   /// Predefines - This string is the predefined macros that preprocessor
   /// should use from the command line etc.
@@ -278,6 +300,13 @@ class Preprocessor : public RefCountedBase<Preprocessor> {
   SmallVector<Token, 16> MacroExpandedTokens;
   std::vector<std::pair<TokenLexer *, size_t> > MacroExpandingLexersStack;
 
+  /// ExpansionCache - Substituted bodies of function-like macro invocations,
+  /// replayed when a macro is invoked again with the same arguments.
+  MacroExpansionCache ExpansionCache;
+
+  /// CacheMacroExpansions - Whether ExpansionCache is used.
+  bool CacheMacroExpansions;
+
   /// \brief A record of the macro definitions and expansions that
   /// occurred during preprocessing.
   ///
@@ -365,6 +394,16 @@ public:
     return ExternalSource;
   }
 
+  /// setPTHManager - Replay tokens from \p pm for files it has cached.  The
+  /// PTHManager must outlive the preprocessor.
+  void setPTHManager(PTHManager *pm) { PTH = pm; }
+  PTHManager *getPTHManager() const { return PTH; }
+
+  /// setTimeTraceProfiler - Trace every file entered and every macro
+  /// expanded with \p P.  The parser traces its design units with it too.
+  void setTimeTraceProfiler(TimeTraceProfiler *P) { TimeTrace = P; }
+  TimeTraceProfiler *getTimeTraceProfiler() const { return TimeTrace; }
+
   /// \brief True if we are currently preprocessing a #if or #elif directive
   bool isParsingIfOrElifDirective() const { 
     return ParsingIfOrElifDirective;
@@ -959,7 +998,23 @@ public:
       ++NumTokenPaste;
   }
 
-  void PrintStats();
+  void PrintStats(raw_ostream &OS);
+
+  /// ReportStats - Add the preprocessor counters to \p R.
+  void ReportStats(StatisticsReport &R) const;
+
+  uint64_t getNumTokensLexed() const;
+  uint64_t getNumBytesEntered() const { return NumBytesEntered; }
+
+  /// setCountSkippedLines - Count the lines of skipped conditional blocks.
+  void setCountSkippedLines(bool Count) { CountSkippedLines = Count; }
+
+  /// setMacroExpansionCaching - Replay the substituted body of a function-like
+  /// macro invoked again with the same arguments.  On by default.
+  void setMacroExpansionCaching(bool Cache) { CacheMacroExpansions = Cache; }
+  bool isMacroExpansionCachingEnabled() const { return CacheMacroExpansions; }
+
+  MacroExpansionCache &getMacroExpansionCache() { return ExpansionCache; }
 
   size_t getTotalMemory() const;
 
@@ -1201,7 +1256,7 @@ private:
   void HandleIncludeDirective(Token &Tok);
 
   // Macro handling.
-  void HandleDefineDirective(Token &Tok);
+  void HandleDefineDirective(Token &Tok, bool ImmediatelyAfterHeaderGuard);
   void HandleUndefDirective(Token &Tok);
 
   // Conditional Inclusion.
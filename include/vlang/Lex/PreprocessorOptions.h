@@ -30,6 +30,25 @@ namespace vlang {
 class Preprocessor;
 class LangOptions;
 
+/// \brief How the tokens of a macro argument are located once they have been
+/// substituted into the body of the macro.
+enum MacroArgLocationKind {
+  /// \brief Each run of nearby argument tokens gets a macro argument expansion
+  /// entry, so that diagnostics show both the argument and the macro.
+  MacroArgLocs_Full,
+
+  /// \brief Each argument written in a file gets a single entry covering all
+  /// of its tokens, however much space or comment separates them.  That
+  /// makes fewer entries, but each one takes up source location space for
+  /// the gaps too, so an argument with long comments uses up more of it
+  /// than with MacroArgLocs_Full.
+  MacroArgLocs_Ranges,
+
+  /// \brief Argument tokens keep the location they were written at in the
+  /// macro invocation, and no entries are made for them.
+  MacroArgLocs_Collapsed
+};
+
 /// PreprocessorOptions - This class is used for passing the various options
 /// used in preprocessor initialization to InitializePreprocessor().
 class PreprocessorOptions : public RefCountedBase<PreprocessorOptions> {
@@ -46,6 +65,11 @@ public:
   /// definitions and expansions.
   unsigned DetailedRecord : 1;
 
+  /// \brief How substituted macro arguments are located.  Anything but
+  /// MacroArgLocs_Full saves source location entries and address space in
+  /// code that expands many macros, at the cost of detail in diagnostics.
+  MacroArgLocationKind MacroArgLocations;
+
   /// \brief Headers that will be converted to chained PCHs in memory.
   std::vector<std::string> ChainedIncludes;
 
@@ -141,6 +165,7 @@ public:
   
 public:
   PreprocessorOptions() : UsePredefines(true), DetailedRecord(false),
+                          MacroArgLocations(MacroArgLocs_Full),
                           PrecompiledPreambleBytes(0, true),
                           RemappedFilesKeepOriginalName(true),
                           RetainRemappedFileBuffers(false) { }
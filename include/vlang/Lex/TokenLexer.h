@@ -15,6 +15,7 @@
 #define LLVM_VLANG_TOKENLEXER_H
 
 #include "vlang/Basic/SourceLocation.h"
+#include "vlang/Lex/MacroExpansionCache.h"
 
 namespace vlang {
   class MacroInfo;
@@ -91,6 +92,11 @@ class TokenLexer {
   /// should not be subject to further macro expansion.
   bool DisableMacroExpansion : 1;
 
+  /// CollapseArgLocs - This is true when substituted argument tokens keep the
+  /// location they were written at, so only tokens from the macro definition
+  /// are given expansion locations.
+  bool CollapseArgLocs : 1;
+
   TokenLexer(const TokenLexer &) LLVM_DELETED_FUNCTION;
   void operator=(const TokenLexer &) LLVM_DELETED_FUNCTION;
 public:
@@ -155,6 +161,10 @@ private:
   /// return preexpanded tokens from Tokens.
   void ExpandFunctionArguments();
 
+  /// ReplayFunctionArguments - Install the cached substitution \p E of the
+  /// arguments, with the argument tokens and locations of this invocation.
+  void ReplayFunctionArguments(const MacroExpansionCache::Entry &E);
+
   /// \brief If \p loc is a FileID and points inside the current macro
   /// definition, returns the appropriate source location pointing at the
   /// macro expansion source location entry.
@@ -24,6 +24,7 @@
 #include <llvm/ADT/OwningPtr.h>
 #include <llvm/ADT/SmallVector.h>
 #include <stack>
+#include <string>
 
 namespace vlang {
   class DiagnosticBuilder;
@@ -33,6 +34,24 @@ namespace vlang {
   // TODO: May need to move
   typedef SmallVector<Token, 4> CachedTokens;
 
+/// DesignUnitPort - One port of a design unit header.  The direction is
+/// only known for ANSI style headers.
+struct DesignUnitPort {
+  std::string Name;
+  PortKind Direction;
+};
+
+/// DesignUnitSummary - The header of one design unit, as recorded when the
+/// parser skips design unit bodies.
+struct DesignUnitSummary {
+  DesignType Kind;
+  std::string Name;
+  SourceLocation Loc;       // The design unit keyword.
+  SourceLocation EndLoc;    // The end keyword; invalid if it was missing.
+  SmallVector<std::string, 4> Parameters;
+  SmallVector<DesignUnitPort, 8> Ports;
+};
+
 /// Parser - This implements a Parser for the C family of languages.  After
 /// Parsing units of the grammar, Productions are invoked to handle whatever has
 /// been read.
@@ -69,6 +88,17 @@ class Parser : public CodeCompletionHandler {
 
   OwningPtr<CommentHandler> CommentSemaHandler;
 
+  /// SkipFunctionBodies - Only scan the headers of design units, skip their
+  /// bodies by token matching, and record a DesignUnitSummary for each.
+  bool SkipFunctionBodies;
+
+  /// DesignUnits - The design units seen when skipping bodies.
+  SmallVector<DesignUnitSummary, 8> DesignUnits;
+
+  /// PortConnections - The connections of the instance being parsed, reused
+  /// for every instance before they are handed to Sema.
+  SmallVector<PortConnection, 16> PortConnections;
+
 public:
   Parser(Preprocessor &PP, Sema &Actions, bool SkipFunctionBodies);
   ~Parser();
@@ -78,6 +108,9 @@ public:
   Sema &getActions() const { return Actions; }
 
   const Token &getCurToken() const { return Tok; }
+
+  /// getDesignUnits - The design units parsed so far, when skipping bodies.
+  ArrayRef<DesignUnitSummary> getDesignUnits() const { return DesignUnits; }
   Scope *getCurScope() const { return Actions.getCurScope(); }
 
   ExprResult ExprError() { return ExprResult(true); }
@@ -470,13 +503,15 @@ private:
   bool ParseDescription();
 
   bool ParseDesignElementDeclaration();
+  bool SkipDesignElementDeclaration(DesignType Type, SourceLocation KeywordLoc);
+  void ScanHeaderList(DesignUnitSummary &Unit, bool Ports);
   bool ParseUdpDeclaration();
   bool ParsePackageDeclaration();
   bool ParseBindDirective();
   bool ParseConfigDeclaration();
 
   bool ParseParameterPortList();
-  bool ParseParameterPortDeclaration();
+  bool ParseParameterPortDeclaration(unsigned &Flags);
   bool ParseListOfPorts();
   bool ParseListOfPortDeclarations();
   bool ParsePortDeclaration();
@@ -575,7 +610,7 @@ private:
   bool ParseListOfDefparamAssignments();
   bool ParseListOfGenvarAssignments();
   bool ParseListOfNetDeclAssignments();
-  bool ParseListOfParamAssignments();
+  bool ParseListOfParamAssignments(unsigned Flags);
   bool ParseListOfSpecparamAssignments();
   bool ParseListOfTypeAssignments();
   bool ParseListOfVariableDeclAssignments();
@@ -669,9 +704,10 @@ private:
   bool ParseListOfParameterAssignments();
   bool ParseOrderedParameterAssignment();
   bool ParseNamedParameterAssignment();
-  bool ParseHierarchicalInstance();
+  bool ParseHierarchicalInstance(IdentifierInfo *Definition);
   bool ParseNameOfInstance();
-  bool ParseListOfPortConnections();
+  bool ParseListOfPortConnections(SmallVectorImpl<PortConnection> &Connections);
+  void ParsePortConnectionActual(PortConnection &Connection);
 
   // Section A.4.1.2 - Interface instantiation
   // Section A.4.1.3 - Program instantiation
@@ -771,7 +807,7 @@ private:
 
   // Section A.8.2 - Subroutine calls
   ExprResult ParseTfCall(bool parse_ident, llvm::StringRef ident);
-  ExprResult ParseListOfArguments();
+  bool ParseListOfArguments(ExprVector &Args);
   ExprResult ParseMethodCall();
   ExprResult ParseMethodCallBody();
   ExprResult ParseBuiltInMethodCall();
@@ -799,7 +835,8 @@ private:
   ExprResult  ParseTimeLiteral();
   ExprResult  ParseTimeUnit();
   ExprResult  ParseImplicitClassHandle();
-  ExprResult  ParseSelectOrRange();
+  ExprResult  ParseSelectOrRange(ExprResult Base = ExprResult(false));
+  ExprResult  ParseHierarchicalIdentifierExpr();
   ExprResult  ParseConstantCast();
   ExprResult  ParseConstantLetExpression();
   ExprResult  ParseCast();
@@ -810,6 +847,7 @@ private:
   // Section A.8.6 - Operators
   bool isUnaryOperator();
   bool isBinaryOperator();
+  bool isIndexedPartSelectOperator();
   ExprResult  ParseIncOrDecOperator();
   ExprResult  ParseUnaryModulePathOperator();
   ExprResult  ParseBinaryModulePathOperator();
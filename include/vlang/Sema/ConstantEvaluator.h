@@ -0,0 +1,134 @@
+//===--- ConstantEvaluator.h - Evaluate constant expressions ----*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// \brief Defines ConstantValue and ConstantEvaluator, which evaluates the
+/// constant expressions of parameters.
+///
+/// Expressions are evaluated with names bound to the parameters of one
+/// design unit, with their default values.  Results are cached per
+/// expression, so a parameter that many others refer to is evaluated once
+/// per unit.
+///
+//===----------------------------------------------------------------------===//
+
+#ifndef VLANG_SEMA_CONSTANTEVALUATOR_H
+#define VLANG_SEMA_CONSTANTEVALUATOR_H
+
+#include "vlang/AST/Parameter.h"
+#include "vlang/Basic/LLVM.h"
+#include "llvm/ADT/APInt.h"
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/SmallVector.h"
+
+namespace vlang {
+
+class CallExpr;
+class Expr;
+class IdentifierInfo;
+class StatisticsReport;
+
+/// ConstantValue - A four-state value of any width, or an invalid value for
+/// expressions that are not constant.  Like NumberLiteral, a bit is X if it
+/// is set in both the value and the unknown plane, and Z if it is only set
+/// in the unknown plane.
+class ConstantValue {
+  llvm::APInt Value;
+  llvm::APInt Unknown;
+  bool Signed;
+  bool Valid;
+
+public:
+  /// ConstantValue - An invalid value.
+  ConstantValue() : Value(1, 0), Unknown(1, 0), Signed(false), Valid(false) {}
+
+  ConstantValue(const llvm::APInt &V, bool S)
+    : Value(V), Unknown(V.getBitWidth(), 0), Signed(S), Valid(true) {}
+
+  ConstantValue(const llvm::APInt &V, const llvm::APInt &U, bool S)
+    : Value(V), Unknown(U), Signed(S), Valid(true) {
+    assert(V.getBitWidth() == U.getBitWidth() && "Planes differ in width");
+  }
+
+  /// getAllX - A value of \p Width X bits.
+  static ConstantValue getAllX(unsigned Width, bool S) {
+    llvm::APInt Ones = llvm::APInt::getAllOnesValue(Width);
+    return ConstantValue(Ones, Ones, S);
+  }
+
+  bool isValid() const { return Valid; }
+  bool isSigned() const { return Signed; }
+  unsigned getWidth() const { return Value.getBitWidth(); }
+
+  /// hasUnknownBits - Whether some bit is X or Z.
+  bool hasUnknownBits() const { return Valid && Unknown.getBoolValue(); }
+
+  const llvm::APInt &getValue() const { return Value; }
+  const llvm::APInt &getUnknown() const { return Unknown; }
+
+  void setSigned(bool S) { Signed = S; }
+
+  /// print - Print the value in decimal if every bit is known, and as a
+  /// sized binary number otherwise.
+  void print(raw_ostream &OS) const;
+};
+
+/// ConstantEvaluator - Evaluates constant expressions in one design unit
+/// and caches the results.  The cache refers to expressions by address, so
+/// it has to be cleared whenever the arena they live in is.
+class ConstantEvaluator {
+  ConstantEvaluator(const ConstantEvaluator &) LLVM_DELETED_FUNCTION;
+  void operator=(const ConstantEvaluator &) LLVM_DELETED_FUNCTION;
+
+public:
+  ConstantEvaluator();
+
+  /// setParameters - Bind names to \p Params, and forget the results cached
+  /// for the parameters before.  \p Params must stay alive and unchanged
+  /// until the next call or clear().
+  void setParameters(ArrayRef<ParameterDecl> Params);
+
+  /// evaluate - Evaluate \p E.  The result is invalid if \p E is not
+  /// constant, refers to an unknown name or depends on itself.
+  ConstantValue evaluate(const Expr *E);
+
+  /// evaluateParameter - Evaluate the default value of the parameter
+  /// \p Name.
+  ConstantValue evaluateParameter(IdentifierInfo *Name);
+
+  /// clear - Forget the parameters and all cached results.
+  void clear();
+
+  void PrintStats(raw_ostream &OS) const;
+  void ReportStats(StatisticsReport &R) const;
+
+private:
+  ConstantValue evaluateUncached(const Expr *E);
+  ConstantValue evaluateCall(const CallExpr *E);
+
+  ArrayRef<ParameterDecl> Params;
+
+  /// Index - The position of each parameter in Params, built the first time
+  /// a name is looked up.
+  llvm::DenseMap<IdentifierInfo *, unsigned> Index;
+
+  llvm::DenseMap<const Expr *, ConstantValue> Cache;
+
+  /// InProgress - The expressions being evaluated, to catch parameters that
+  /// depend on themselves.
+  SmallVector<const Expr *, 8> InProgress;
+
+  unsigned NumEvaluations;
+  unsigned NumCacheHits;
+};
+
+} // end namespace vlang
+
+#endif
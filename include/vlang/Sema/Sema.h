@@ -15,7 +15,15 @@
 #ifndef LLVM_CLANG_SEMA_SEMA_H
 #define LLVM_CLANG_SEMA_SEMA_H
 
+#include "vlang/AST/DesignUnitConsumer.h"
+#include "vlang/AST/Expr.h"
+#include "vlang/AST/Instance.h"
+#include "vlang/AST/Parameter.h"
+#include "vlang/Sema/ConstantEvaluator.h"
+#include "llvm/ADT/ArrayRef.h"
 #include "llvm/ADT/OwningPtr.h"
+#include "llvm/ADT/StringRef.h"
+#include <vector>
 
 namespace llvm {
   template <typename ValueT> struct DenseMapInfo;
@@ -29,6 +37,7 @@ namespace vlang {
   class Token;
   class DiagnosticsEngine;
   class SourceManager;
+  class StatisticsReport;
   class CodeCompleteConsumer;
   class Scope;
 
@@ -57,6 +66,26 @@ public:
 
   llvm::BumpPtrAllocator BumpAlloc;
 
+  /// \brief The module, primitive and gate instances, in source order.  The
+  /// port connections of each are stored back to back in PortConnections.
+  std::vector<InstanceRecord> Instances;
+  std::vector<PortConnection> PortConnections;
+
+  /// \brief The parameters and localparams of the design units, in source
+  /// order.
+  std::vector<ParameterDecl> Parameters;
+
+  /// \brief Evaluates the parameter values of the unit handed to the
+  /// consumer.  Its cache is cleared whenever BumpAlloc is reset.
+  ConstantEvaluator ConstEval;
+
+  /// \brief The consumer design units are handed to as they are finished,
+  /// or null to keep everything until Sema is destroyed.
+  DesignUnitConsumer *Consumer;
+
+  /// \brief The number of design units handed to the consumer.
+  unsigned NumConsumedUnits;
+
   /// \brief Cause the active diagnostic on the DiagosticsEngine to be
   /// emitted. This is closely coupled to the SemaDiagnosticBuilder class and
   /// should not be used elsewhere.
@@ -74,11 +103,22 @@ public:
 
   const LangOptions &getLangOpts() const { return LangOpts; }
 
+  /// \brief Hand every design unit to \p C as soon as it is finished, and
+  /// release what was built for it afterwards.
+  void setDesignUnitConsumer(DesignUnitConsumer *C) { Consumer = C; }
+  DesignUnitConsumer *getDesignUnitConsumer() const { return Consumer; }
+
+  ConstantEvaluator &getConstantEvaluator() { return ConstEval; }
+
   DiagnosticsEngine &getDiagnostics() const { return Diags; }
   SourceManager &getSourceManager() const { return SourceMgr; }
   Preprocessor &getPreprocessor() const { return PP; }
 
-  void PrintStats() const;
+  void PrintStats(raw_ostream &OS) const;
+
+  /// ReportStats - Add the counters of Sema and its constant evaluator to
+  /// \p R.
+  void ReportStats(StatisticsReport &R) const;
 
   /// \brief Helper class that creates diagnostics with optional
   /// template instantiation stacks.
@@ -132,7 +172,68 @@ public:
 
   bool findMacroSpelling(SourceLocation &loc, StringRef name);
 
+  /// \brief Copy \p Str into the AST arena.
+  StringRef copyString(StringRef Str);
+
+  //===--------------------------------------------------------------------===//
+  // Expression Parsing Callbacks: SemaExpr.cpp.
+  //
+  // Each of these builds one node in BumpAlloc.  The parser only calls them
+  // once every operand has been built.
+
+  Expr *ActOnNumberLiteral(SourceLocation Loc, StringRef Digits,
+                           unsigned Width, unsigned Radix, unsigned Flags);
+  Expr *ActOnStringLiteral(SourceLocation Loc, StringRef Text);
+  Expr *ActOnIdentifierExpr(SourceLocation Loc, IdentifierInfo *II);
+  Expr *ActOnMemberExpr(Expr *Base, SourceLocation MemberLoc,
+                        IdentifierInfo *Member);
+  Expr *ActOnSelectExpr(Expr *Base, SourceLocation LBracketLoc,
+                        SelectExpr::SelectKind Kind, Expr *Index,
+                        Expr *Width);
+  Expr *ActOnUnaryOp(SourceLocation OpLoc, tok::TokenKind Op, Expr *Operand);
+  Expr *ActOnBinaryOp(SourceLocation OpLoc, tok::TokenKind Op,
+                      Expr *LHS, Expr *RHS);
+  Expr *ActOnConditionalOp(SourceLocation QuestionLoc, Expr *Cond,
+                           Expr *LHS, Expr *RHS);
+  Expr *ActOnConcatenation(SourceLocation LBraceLoc, ArrayRef<Expr *> Exprs);
+  Expr *ActOnMultipleConcatenation(SourceLocation LBraceLoc, Expr *Count,
+                                   Expr *Inner);
+  Expr *ActOnCallExpr(Expr *Callee, SourceLocation LParenLoc,
+                      ArrayRef<Expr *> Args);
+  Expr *ActOnMinTypMaxExpr(Expr *Min, Expr *Typ, Expr *Max);
+
+  //===--------------------------------------------------------------------===//
+  // Design Unit Callbacks: SemaDecl.cpp.
+
+  void ActOnStartOfDesignUnit(tok::TokenKind Keyword, SourceLocation Loc);
+  void ActOnEndOfDesignUnit(IdentifierInfo *Name, SourceLocation EndLoc);
+  void ActOnParameter(SourceLocation Loc, IdentifierInfo *Name, Expr *Init,
+                      unsigned Flags);
+
+  //===--------------------------------------------------------------------===//
+  // Instantiation Callbacks: SemaInstance.cpp.
+
+  void ActOnInstance(SourceLocation Loc, tok::TokenKind GateKind,
+                     IdentifierInfo *Definition, IdentifierInfo *Name,
+                     ArrayRef<PortConnection> Connections);
+
+  /// \brief Return the port connections of \p I.
+  ArrayRef<PortConnection> getPortConnections(const InstanceRecord &I) const {
+    if (!I.NumConnections)
+      return ArrayRef<PortConnection>();
+    return ArrayRef<PortConnection>(&PortConnections[I.FirstConnection],
+                                    I.NumConnections);
+  }
+
 private:
+  /// \brief The design unit being parsed, valid between
+  /// ActOnStartOfDesignUnit and ActOnEndOfDesignUnit.
+  tok::TokenKind CurUnitKeyword;
+  SourceLocation CurUnitLoc;
+  unsigned CurUnitFirstInstance;
+  unsigned CurUnitFirstParameter;
+  bool CurUnitHasParameterPorts;
+
   /// \brief The parser's current scope.
   ///
   /// The parser maintains this state here.
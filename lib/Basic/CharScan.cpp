@@ -0,0 +1,407 @@
+//===--- CharScan.cpp - Vectorized character scanning ---------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// The vector scanners classify 16 or 32 bytes at once and use movemask to
+// find the first byte outside the class.  Bytes >= 0x80 compare as negative
+// with the signed byte compares, so they always end a run, just like they do
+// for the CharInfo predicates.
+//
+//===----------------------------------------------------------------------===//
+
+#include "vlang/Basic/CharScan.h"
+#include "vlang/Basic/CharInfo.h"
+#include "llvm/Support/MathExtras.h"
+
+using namespace vlang;
+
+// Runtime dispatch needs __builtin_cpu_supports and target attributes that
+// allow the intrinsics in functions compiled for a newer ISA than the rest of
+// the file.
+#if defined(__x86_64__) || defined(__i386__)
+# if defined(__clang__)
+#  if defined(__has_builtin)
+#   if __has_builtin(__builtin_cpu_supports)
+#    define VLANG_CHARSCAN_DISPATCH 1
+#   endif
+#  endif
+# elif defined(__GNUC__) && \
+       (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9))
+#  define VLANG_CHARSCAN_DISPATCH 1
+# endif
+#endif
+
+#ifdef VLANG_CHARSCAN_DISPATCH
+#include <immintrin.h>
+#endif
+
+//===----------------------------------------------------------------------===//
+// Scalar implementation
+//===----------------------------------------------------------------------===//
+
+static const char *scalarIdentifierBody(const char *Ptr, const char *) {
+  while (isIdentifierBody(*Ptr))
+    ++Ptr;
+  return Ptr;
+}
+
+static const char *scalarHorizontalWhitespace(const char *Ptr, const char *) {
+  while (isHorizontalWhitespace(*Ptr))
+    ++Ptr;
+  return Ptr;
+}
+
+static const char *scalarLineCommentEnd(const char *Ptr, const char *) {
+  char C = *Ptr;
+  while (C != 0 && C != '\n' && C != '\r')
+    C = *++Ptr;
+  return Ptr;
+}
+
+/// scalarDigit - Decode one binary or hexadecimal digit into its value and
+/// unknown bits.
+static bool scalarDigit(char C, unsigned Mask, unsigned &Value,
+                        unsigned &Unknown) {
+  Unknown = 0;
+  if (C >= '0' && C <= '9')
+    Value = C - '0';
+  else if ((C | 0x20) >= 'a' && (C | 0x20) <= 'f')
+    Value = (C | 0x20) - 'a' + 10;
+  else if ((C | 0x20) == 'x')
+    Value = Unknown = Mask;
+  else if ((C | 0x20) == 'z' || C == '?') {
+    Value = 0;
+    Unknown = Mask;
+  } else
+    return false;
+  return Value <= Mask;
+}
+
+static bool scalarHexWord(const char *Digits, uint64_t &Value,
+                          uint64_t &Unknown) {
+  uint64_t V = 0, U = 0;
+  for (unsigned i = 0; i != 16; ++i) {
+    unsigned DV, DU;
+    if (!scalarDigit(Digits[i], 0xF, DV, DU))
+      return false;
+    V = (V << 4) | DV;
+    U = (U << 4) | DU;
+  }
+  Value = V;
+  Unknown = U;
+  return true;
+}
+
+static bool scalarBinaryWord(const char *Digits, uint64_t &Value,
+                             uint64_t &Unknown) {
+  uint64_t V = 0, U = 0;
+  for (unsigned i = 0; i != 64; ++i) {
+    unsigned DV, DU;
+    if (!scalarDigit(Digits[i], 0x1, DV, DU))
+      return false;
+    V = (V << 1) | DV;
+    U = (U << 1) | DU;
+  }
+  Value = V;
+  Unknown = U;
+  return true;
+}
+
+#ifdef VLANG_CHARSCAN_DISPATCH
+
+//===----------------------------------------------------------------------===//
+// SSE2 implementation
+//===----------------------------------------------------------------------===//
+
+__attribute__((target("sse2")))
+static const char *sse2IdentifierBody(const char *Ptr, const char *End) {
+  const __m128i LowerA = _mm_set1_epi8('a' - 1), LowerZ = _mm_set1_epi8('z' + 1);
+  const __m128i Digit0 = _mm_set1_epi8('0' - 1), Digit9 = _mm_set1_epi8('9' + 1);
+  const __m128i CaseBit = _mm_set1_epi8(0x20);
+  const __m128i Under = _mm_set1_epi8('_'), Dollar = _mm_set1_epi8('$');
+
+  while (End - Ptr >= 16) {
+    __m128i V = _mm_loadu_si128((const __m128i *)Ptr);
+    // Folding the case bit in maps A-Z onto a-z and nothing else onto a-z.
+    __m128i L = _mm_or_si128(V, CaseBit);
+    __m128i In = _mm_and_si128(_mm_cmpgt_epi8(L, LowerA),
+                               _mm_cmplt_epi8(L, LowerZ));
+    In = _mm_or_si128(In, _mm_and_si128(_mm_cmpgt_epi8(V, Digit0),
+                                        _mm_cmplt_epi8(V, Digit9)));
+    In = _mm_or_si128(In, _mm_or_si128(_mm_cmpeq_epi8(V, Under),
+                                       _mm_cmpeq_epi8(V, Dollar)));
+    unsigned Out = ~_mm_movemask_epi8(In) & 0xFFFF;
+    if (Out)
+      return Ptr + llvm::CountTrailingZeros_32(Out);
+    Ptr += 16;
+  }
+  return scalarIdentifierBody(Ptr, End);
+}
+
+__attribute__((target("sse2")))
+static const char *sse2HorizontalWhitespace(const char *Ptr, const char *End) {
+  const __m128i Space = _mm_set1_epi8(' '), Tab = _mm_set1_epi8('\t');
+  const __m128i FormFeed = _mm_set1_epi8('\f'), VTab = _mm_set1_epi8('\v');
+
+  while (End - Ptr >= 16) {
+    __m128i V = _mm_loadu_si128((const __m128i *)Ptr);
+    __m128i In = _mm_or_si128(
+        _mm_or_si128(_mm_cmpeq_epi8(V, Space), _mm_cmpeq_epi8(V, Tab)),
+        _mm_or_si128(_mm_cmpeq_epi8(V, FormFeed), _mm_cmpeq_epi8(V, VTab)));
+    unsigned Out = ~_mm_movemask_epi8(In) & 0xFFFF;
+    if (Out)
+      return Ptr + llvm::CountTrailingZeros_32(Out);
+    Ptr += 16;
+  }
+  return scalarHorizontalWhitespace(Ptr, End);
+}
+
+__attribute__((target("sse2")))
+static const char *sse2LineCommentEnd(const char *Ptr, const char *End) {
+  const __m128i NewLine = _mm_set1_epi8('\n'), Return = _mm_set1_epi8('\r');
+  const __m128i Nul = _mm_setzero_si128();
+
+  while (End - Ptr >= 16) {
+    __m128i V = _mm_loadu_si128((const __m128i *)Ptr);
+    __m128i Stop = _mm_or_si128(
+        _mm_or_si128(_mm_cmpeq_epi8(V, NewLine), _mm_cmpeq_epi8(V, Return)),
+        _mm_cmpeq_epi8(V, Nul));
+    unsigned Found = _mm_movemask_epi8(Stop);
+    if (Found)
+      return Ptr + llvm::CountTrailingZeros_32(Found);
+    Ptr += 16;
+  }
+  return scalarLineCommentEnd(Ptr, End);
+}
+
+//===----------------------------------------------------------------------===//
+// AVX2 implementation
+//===----------------------------------------------------------------------===//
+
+__attribute__((target("avx2")))
+static const char *avx2IdentifierBody(const char *Ptr, const char *End) {
+  const __m256i LowerA = _mm256_set1_epi8('a' - 1);
+  const __m256i LowerZ = _mm256_set1_epi8('z' + 1);
+  const __m256i Digit0 = _mm256_set1_epi8('0' - 1);
+  const __m256i Digit9 = _mm256_set1_epi8('9' + 1);
+  const __m256i CaseBit = _mm256_set1_epi8(0x20);
+  const __m256i Under = _mm256_set1_epi8('_'), Dollar = _mm256_set1_epi8('$');
+
+  while (End - Ptr >= 32) {
+    __m256i V = _mm256_loadu_si256((const __m256i *)Ptr);
+    __m256i L = _mm256_or_si256(V, CaseBit);
+    __m256i In = _mm256_and_si256(_mm256_cmpgt_epi8(L, LowerA),
+                                  _mm256_cmpgt_epi8(LowerZ, L));
+    In = _mm256_or_si256(In, _mm256_and_si256(_mm256_cmpgt_epi8(V, Digit0),
+                                              _mm256_cmpgt_epi8(Digit9, V)));
+    In = _mm256_or_si256(In, _mm256_or_si256(_mm256_cmpeq_epi8(V, Under),
+                                             _mm256_cmpeq_epi8(V, Dollar)));
+    unsigned Out = ~(unsigned)_mm256_movemask_epi8(In);
+    if (Out)
+      return Ptr + llvm::CountTrailingZeros_32(Out);
+    Ptr += 32;
+  }
+  return sse2IdentifierBody(Ptr, End);
+}
+
+__attribute__((target("avx2")))
+static const char *avx2HorizontalWhitespace(const char *Ptr, const char *End) {
+  const __m256i Space = _mm256_set1_epi8(' '), Tab = _mm256_set1_epi8('\t');
+  const __m256i FormFeed = _mm256_set1_epi8('\f');
+  const __m256i VTab = _mm256_set1_epi8('\v');
+
+  while (End - Ptr >= 32) {
+    __m256i V = _mm256_loadu_si256((const __m256i *)Ptr);
+    __m256i In = _mm256_or_si256(
+        _mm256_or_si256(_mm256_cmpeq_epi8(V, Space), _mm256_cmpeq_epi8(V, Tab)),
+        _mm256_or_si256(_mm256_cmpeq_epi8(V, FormFeed),
+                        _mm256_cmpeq_epi8(V, VTab)));
+    unsigned Out = ~(unsigned)_mm256_movemask_epi8(In);
+    if (Out)
+      return Ptr + llvm::CountTrailingZeros_32(Out);
+    Ptr += 32;
+  }
+  return sse2HorizontalWhitespace(Ptr, End);
+}
+
+__attribute__((target("avx2")))
+static const char *avx2LineCommentEnd(const char *Ptr, const char *End) {
+  const __m256i NewLine = _mm256_set1_epi8('\n');
+  const __m256i Return = _mm256_set1_epi8('\r');
+  const __m256i Nul = _mm256_setzero_si256();
+
+  while (End - Ptr >= 32) {
+    __m256i V = _mm256_loadu_si256((const __m256i *)Ptr);
+    __m256i Stop = _mm256_or_si256(
+        _mm256_or_si256(_mm256_cmpeq_epi8(V, NewLine),
+                        _mm256_cmpeq_epi8(V, Return)),
+        _mm256_cmpeq_epi8(V, Nul));
+    unsigned Found = _mm256_movemask_epi8(Stop);
+    if (Found)
+      return Ptr + llvm::CountTrailingZeros_32(Found);
+    Ptr += 32;
+  }
+  return sse2LineCommentEnd(Ptr, End);
+}
+
+//===----------------------------------------------------------------------===//
+// SSSE3 digit decoding
+//===----------------------------------------------------------------------===//
+
+// Digits are written most significant first, so each 16 byte chunk is
+// reversed with pshufb to put the least significant digit in byte 0, where
+// movemask and the packing below expect bit 0.
+
+__attribute__((target("ssse3")))
+static __m128i loadReversed(const char *Ptr) {
+  const __m128i Reverse = _mm_setr_epi8(15, 14, 13, 12, 11, 10, 9, 8,
+                                        7, 6, 5, 4, 3, 2, 1, 0);
+  return _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)Ptr), Reverse);
+}
+
+__attribute__((target("ssse3")))
+static bool ssse3HexWord(const char *Digits, uint64_t &Value,
+                         uint64_t &Unknown) {
+  const __m128i CaseBit = _mm_set1_epi8(0x20);
+  const __m128i Nibble = _mm_set1_epi8(0x0F);
+  __m128i V = loadReversed(Digits);
+  __m128i L = _mm_or_si128(V, CaseBit);
+
+  __m128i IsDec = _mm_and_si128(_mm_cmpgt_epi8(V, _mm_set1_epi8('0' - 1)),
+                                _mm_cmplt_epi8(V, _mm_set1_epi8('9' + 1)));
+  __m128i IsHex = _mm_and_si128(_mm_cmpgt_epi8(L, _mm_set1_epi8('a' - 1)),
+                                _mm_cmplt_epi8(L, _mm_set1_epi8('f' + 1)));
+  __m128i IsX = _mm_cmpeq_epi8(L, _mm_set1_epi8('x'));
+  __m128i IsZ = _mm_or_si128(_mm_cmpeq_epi8(L, _mm_set1_epi8('z')),
+                             _mm_cmpeq_epi8(V, _mm_set1_epi8('?')));
+  __m128i IsUnknown = _mm_or_si128(IsX, IsZ);
+  __m128i Valid = _mm_or_si128(_mm_or_si128(IsDec, IsHex), IsUnknown);
+  if (_mm_movemask_epi8(Valid) != 0xFFFF)
+    return false;
+
+  // One nibble per byte: the digit value, 0xF for x and 0 for z.
+  __m128i N = _mm_or_si128(
+      _mm_and_si128(IsDec, _mm_sub_epi8(V, _mm_set1_epi8('0'))),
+      _mm_and_si128(IsHex, _mm_sub_epi8(L, _mm_set1_epi8('a' - 10))));
+  N = _mm_or_si128(N, _mm_and_si128(IsX, Nibble));
+  __m128i U = _mm_and_si128(IsUnknown, Nibble);
+
+  // Merge each pair of nibbles into a byte, low digit first, then narrow the
+  // eight 16-bit lanes of both planes to bytes.
+  const __m128i Weights = _mm_set1_epi16(0x1001);
+  __m128i Packed = _mm_packus_epi16(_mm_maddubs_epi16(N, Weights),
+                                    _mm_maddubs_epi16(U, Weights));
+  uint64_t Planes[2];
+  _mm_storeu_si128((__m128i *)Planes, Packed);
+  Value = Planes[0];
+  Unknown = Planes[1];
+  return true;
+}
+
+__attribute__((target("ssse3")))
+static bool ssse3BinaryWord(const char *Digits, uint64_t &Value,
+                            uint64_t &Unknown) {
+  const __m128i CaseBit = _mm_set1_epi8(0x20);
+  uint64_t V = 0, U = 0;
+  // The last 16 digits are the low 16 bits.
+  for (unsigned i = 0; i != 4; ++i) {
+    __m128i C = loadReversed(Digits + 48 - 16 * i);
+    __m128i L = _mm_or_si128(C, CaseBit);
+    __m128i IsOne = _mm_cmpeq_epi8(C, _mm_set1_epi8('1'));
+    __m128i IsX = _mm_cmpeq_epi8(L, _mm_set1_epi8('x'));
+    __m128i IsZ = _mm_or_si128(_mm_cmpeq_epi8(L, _mm_set1_epi8('z')),
+                               _mm_cmpeq_epi8(C, _mm_set1_epi8('?')));
+    __m128i Valid = _mm_or_si128(_mm_cmpeq_epi8(C, _mm_set1_epi8('0')),
+                                 _mm_or_si128(IsOne, _mm_or_si128(IsX, IsZ)));
+    if (_mm_movemask_epi8(Valid) != 0xFFFF)
+      return false;
+    V |= (uint64_t)_mm_movemask_epi8(_mm_or_si128(IsOne, IsX)) << (16 * i);
+    U |= (uint64_t)_mm_movemask_epi8(_mm_or_si128(IsX, IsZ)) << (16 * i);
+  }
+  Value = V;
+  Unknown = U;
+  return true;
+}
+
+#endif // VLANG_CHARSCAN_DISPATCH
+
+//===----------------------------------------------------------------------===//
+// Dispatch
+//===----------------------------------------------------------------------===//
+
+namespace {
+/// ScanImpl - One complete set of scanners.
+struct ScanImpl {
+  const char *(*IdentifierBody)(const char *, const char *);
+  const char *(*HorizontalWhitespace)(const char *, const char *);
+  const char *(*LineCommentEnd)(const char *, const char *);
+  bool (*HexWord)(const char *, uint64_t &, uint64_t &);
+  bool (*BinaryWord)(const char *, uint64_t &, uint64_t &);
+  const char *Name;
+};
+}
+
+static ScanImpl selectImpl() {
+  ScanImpl Impl = { scalarIdentifierBody, scalarHorizontalWhitespace,
+                    scalarLineCommentEnd, scalarHexWord, scalarBinaryWord,
+                    "scalar" };
+#ifdef VLANG_CHARSCAN_DISPATCH
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2")) {
+    ScanImpl AVX2 = { avx2IdentifierBody, avx2HorizontalWhitespace,
+                      avx2LineCommentEnd, ssse3HexWord, ssse3BinaryWord,
+                      "avx2" };
+    Impl = AVX2;
+  } else if (__builtin_cpu_supports("sse2")) {
+    ScanImpl SSE2 = { sse2IdentifierBody, sse2HorizontalWhitespace,
+                      sse2LineCommentEnd, scalarHexWord, scalarBinaryWord,
+                      "sse2" };
+    // The digit decoders need pshufb, which the first SSE2 CPUs lack.
+    if (__builtin_cpu_supports("ssse3")) {
+      SSE2.HexWord = ssse3HexWord;
+      SSE2.BinaryWord = ssse3BinaryWord;
+    }
+    Impl = SSE2;
+  }
+#endif
+  return Impl;
+}
+
+/// getImpl - The scanners for this CPU, chosen on first use.  Function-local
+/// statics are initialized exactly once even with parallel lexers.
+static const ScanImpl &getImpl() {
+  static const ScanImpl Impl = selectImpl();
+  return Impl;
+}
+
+const char *charscan::skipIdentifierBody(const char *Ptr, const char *End) {
+  return getImpl().IdentifierBody(Ptr, End);
+}
+
+const char *charscan::skipHorizontalWhitespace(const char *Ptr,
+                                               const char *End) {
+  return getImpl().HorizontalWhitespace(Ptr, End);
+}
+
+const char *charscan::findLineCommentEnd(const char *Ptr, const char *End) {
+  return getImpl().LineCommentEnd(Ptr, End);
+}
+
+bool charscan::decodeHexWord(const char *Digits, uint64_t &Value,
+                             uint64_t &Unknown) {
+  return getImpl().HexWord(Digits, Value, Unknown);
+}
+
+bool charscan::decodeBinaryWord(const char *Digits, uint64_t &Value,
+                                uint64_t &Unknown) {
+  return getImpl().BinaryWord(Digits, Value, Unknown);
+}
+
+const char *charscan::getImplementationName() {
+  return getImpl().Name;
+}
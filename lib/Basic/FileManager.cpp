@@ -184,9 +184,11 @@ FileManager::FileManager(const FileSystemOptions &FSO)
   : FileSystemOpts(FSO),
     UniqueRealDirs(*new UniqueDirContainer()),
     UniqueRealFiles(*new UniqueFileContainer()),
-    SeenDirEntries(64), SeenFileEntries(64), NextFileUID(0) {
+    SeenDirEntries(64), SeenFileEntries(64), ShareFileBuffers(false),
+    NextFileUID(0) {
   NumDirLookups = NumFileLookups = 0;
   NumDirCacheMisses = NumFileCacheMisses = 0;
+  NumSharedBufferHits = 0;
 }
 
 FileManager::~FileManager() {
@@ -196,11 +198,17 @@ FileManager::~FileManager() {
     delete VirtualFileEntries[i];
   for (unsigned i = 0, e = VirtualDirectoryEntries.size(); i != e; ++i)
     delete VirtualDirectoryEntries[i];
+  for (llvm::DenseMap<const FileEntry *, llvm::MemoryBuffer *>::iterator
+         I = SharedBuffers.begin(), E = SharedBuffers.end(); I != E; ++I)
+    delete I->second;
+  for (unsigned i = 0, e = StaleSharedBuffers.size(); i != e; ++i)
+    delete StaleSharedBuffers[i];
 }
 
 void FileManager::addStatCache(FileSystemStatCache *statCache,
                                bool AtBeginning) {
   assert(statCache && "No stat cache provided?");
+  llvm::sys::ScopedLock Guard(Lock);
   if (AtBeginning || StatCache.get() == 0) {
     statCache->setNextStatCache(StatCache.take());
     StatCache.reset(statCache);
@@ -217,6 +225,7 @@ void FileManager::addStatCache(FileSystemStatCache *statCache,
 void FileManager::removeStatCache(FileSystemStatCache *statCache) {
   if (!statCache)
     return;
+  llvm::sys::ScopedLock Guard(Lock);
   
   if (StatCache.get() == statCache) {
     // This is the first stat cache.
@@ -234,6 +243,7 @@ void FileManager::removeStatCache(FileSystemStatCache *statCache) {
 }
 
 void FileManager::clearStatCaches() {
+  llvm::sys::ScopedLock Guard(Lock);
   StatCache.reset(0);
 }
 
@@ -293,6 +303,7 @@ const DirectoryEntry *FileManager::getDirectory(StringRef DirName,
       llvm::sys::path::is_separator(DirName.back()))
     DirName = DirName.substr(0, DirName.size()-1);
 
+  llvm::sys::ScopedLock Guard(Lock);
   ++NumDirLookups;
   llvm::StringMapEntry<DirectoryEntry *> &NamedDirEnt =
     SeenDirEntries.GetOrCreateValue(DirName);
@@ -339,6 +350,7 @@ const DirectoryEntry *FileManager::getDirectory(StringRef DirName,
 
 const FileEntry *FileManager::getFile(StringRef Filename, bool openFile,
                                       bool CacheFailure) {
+  llvm::sys::ScopedLock Guard(Lock);
   ++NumFileLookups;
 
   // See if there is already an entry in the map.
@@ -421,6 +433,7 @@ const FileEntry *FileManager::getFile(StringRef Filename, bool openFile,
 const FileEntry *
 FileManager::getVirtualFile(StringRef Filename, off_t Size,
                             time_t ModificationTime) {
+  llvm::sys::ScopedLock Guard(Lock);
   ++NumFileLookups;
 
   // See if there is already an entry in the map.
@@ -510,14 +523,20 @@ getBufferForFile(const FileEntry *Entry, std::string *ErrorStr,
     FileSize = -1;
 
   const char *Filename = Entry->getName();
-  // If the file is already open, use the open file descriptor.
-  if (Entry->FD != -1) {
-    ec = llvm::MemoryBuffer::getOpenFile(Entry->FD, Filename, Result, FileSize);
+  // If the file is already open, use the open file descriptor.  The
+  // descriptor belongs to the shared entry, so claim it under the lock.
+  int FD;
+  {
+    llvm::sys::ScopedLock Guard(Lock);
+    FD = Entry->FD;
+    Entry->FD = -1;
+  }
+  if (FD != -1) {
+    ec = llvm::MemoryBuffer::getOpenFile(FD, Filename, Result, FileSize);
     if (ErrorStr)
       *ErrorStr = ec.message();
 
-    close(Entry->FD);
-    Entry->FD = -1;
+    close(FD);
     return Result.take();
   }
 
@@ -557,6 +576,37 @@ getBufferForFile(StringRef Filename, std::string *ErrorStr) {
   return Result.take();
 }
 
+const llvm::MemoryBuffer *
+FileManager::getSharedBufferForFile(const FileEntry *Entry,
+                                    std::string *ErrorStr) {
+  {
+    llvm::sys::ScopedLock Guard(Lock);
+    llvm::DenseMap<const FileEntry *, llvm::MemoryBuffer *>::iterator I =
+      SharedBuffers.find(Entry);
+    if (I != SharedBuffers.end()) {
+      ++NumSharedBufferHits;
+      return I->second;
+    }
+  }
+
+  // Read the file without holding the lock, so that compilations reading
+  // other files are not held up.  If two compilations read the same file at
+  // the same time, the first buffer inserted is kept.  Don't cache failures;
+  // the file may appear later.
+  llvm::MemoryBuffer *Buffer = getBufferForFile(Entry, ErrorStr);
+  if (!Buffer)
+    return 0;
+
+  llvm::sys::ScopedLock Guard(Lock);
+  std::pair<llvm::DenseMap<const FileEntry *, llvm::MemoryBuffer *>::iterator,
+            bool> Inserted = SharedBuffers.insert(std::make_pair(Entry, Buffer));
+  if (!Inserted.second) {
+    delete Buffer;
+    return Inserted.first->second;
+  }
+  return Buffer;
+}
+
 /// getStatValue - Get the 'stat' information for the specified path,
 /// using the cache to accelerate it if possible.  This returns true
 /// if the path points to a virtual file or does not exist, or returns
@@ -587,9 +637,19 @@ bool FileManager::getNoncachedStatValue(StringRef Path,
 
 void FileManager::invalidateCache(const FileEntry *Entry) {
   assert(Entry && "Cannot invalidate a NULL FileEntry");
+  llvm::sys::ScopedLock Guard(Lock);
 
   SeenFileEntries.erase(Entry->getName());
 
+  // The entry is about to be destroyed and its address may be reused, so
+  // detach its contents from it.
+  llvm::DenseMap<const FileEntry *, llvm::MemoryBuffer *>::iterator Known
+    = SharedBuffers.find(Entry);
+  if (Known != SharedBuffers.end()) {
+    StaleSharedBuffers.push_back(Known->second);
+    SharedBuffers.erase(Known);
+  }
+
   // FileEntry invalidation should not block future optimizations in the file
   // caches. Possible alternatives are cache truncation (invalidate last N) or
   // invalidation of the whole cache.
@@ -599,6 +659,7 @@ void FileManager::invalidateCache(const FileEntry *Entry) {
 
 void FileManager::GetUniqueIDMapping(
                    SmallVectorImpl<const FileEntry *> &UIDToFiles) const {
+  llvm::sys::ScopedLock Guard(Lock);
   UIDToFiles.clear();
   UIDToFiles.resize(NextFileUID);
   
@@ -626,6 +687,7 @@ void FileManager::modifyFileEntry(FileEntry *File,
 StringRef FileManager::getCanonicalName(const DirectoryEntry *Dir) {
   // FIXME: use llvm::sys::fs::canonical() when it gets implemented
 #ifdef LLVM_ON_UNIX
+  llvm::sys::ScopedLock Guard(Lock);
   llvm::DenseMap<const DirectoryEntry *, llvm::StringRef>::iterator Known
     = CanonicalDirNames.find(Dir);
   if (Known != CanonicalDirNames.end())
@@ -648,6 +710,7 @@ StringRef FileManager::getCanonicalName(const DirectoryEntry *Dir) {
 }
 
 void FileManager::PrintStats() const {
+  llvm::sys::ScopedLock Guard(Lock);
   llvm::errs() << "\n*** File Manager Stats:\n";
   llvm::errs() << UniqueRealFiles.size() << " real files found, "
                << UniqueRealDirs.size() << " real dirs found.\n";
@@ -657,6 +720,8 @@ void FileManager::PrintStats() const {
                << NumDirCacheMisses << " dir cache misses.\n";
   llvm::errs() << NumFileLookups << " file lookups, "
                << NumFileCacheMisses << " file cache misses.\n";
+  llvm::errs() << SharedBuffers.size() << " shared file buffers, "
+               << NumSharedBufferHits << " shared buffer hits.\n";
 
   //llvm::errs() << PagesMapped << BytesOfPagesMapped << FSLookups;
 }
@@ -12,7 +12,12 @@
 //===----------------------------------------------------------------------===//
 
 #include "vlang/Basic/FileSystemStatCache.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/Path.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Support/system_error.h"
+#include <ctime>
 #include <fcntl.h>
 
 // FIXME: This is terrible, we need this for ::close.
@@ -122,3 +127,200 @@ MemorizeStatCalls::getStat(const char *Path, struct stat &StatBuf,
   
   return Result;
 }
+
+//===----------------------------------------------------------------------===//
+// PersistentStatCache
+//===----------------------------------------------------------------------===//
+//
+// The cache file is line oriented:
+//
+//   vlang-stat-cache 1
+//   d <inode> <mtime> <absolute directory path>
+//   n <absolute path that does not exist>
+//
+// A 'n' record is only trusted while the 'd' record of its parent directory
+// still matches that directory on disk.
+//
+//===----------------------------------------------------------------------===//
+
+static const char StatCacheSignature[] = "vlang-stat-cache 1";
+
+PersistentStatCache::PersistentStatCache() : NumHits(0), NumMisses(0) {
+  if (llvm::sys::fs::current_path(WorkingDir))
+    WorkingDir.clear();
+}
+
+PersistentStatCache::DirStamp PersistentStatCache::statDir(StringRef Dir) {
+  DirStamp Stamp;
+  struct stat StatBuf;
+  if (::stat(SmallString<128>(Dir).c_str(), &StatBuf) == 0 &&
+      S_ISDIR(StatBuf.st_mode)) {
+    Stamp.Inode = StatBuf.st_ino;
+    Stamp.ModTime = StatBuf.st_mtime;
+    Stamp.Exists = true;
+  }
+  return Stamp;
+}
+
+const PersistentStatCache::DirStamp &
+PersistentStatCache::getCurrentStamp(StringRef Dir) {
+  llvm::StringMap<DirStamp>::iterator Known = CurrentDirs.find(Dir);
+  if (Known != CurrentDirs.end())
+    return Known->second;
+
+  return CurrentDirs.GetOrCreateValue(Dir, statDir(Dir)).getValue();
+}
+
+bool PersistentStatCache::isUnchanged(StringRef Dir) {
+  llvm::StringMap<DirStamp>::iterator Loaded = LoadedDirs.find(Dir);
+  if (Loaded == LoadedDirs.end())
+    return false;
+
+  const DirStamp &Current = getCurrentStamp(Dir);
+  return Current.Exists && Current.Inode == Loaded->second.Inode &&
+         Current.ModTime == Loaded->second.ModTime;
+}
+
+void PersistentStatCache::load(StringRef Path) {
+  OwningPtr<llvm::MemoryBuffer> File;
+  if (llvm::MemoryBuffer::getFile(Path, File))
+    return;
+
+  std::pair<StringRef, StringRef> Line = File->getBuffer().split('\n');
+  if (Line.first != StatCacheSignature)
+    return;
+
+  while (!Line.second.empty()) {
+    Line = Line.second.split('\n');
+    StringRef Record = Line.first;
+
+    if (Record.startswith("n ")) {
+      Missing.GetOrCreateValue(Record.substr(2), false);
+      continue;
+    }
+
+    if (!Record.startswith("d "))
+      continue;
+
+    std::pair<StringRef, StringRef> Inode = Record.substr(2).split(' ');
+    std::pair<StringRef, StringRef> ModTime = Inode.second.split(' ');
+    unsigned long long InodeVal;
+    long long ModTimeVal;
+    if (Inode.first.getAsInteger(10, InodeVal) ||
+        ModTime.first.getAsInteger(10, ModTimeVal) || ModTime.second.empty())
+      continue;
+
+    DirStamp &Stamp = LoadedDirs[ModTime.second];
+    Stamp.Inode = InodeVal;
+    Stamp.ModTime = ModTimeVal;
+    Stamp.Exists = true;
+  }
+}
+
+bool PersistentStatCache::save(StringRef Path, std::string &Error) {
+  // A directory modified within the last second may be modified again
+  // without its mtime changing, so its stamp can't be trusted yet.
+  time_t Now = ::time(0);
+
+  // Pick the stamp to record for every directory: the one observed by this
+  // run if there is one, otherwise the one we loaded.
+  llvm::StringMap<DirStamp> Dirs;
+  for (llvm::StringMap<DirStamp>::iterator I = LoadedDirs.begin(),
+         E = LoadedDirs.end(); I != E; ++I)
+    if (!CurrentDirs.count(I->getKey()))
+      Dirs[I->getKey()] = I->second;
+  for (llvm::StringMap<DirStamp>::iterator I = CurrentDirs.begin(),
+         E = CurrentDirs.end(); I != E; ++I)
+    if (I->second.Exists && I->second.ModTime < Now - 1)
+      Dirs[I->getKey()] = I->second;
+
+  SmallString<128> TempPath;
+  int FD;
+  if (llvm::error_code EC =
+        llvm::sys::fs::unique_file(Path + ".tmp-%%%%%%%%", FD, TempPath)) {
+    Error = EC.message();
+    return true;
+  }
+
+  {
+    llvm::raw_fd_ostream OS(FD, /*shouldClose=*/true);
+    OS << StatCacheSignature << '\n';
+    for (llvm::StringMap<DirStamp>::iterator I = Dirs.begin(),
+           E = Dirs.end(); I != E; ++I)
+      OS << "d " << (unsigned long long)I->second.Inode << ' '
+         << (long long)I->second.ModTime << ' ' << I->getKey() << '\n';
+
+    for (llvm::StringMap<bool>::iterator I = Missing.begin(),
+           E = Missing.end(); I != E; ++I) {
+      StringRef Dir = llvm::sys::path::parent_path(I->getKey());
+      if (!Dirs.count(Dir))
+        continue;
+      // A miss we only loaded is stale if its directory changed since.
+      if (!I->second && CurrentDirs.count(Dir) && !isUnchanged(Dir))
+        continue;
+      OS << "n " << I->getKey() << '\n';
+    }
+
+    if (OS.has_error()) {
+      Error = "unable to write stat cache";
+      OS.clear_error();
+      bool Existed;
+      llvm::sys::fs::remove(TempPath.str(), Existed);
+      return true;
+    }
+  }
+
+  if (llvm::error_code EC = llvm::sys::fs::rename(TempPath.str(), Path)) {
+    Error = EC.message();
+    bool Existed;
+    llvm::sys::fs::remove(TempPath.str(), Existed);
+    return true;
+  }
+  return false;
+}
+
+PersistentStatCache::LookupResult
+PersistentStatCache::getStat(const char *Path, struct stat &StatBuf,
+                             bool isFile, int *FileDescriptor) {
+  SmallString<128> AbsPath;
+  if (!llvm::sys::path::is_absolute(Path) && !WorkingDir.empty())
+    AbsPath = WorkingDir;
+  llvm::sys::path::append(AbsPath, Path);
+  StringRef Dir = llvm::sys::path::parent_path(AbsPath.str());
+
+  // Known not to exist, and nothing was added to its directory since.
+  if (Missing.count(AbsPath.str()) && isUnchanged(Dir)) {
+    ++NumHits;
+    return CacheMissing;
+  }
+  ++NumMisses;
+
+  // Stamp the directory before the probe, so that a file created after the
+  // stamp changes the directory's modification time.
+  DirStamp Before;
+  if (!Dir.empty())
+    Before = getCurrentStamp(Dir);
+
+  LookupResult Result = statChained(Path, StatBuf, isFile, FileDescriptor);
+
+  if (Result == CacheMissing) {
+    // Only remember the miss if the directory did not change during the
+    // probe; otherwise the stamp may already include the file it missed.
+    if (Before.Exists) {
+      DirStamp After = statDir(Dir);
+      if (After.Exists && After.Inode == Before.Inode &&
+          After.ModTime == Before.ModTime)
+        Missing[AbsPath.str()] = true;
+    }
+    return Result;
+  }
+
+  Missing.erase(AbsPath.str());
+  if (S_ISDIR(StatBuf.st_mode)) {
+    DirStamp &Stamp = CurrentDirs[AbsPath.str()];
+    Stamp.Inode = StatBuf.st_ino;
+    Stamp.ModTime = StatBuf.st_mtime;
+    Stamp.Exists = true;
+  }
+  return Result;
+}
@@ -14,6 +14,7 @@
 
 #include "vlang/Basic/IdentifierTable.h"
 #include "vlang/Basic/CharInfo.h"
+#include "vlang/Basic/KeywordTable.h"
 #include "vlang/Basic/LangOptions.h"
 #include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/FoldingSet.h"
@@ -66,28 +67,21 @@ ExternalIdentifierLookup::~ExternalIdentifierLookup() {}
 IdentifierTable::IdentifierTable(const LangOptions &LangOpts,
 								 IdentifierInfoLookup* externalLookup)
 								 : HashTable(8192), // Start with space for 8K identifiers.
-								 ExternalLookup(externalLookup) {
-
-  // Populate the identifier table with info about keywords for the current
-  // language.
-  AddKeywords(LangOpts);
-
+								 ExternalLookup(externalLookup),
+								 KeywordMask(keywords::getKeywordMask(LangOpts)),
+								 KeywordInfos(keywords::getNumKeywords()) {
+	// Keywords are not added up front; get() classifies each identifier
+	// against the keyword table the first time it is seen.
 }
 
 //===----------------------------------------------------------------------===//
 // Language Keyword Implementation
 //===----------------------------------------------------------------------===//
 
-// Constants for TokenKinds.def
+// Constants for TokenKinds.def, generated from Keywords.td.
 namespace {
-	enum {
-		KEYV2001  = 0x01,
-		KEYV2005  = 0x02,
-		KEYSV2005 = 0x04,
-		KEYSV2009 = 0x08,
-		KEYSV2012 = 0x10,
-		KEYALL = 0xffff // Because KEYNOMS is used to exclude.
-	};
+#define GET_KEYWORD_FLAGS
+#include "vlang/Basic/KeywordHash.inc"
 }
 
 /// AddKeyword - This method is used to associate a token ID with specific
@@ -115,7 +109,9 @@ static void AddKeyword(StringRef Keyword,
 	IdentifierInfo &Info = Table.get(Keyword, TokenCode);
 }
 
-/// AddKeywords - Add all keywords to the symbol table.
+/// AddKeywords - Add all keywords to the symbol table.  get() already
+/// classifies keywords as they are first seen; this is only needed by clients
+/// that iterate the table and expect to find every keyword in it.
 ///
 void IdentifierTable::AddKeywords(const LangOptions &LangOpts) {
 	// Add keywords and tokens for the current language.
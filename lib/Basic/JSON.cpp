@@ -0,0 +1,34 @@
+//===--- JSON.cpp - Helpers for writing JSON ------------------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "vlang/Basic/JSON.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/raw_ostream.h"
+
+using namespace vlang;
+
+void vlang::writeJSONString(raw_ostream &OS, StringRef Str) {
+  OS << '"';
+  for (StringRef::iterator I = Str.begin(), E = Str.end(); I != E; ++I) {
+    unsigned char C = *I;
+    switch (C) {
+    case '"':  OS << "\\\""; break;
+    case '\\': OS << "\\\\"; break;
+    case '\n': OS << "\\n"; break;
+    case '\t': OS << "\\t"; break;
+    default:
+      if (C < 0x20)
+        OS << "\\u" << llvm::format("%04x", C);
+      else
+        OS << (char)C;
+      break;
+    }
+  }
+  OS << '"';
+}
@@ -0,0 +1,70 @@
+//===--- KeywordTable.cpp - Perfect hash lookup of keywords ---------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements keyword classification with the perfect hash table
+// that vlang-tblgen generates from TokenKinds.def and Keywords.td.
+//
+//===----------------------------------------------------------------------===//
+
+#include "vlang/Basic/KeywordTable.h"
+#include "vlang/Basic/LangOptions.h"
+#include <cstring>
+
+using namespace vlang;
+
+namespace {
+/// KeywordEntry - One slot of the generated table, holding one keyword.
+struct KeywordEntry {
+  const char *Name;
+  uint8_t Length;
+  uint16_t Kind;
+  uint16_t Flags;
+};
+
+#define GET_KEYWORD_FLAGS
+#include "vlang/Basic/KeywordHash.inc"
+}
+
+#define GET_KEYWORD_TABLE
+#include "vlang/Basic/KeywordHash.inc"
+
+unsigned keywords::getKeywordMask(const LangOptions &LangOpts) {
+  return getLangOptsKeywordMask(LangOpts);
+}
+
+unsigned keywords::getNumKeywords() {
+  return KeywordTableSize;
+}
+
+int keywords::lookupSlot(StringRef Name, unsigned Mask, tok::TokenKind &Kind) {
+  if (Name.empty() || Name.size() > KeywordMaxLength)
+    return -1;
+
+  uint32_t H = hashName(Name);
+  uint32_t D = KeywordDisplacements[reduce(H, KeywordNumBuckets)];
+  uint32_t Slot = reduce(hashSlot(H, D), KeywordTableSize);
+  const KeywordEntry &E = KeywordEntries[Slot];
+  if (E.Length != Name.size() || memcmp(E.Name, Name.data(), E.Length) != 0)
+    return -1;
+
+  // Each keyword is enabled by exactly one flag, or by all of them.
+  if (E.Flags != KEYALL && !(E.Flags & Mask))
+    return -1;
+  Kind = (tok::TokenKind)E.Kind;
+  return Slot;
+}
+
+tok::TokenKind keywords::lookupDirective(StringRef Name) {
+  char Buf[32];
+  if (Name.size() >= sizeof(Buf))
+    return tok::identifier;
+  Buf[0] = '`';
+  memcpy(Buf + 1, Name.data(), Name.size());
+  return lookup(StringRef(Buf, Name.size() + 1), KEYALL);
+}
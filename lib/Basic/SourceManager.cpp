@@ -98,9 +98,17 @@ const llvm::MemoryBuffer *ContentCache::getBuffer(DiagnosticsEngine &Diag,
 
   std::string ErrorStr;
   bool isVolatile = SM.userFilesAreVolatile() && !IsSystemFile;
-  Buffer.setPointer(SM.getFileManager().getBufferForFile(ContentsEntry,
-                                                         &ErrorStr,
-                                                         isVolatile));
+  FileManager &FileMgr = SM.getFileManager();
+
+  // If the FileManager shares file contents between compilations, borrow its
+  // copy rather than reading our own.  Volatile files are always re-read.
+  bool isShared = FileMgr.sharesFileBuffers() && !isVolatile;
+  if (isShared)
+    Buffer.setPointer(FileMgr.getSharedBufferForFile(ContentsEntry,
+                                                     &ErrorStr));
+  else
+    Buffer.setPointer(FileMgr.getBufferForFile(ContentsEntry, &ErrorStr,
+                                               isVolatile));
 
   // If we were unable to open the file, then we are in an inconsistent
   // situation where the content cache referenced a file which no longer
@@ -132,6 +140,10 @@ const llvm::MemoryBuffer *ContentCache::getBuffer(DiagnosticsEngine &Diag,
     if (Invalid) *Invalid = true;
     return Buffer.getPointer();
   }
+
+  // The FileManager owns shared buffers.
+  if (isShared)
+    Buffer.setInt(Buffer.getInt() | DoNotFreeFlag);
   
   // Check that the file's size is the same as in the file entry (which may
   // have come from a stat cache).
@@ -0,0 +1,45 @@
+//===--- Statistics.cpp - Frontend statistics -----------------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "vlang/Basic/Statistics.h"
+#include "llvm/Support/raw_ostream.h"
+#include <cstring>
+
+using namespace vlang;
+
+void StatisticsReport::printJSON(raw_ostream &OS, unsigned Indent) const {
+  SmallVector<const char *, 8> Groups;
+  for (unsigned I = 0, E = Counters.size(); I != E; ++I) {
+    const char *Group = Counters[I].Group;
+    bool Seen = false;
+    for (unsigned J = 0, JE = Groups.size(); J != JE && !Seen; ++J)
+      Seen = !strcmp(Groups[J], Group);
+    if (!Seen)
+      Groups.push_back(Group);
+  }
+
+  OS << "{";
+  for (unsigned G = 0, GE = Groups.size(); G != GE; ++G) {
+    OS << (G ? ",\n" : "\n");
+    OS.indent(Indent + 2) << '"' << Groups[G] << "\": {";
+    bool First = true;
+    for (unsigned I = 0, E = Counters.size(); I != E; ++I) {
+      if (strcmp(Counters[I].Group, Groups[G]))
+        continue;
+      OS << (First ? "\n" : ",\n");
+      OS.indent(Indent + 4) << '"' << Counters[I].Name << "\": "
+                            << Counters[I].Value;
+      First = false;
+    }
+    OS << "\n";
+    OS.indent(Indent + 2) << "}";
+  }
+  OS << "\n";
+  OS.indent(Indent) << "}";
+}
@@ -0,0 +1,92 @@
+//===--- TimeTrace.cpp - Chrome trace time profiling ----------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// Regions shorter than the granularity are the common case, for macro
+// expansions in particular, and are usually the last one that began.  They
+// are popped right away, so the entry vector only grows with the regions
+// that are kept.
+//
+//===----------------------------------------------------------------------===//
+
+#include "vlang/Basic/TimeTrace.h"
+#include "vlang/Basic/JSON.h"
+#include "llvm/Support/raw_ostream.h"
+
+using namespace vlang;
+
+/// getEpoch - The time all timestamps are relative to.
+static std::chrono::steady_clock::time_point getEpoch() {
+  static const std::chrono::steady_clock::time_point Epoch =
+    std::chrono::steady_clock::now();
+  return Epoch;
+}
+
+TimeTraceProfiler::TimeTraceProfiler(unsigned GranularityUS)
+  : Granularity(std::chrono::microseconds(GranularityUS)) {
+  getEpoch();
+}
+
+unsigned TimeTraceProfiler::begin(const char *Name, StringRef Detail) {
+  Entry E;
+  E.Name = Name;
+  E.Detail = Detail;
+  E.Open = true;
+  E.Dropped = false;
+  Entries.push_back(E);
+  // Read the clock last, so the copies above are not part of the region.
+  Entries.back().Start = Clock::now();
+  return Entries.size() - 1;
+}
+
+void TimeTraceProfiler::end(unsigned ID) {
+  assert(ID < Entries.size() && Entries[ID].Open && "Region is not open");
+  Entry &E = Entries[ID];
+  E.Duration = Clock::now() - E.Start;
+  E.Open = false;
+  if (E.Duration >= Granularity)
+    return;
+
+  E.Dropped = true;
+  while (!Entries.empty() && Entries.back().Dropped)
+    Entries.pop_back();
+}
+
+void TimeTraceProfiler::setDetail(unsigned ID, StringRef Detail) {
+  assert(ID < Entries.size() && Entries[ID].Open && "Region is not open");
+  Entries[ID].Detail = Detail;
+}
+
+void TimeTraceProfiler::endAll() {
+  for (unsigned I = Entries.size(); I != 0; --I)
+    if (I <= Entries.size() && Entries[I - 1].Open)
+      end(I - 1);
+}
+
+void TimeTraceProfiler::writeEvents(raw_ostream &OS, unsigned Tid) const {
+  using std::chrono::duration_cast;
+  using std::chrono::microseconds;
+
+  for (std::vector<Entry>::const_iterator I = Entries.begin(),
+       E = Entries.end(); I != E; ++I) {
+    if (I->Open || I->Dropped)
+      continue;
+    long long Start =
+      duration_cast<microseconds>(I->Start - getEpoch()).count();
+    long long Duration = duration_cast<microseconds>(I->Duration).count();
+    OS << ",\n{\"pid\":1,\"tid\":" << Tid << ",\"ph\":\"X\",\"ts\":" << Start
+       << ",\"dur\":" << Duration << ",\"name\":";
+    writeJSONString(OS, I->Name);
+    if (!I->Detail.empty()) {
+      OS << ",\"args\":{\"detail\":";
+      writeJSONString(OS, I->Detail);
+      OS << "}";
+    }
+    OS << "}";
+  }
+}
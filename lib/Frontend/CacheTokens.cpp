@@ -0,0 +1,113 @@
+//===--- CacheTokens.cpp - Caching of lexer tokens for PTH support --------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This provides a possible implementation of PTH support for Vlang that is
+// based on caching lexed tokens and identifiers.
+//
+//===----------------------------------------------------------------------===//
+
+#include "vlang/Frontend/Utils.h"
+#include "vlang/Basic/FileManager.h"
+#include "vlang/Basic/SourceManager.h"
+#include "vlang/Lex/PTHManager.h"
+#include "vlang/Lex/Preprocessor.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/raw_ostream.h"
+#include <algorithm>
+#include <cstring>
+#include <vector>
+using namespace vlang;
+
+namespace {
+/// CachedFile - The raw tokens of one source file.
+struct CachedFile {
+  const FileEntry *File;
+  std::vector<PTHToken> Tokens;
+
+  bool operator<(const CachedFile &RHS) const {
+    return strcmp(File->getName(), RHS.File->getName()) < 0;
+  }
+};
+}
+
+static void Pad(raw_ostream &OS, uint64_t &Off, unsigned Align) {
+  for (; Off % Align; ++Off)
+    OS << '\0';
+}
+
+void vlang::CacheTokens(Preprocessor &PP, llvm::raw_fd_ostream *OS) {
+  // Preprocess the main file, so that every file it includes (under the
+  // current set of defines) gets entered into the SourceManager.
+  PP.EnterMainSourceFile();
+  Token Tok;
+  do {
+    PP.Lex(Tok);
+  } while (Tok.isNot(tok::eof));
+
+  // Tokenize each file that was read.
+  SourceManager &SM = PP.getSourceManager();
+  std::vector<CachedFile> Files;
+  for (SourceManager::fileinfo_iterator I = SM.fileinfo_begin(),
+         E = SM.fileinfo_end(); I != E; ++I) {
+    const llvm::MemoryBuffer *Buffer = I->second->getRawBuffer();
+    if (!I->first || !Buffer || I->second->isBufferInvalid() ||
+        Buffer->getBufferSize() != (size_t)I->first->getSize() ||
+        Buffer->getBufferSize() > ~0U)
+      continue;
+
+    Files.push_back(CachedFile());
+    Files.back().File = I->first;
+    PTHManager::LexRawTokens(Buffer, PP.getLangOpts(), Files.back().Tokens);
+  }
+
+  // Keep the output independent of hash table order.
+  std::sort(Files.begin(), Files.end());
+
+  // Lay out the file: header, file records, names, then the token arrays.
+  PTHFileHeader Header;
+  memcpy(Header.Magic, "VPTH", 4);
+  Header.Version = PTHVersion;
+  Header.NumFiles = Files.size();
+  Header.Reserved = 0;
+
+  std::vector<PTHFileRecord> Records(Files.size());
+  uint64_t Off = sizeof(Header) + Files.size() * sizeof(PTHFileRecord);
+  for (unsigned i = 0, e = Files.size(); i != e; ++i) {
+    const FileEntry *FE = Files[i].File;
+    Records[i].Size = FE->getSize();
+    Records[i].ModTime = FE->getModificationTime();
+    Records[i].NameOffset = Off;
+    Records[i].NameLength = strlen(FE->getName());
+    Off += Records[i].NameLength + 1;
+  }
+  Off = (Off + 3) & ~uint64_t(3);
+  for (unsigned i = 0, e = Files.size(); i != e; ++i) {
+    Records[i].TokenOffset = Off;
+    Records[i].NumTokens = Files[i].Tokens.size();
+    Off += Files[i].Tokens.size() * sizeof(PTHToken);
+  }
+
+  // Emit it.
+  Off = 0;
+  OS->write(reinterpret_cast<const char *>(&Header), sizeof(Header));
+  if (!Records.empty())
+    OS->write(reinterpret_cast<const char *>(&Records[0]),
+              Records.size() * sizeof(PTHFileRecord));
+  Off += sizeof(Header) + Records.size() * sizeof(PTHFileRecord);
+  for (unsigned i = 0, e = Files.size(); i != e; ++i) {
+    OS->write(Files[i].File->getName(), Records[i].NameLength + 1);
+    Off += Records[i].NameLength + 1;
+  }
+  Pad(*OS, Off, 4);
+  for (unsigned i = 0, e = Files.size(); i != e; ++i)
+    if (!Files[i].Tokens.empty())
+      OS->write(reinterpret_cast<const char *>(&Files[i].Tokens[0]),
+                Files[i].Tokens.size() * sizeof(PTHToken));
+  OS->flush();
+}
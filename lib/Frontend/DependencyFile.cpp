@@ -0,0 +1,304 @@
+//===--- DependencyFile.cpp - Generate dependency file --------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This code generates dependency files in the make format.  Files entered or
+// skipped by `include are collected as the preprocessor goes, and the file is
+// written once, when the main file ends.  ScanDependencyFile collects them
+// with a DependencyScanner instead, without preprocessing.
+//
+//===----------------------------------------------------------------------===//
+
+#include "vlang/Frontend/Utils.h"
+#include "vlang/Basic/FileManager.h"
+#include "vlang/Basic/SourceManager.h"
+#include "vlang/Frontend/DependencyOutputOptions.h"
+#include "vlang/Frontend/FrontendDiagnostic.h"
+#include "vlang/Lex/DependencyScanner.h"
+#include "vlang/Lex/PPCallbacks.h"
+#include "vlang/Lex/Preprocessor.h"
+#include "vlang/Lex/PreprocessorOptions.h"
+#include "llvm/ADT/StringSet.h"
+#include "llvm/Support/PathV2.h"
+#include "llvm/Support/raw_ostream.h"
+
+using namespace vlang;
+
+namespace {
+/// DependencyCollector - The files a dependency rule lists, each once and in
+/// the order they were first seen, and the rule itself.
+class DependencyCollector {
+  std::vector<std::string> Files;
+  llvm::StringSet<> FilesSet;
+  std::string OutputFile;
+  std::vector<std::string> Targets;
+  bool IncludeSystemHeaders;
+  bool PhonyTarget;
+  bool AddMissingHeaderDeps;
+  /// MissingHeader - The first `include file that was not found, without
+  /// -MG.
+  std::string MissingHeader;
+
+  bool FileMatchesDepCriteria(const char *Filename,
+                              SrcMgr::CharacteristicKind FileType);
+  void AddFilename(StringRef Filename);
+
+public:
+  explicit DependencyCollector(const DependencyOutputOptions &Opts)
+    : OutputFile(Opts.OutputFile), Targets(Opts.Targets),
+      IncludeSystemHeaders(Opts.IncludeSystemHeaders),
+      PhonyTarget(Opts.UsePhonyTargets),
+      AddMissingHeaderDeps(Opts.AddMissingHeaderDeps) {}
+
+  void AddFile(const FileEntry *File, SrcMgr::CharacteristicKind FileType);
+  void AddMissingFile(StringRef Filename);
+  void OutputDependencyFile(DiagnosticsEngine &Diags);
+};
+
+class DependencyFileCallback : public PPCallbacks {
+  const Preprocessor *PP;
+  DependencyCollector Deps;
+
+public:
+  DependencyFileCallback(const Preprocessor *_PP,
+                         const DependencyOutputOptions &Opts)
+    : PP(_PP), Deps(Opts) {}
+
+  virtual void FileChanged(SourceLocation Loc, FileChangeReason Reason,
+                           SrcMgr::CharacteristicKind FileType,
+                           FileID PrevFID);
+  virtual void FileSkipped(const FileEntry &SkippedFile,
+                           const Token &FilenameTok,
+                           SrcMgr::CharacteristicKind FileType);
+  virtual void InclusionDirective(SourceLocation HashLoc,
+                                  const Token &IncludeTok,
+                                  StringRef FileName,
+                                  bool IsAngled,
+                                  CharSourceRange FilenameRange,
+                                  const FileEntry *File,
+                                  StringRef SearchPath,
+                                  StringRef RelativePath);
+
+  virtual void EndOfMainFile() {
+    Deps.OutputDependencyFile(PP->getDiagnostics());
+  }
+};
+}
+
+void vlang::AttachDependencyFileGen(Preprocessor &PP,
+                                    const DependencyOutputOptions &Opts) {
+  assert(!Opts.Targets.empty() && "Dependency file needs a target");
+
+  // Disable the "file not found" diagnostic if the -MG option was given.
+  if (Opts.AddMissingHeaderDeps)
+    PP.SetSuppressIncludeNotFoundError(true);
+
+  PP.addPPCallbacks(new DependencyFileCallback(&PP, Opts));
+}
+
+void vlang::ScanDependencyFile(HeaderSearch &HeaderInfo,
+                               const FileEntry *MainFile,
+                               const PreprocessorOptions &PPOpts,
+                               const DependencyOutputOptions &Opts,
+                               DiagnosticsEngine &Diags) {
+  assert(!Opts.Targets.empty() && "Dependency file needs a target");
+
+  DependencyScanner Scanner(HeaderInfo, Diags);
+  Scanner.SetSuppressIncludeNotFoundError(Opts.AddMissingHeaderDeps);
+
+  // "X" defines X as 1 and "X=Y" as Y, in the order given, as
+  // InitializePreprocessor does.
+  for (unsigned i = 0, e = PPOpts.Macros.size(); i != e; ++i) {
+    StringRef Macro = PPOpts.Macros[i].first;
+    std::pair<StringRef, StringRef> MacroPair = Macro.split('=');
+    if (PPOpts.Macros[i].second)  // isUndef
+      Scanner.undefineMacro(Macro);
+    else if (MacroPair.first.size() != Macro.size())
+      Scanner.defineMacro(MacroPair.first, MacroPair.second);
+    else
+      Scanner.defineMacro(Macro);
+  }
+  Scanner.scan(MainFile);
+
+  DependencyCollector Deps(Opts);
+  for (DependencyScanner::file_iterator I = Scanner.files_begin(),
+         E = Scanner.files_end(); I != E; ++I)
+    Deps.AddFile(I->File, I->FileType);
+  for (DependencyScanner::missing_iterator I = Scanner.missing_begin(),
+         E = Scanner.missing_end(); I != E; ++I)
+    Deps.AddMissingFile(*I);
+  Deps.OutputDependencyFile(Diags);
+}
+
+/// FileMatchesDepCriteria - Determine whether the given file should be
+/// included in the dependency file.
+bool DependencyCollector::FileMatchesDepCriteria(const char *Filename,
+                                          SrcMgr::CharacteristicKind FileType) {
+  if (strcmp("<built-in>", Filename) == 0)
+    return false;
+
+  if (IncludeSystemHeaders)
+    return true;
+
+  return FileType == SrcMgr::C_User;
+}
+
+/// FileChanged - Every file entered is a dependency, the main file first.
+void DependencyFileCallback::FileChanged(SourceLocation Loc,
+                                         FileChangeReason Reason,
+                                         SrcMgr::CharacteristicKind FileType,
+                                         FileID PrevFID) {
+  if (Reason != PPCallbacks::EnterFile)
+    return;
+
+  // Dependency generation really does want to go all the way to the file
+  // entry for a source location to find out what is depended on.  We do not
+  // want `line markers to affect dependency generation!
+  SourceManager &SM = PP->getSourceManager();
+  const FileEntry *FE =
+    SM.getFileEntryForID(SM.getFileID(SM.getExpansionLoc(Loc)));
+  if (FE)
+    Deps.AddFile(FE, FileType);
+}
+
+/// FileSkipped - An `include the include guard optimization skips is still a
+/// dependency.  The preprocessor passes the skipped file here.
+void DependencyFileCallback::FileSkipped(const FileEntry &SkippedFile,
+                                         const Token &FilenameTok,
+                                         SrcMgr::CharacteristicKind FileType) {
+  Deps.AddFile(&SkippedFile, FileType);
+}
+
+void DependencyFileCallback::InclusionDirective(SourceLocation HashLoc,
+                                                const Token &IncludeTok,
+                                                StringRef FileName,
+                                                bool IsAngled,
+                                                CharSourceRange FilenameRange,
+                                                const FileEntry *File,
+                                                StringRef SearchPath,
+                                                StringRef RelativePath) {
+  if (!File)
+    Deps.AddMissingFile(FileName);
+}
+
+/// AddMissingFile - A header that does not exist yet may be generated by the
+/// build; -MG lists it as written so the build knows to make it.  Without
+/// -MG, no dependency file is written.
+void DependencyCollector::AddMissingFile(StringRef Filename) {
+  if (AddMissingHeaderDeps)
+    AddFilename(Filename);
+  else if (MissingHeader.empty())
+    MissingHeader = Filename;
+}
+
+void DependencyCollector::AddFile(const FileEntry *File,
+                                  SrcMgr::CharacteristicKind FileType) {
+  StringRef Filename = File->getName();
+  if (!FileMatchesDepCriteria(Filename.data(), FileType))
+    return;
+
+  // Remove leading "./" (or ".//" or "././" etc.)
+  while (Filename.size() > 2 && Filename[0] == '.' &&
+         llvm::sys::path::is_separator(Filename[1])) {
+    Filename = Filename.substr(1);
+    while (llvm::sys::path::is_separator(Filename[0]))
+      Filename = Filename.substr(1);
+  }
+
+  AddFilename(Filename);
+}
+
+void DependencyCollector::AddFilename(StringRef Filename) {
+  if (FilesSet.insert(Filename))
+    Files.push_back(Filename);
+}
+
+/// PrintFilename - GCC escapes spaces, but apparently not ' or " or other
+/// scary characters.
+static void PrintFilename(raw_ostream &OS, StringRef Filename) {
+  for (unsigned i = 0, e = Filename.size(); i != e; ++i) {
+    if (Filename[i] == ' ' || Filename[i] == '#')
+      OS << '\\';
+    else if (Filename[i] == '$') // $ is escaped by $$.
+      OS << '$';
+    OS << Filename[i];
+  }
+}
+
+void DependencyCollector::OutputDependencyFile(DiagnosticsEngine &Diags) {
+  // A rule without the missing header would be wrong; leave whatever file
+  // is there alone and say why.
+  if (!MissingHeader.empty()) {
+    Diags.Report(diag::warn_fe_dependency_file_not_written)
+      << OutputFile << MissingHeader;
+    return;
+  }
+
+  std::string Err;
+  llvm::raw_fd_ostream OS(OutputFile.c_str(), Err);
+  if (!Err.empty()) {
+    Diags.Report(diag::err_fe_error_opening)
+      << OutputFile << Err;
+    return;
+  }
+
+  // Write out the dependency targets, trying to avoid overly long
+  // lines when possible. We try our best to emit exactly the same
+  // dependency file as GCC (4.2), assuming the included files are the
+  // same.
+  const unsigned MaxColumns = 75;
+  unsigned Columns = 0;
+
+  for (std::vector<std::string>::iterator
+         I = Targets.begin(), E = Targets.end(); I != E; ++I) {
+    unsigned N = I->length();
+    if (Columns == 0) {
+      Columns += N;
+    } else if (Columns + N + 2 > MaxColumns) {
+      Columns = N + 2;
+      OS << " \\\n  ";
+    } else {
+      Columns += N + 1;
+      OS << ' ';
+    }
+    // Targets already quoted as needed.
+    OS << *I;
+  }
+
+  OS << ':';
+  Columns += 1;
+
+  // Now add each dependency in the order it was seen, but avoiding
+  // duplicates.
+  for (std::vector<std::string>::iterator I = Files.begin(),
+         E = Files.end(); I != E; ++I) {
+    // Start a new line if this would exceed the column limit. Make
+    // sure to leave space for a trailing " \" in case we need to
+    // break the line on the next iteration.
+    unsigned N = I->length();
+    if (Columns + (N + 1) + 2 > MaxColumns) {
+      OS << " \\\n ";
+      Columns = 2;
+    }
+    OS << ' ';
+    PrintFilename(OS, *I);
+    Columns += N + 1;
+  }
+  OS << '\n';
+
+  // Create phony targets if requested.
+  if (PhonyTarget && !Files.empty()) {
+    // Skip the first entry, this is always the input file itself.
+    for (std::vector<std::string>::iterator I = Files.begin() + 1,
+           E = Files.end(); I != E; ++I) {
+      OS << '\n';
+      PrintFilename(OS, *I);
+      OS << ":\n";
+    }
+  }
+}
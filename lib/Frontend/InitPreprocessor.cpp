@@ -49,11 +49,11 @@ static void DefineBuiltinMacro(MacroBuilder &Builder, StringRef Macro,
   }
 }
 
-/// AddImplicitInclude - Add an implicit \#include of the specified file to the
+/// AddImplicitInclude - Add an implicit \`include of the specified file to the
 /// predefines buffer.
 static void AddImplicitInclude(MacroBuilder &Builder, StringRef File,
                                FileManager &FileMgr) {
-  Builder.append(Twine("#include \"") +
+  Builder.append(Twine("`include \"") +
                  HeaderSearch::NormalizeDashIncludePath(File, FileMgr) + "\"");
 }
 
@@ -265,16 +265,11 @@ void vlang::InitializePreprocessor(Preprocessor &PP,
   InitializeFileRemapping(PP.getDiagnostics(), PP.getSourceManager(),
                           PP.getFileManager(), InitOpts);
 
-  // Emit line markers for various builtin sections of the file.  We don't do
-  // this in asm preprocessor mode, because "# 4" is not a line marker directive
-  // in this mode.
-  Builder.append("# 1 \"<built-in>\" 3");
+  // The buffer is lexed as Verilog, which has no line markers, so it is
+  // reported as "<built-in>" throughout.  It is only entered if something
+  // is added to it.
 
-  // Add on the predefines from the driver.  Wrap in a #line directive to report
-  // that they come from the command line.
-  Builder.append("# 1 \"<command line>\" 1");
-
-  // Process #define's and #undef's in the order they are given.
+  // Process `define's and `undef's in the order they are given.
   for (unsigned i = 0, e = InitOpts.Macros.size(); i != e; ++i) {
     if (InitOpts.Macros[i].second)  // isUndef
       Builder.undefineMacro(InitOpts.Macros[i].first);
@@ -295,9 +290,6 @@ void vlang::InitializePreprocessor(Preprocessor &PP,
     AddImplicitInclude(Builder, Path, PP.getFileManager());
   }
 
-  // Exit the command line and go back to <built-in> (2 is LC_LEAVE).
-  Builder.append("# 1 \"<built-in>\" 2");
-
   // Instruct the preprocessor to skip the preamble.
   PP.setSkipMainFilePreamble(InitOpts.PrecompiledPreambleBytes.first,
                              InitOpts.PrecompiledPreambleBytes.second);
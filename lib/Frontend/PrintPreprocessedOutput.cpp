@@ -0,0 +1,314 @@
+//===--- PrintPreprocessedOutput.cpp - Implement the -E mode --------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This code simply runs the preprocessor on the input file and prints out the
+// result.  This is the traditional behavior of the -E option.
+//
+// The output is meant to be read by other tools, not people, and is written
+// as fast as the preprocessor produces it: spellings are copied straight from
+// the identifier table, the punctuator table or the source buffers, and only
+// the whitespace needed to keep tokens apart and lines in step is written.
+//
+//===----------------------------------------------------------------------===//
+
+#include "vlang/Frontend/Utils.h"
+#include "vlang/Basic/CharInfo.h"
+#include "vlang/Basic/SourceManager.h"
+#include "vlang/Frontend/PreprocessorOutputOptions.h"
+#include "vlang/Lex/PPCallbacks.h"
+#include "vlang/Lex/Preprocessor.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/Support/raw_ostream.h"
+#include <algorithm>
+#include <cstring>
+using namespace vlang;
+
+/// PreferredOutputBufferSize - Preprocessed output is written in blocks of at
+/// least this many bytes, rather than the few kilobytes of a default stream.
+static const size_t PreferredOutputBufferSize = 1 << 20;
+
+namespace {
+class PrintPPOutputPPCallbacks : public PPCallbacks {
+  Preprocessor &PP;
+  SourceManager &SM;
+  raw_ostream &OS;
+  unsigned CurLine;
+  unsigned CurrentIncludeDepth;
+  bool EmittedTokensOnThisLine;
+  bool DisableLineMarkers;
+  SmallString<512> CurFilename;
+
+public:
+  PrintPPOutputPPCallbacks(Preprocessor &pp, raw_ostream &os, bool lineMarkers)
+    : PP(pp), SM(PP.getSourceManager()), OS(os), CurLine(0),
+      CurrentIncludeDepth(0), EmittedTokensOnThisLine(false),
+      DisableLineMarkers(!lineMarkers) {}
+
+  void setEmittedTokensOnThisLine() { EmittedTokensOnThisLine = true; }
+
+  virtual void FileChanged(SourceLocation Loc, FileChangeReason Reason,
+                           SrcMgr::CharacteristicKind FileType,
+                           FileID PrevFID);
+  virtual void Timescale(SourceLocation Loc, const Token &UnitTok,
+                         const Token &PrecisionTok);
+
+  /// HandleFirstTokOnLine - Move the output to the line of \p Tok, which the
+  /// lexer found at the start of a line.
+  void HandleFirstTokOnLine(Token &Tok);
+
+  /// HandleNewlinesInToken - Keep the line count in step with the newlines a
+  /// comment token spans.
+  void HandleNewlinesInToken(const char *TokStr, unsigned Len);
+
+  bool startNewLineIfNeeded();
+  void MoveToLine(SourceLocation Loc);
+  void WriteLineMarker(unsigned LineNo, unsigned Level);
+};
+} // end anonymous namespace
+
+/// WriteLineMarker - Write a `line directive, which sets the line and file
+/// the next output line is reported at.  Level is 1 on entering an `include
+/// file, 2 on returning from one, and 0 otherwise.
+void PrintPPOutputPPCallbacks::WriteLineMarker(unsigned LineNo,
+                                               unsigned Level) {
+  startNewLineIfNeeded();
+  OS << "`line " << LineNo << " \"";
+  OS.write(CurFilename.data(), CurFilename.size());
+  OS << "\" " << Level << '\n';
+}
+
+/// startNewLineIfNeeded - End the current output line if tokens were written
+/// on it.  Returns true if a newline was written.
+bool PrintPPOutputPPCallbacks::startNewLineIfNeeded() {
+  if (!EmittedTokensOnThisLine)
+    return false;
+  OS << '\n';
+  EmittedTokensOnThisLine = false;
+  ++CurLine;
+  return true;
+}
+
+/// MoveToLine - Move the output to the source line of \p Loc.  Without line
+/// markers, lines only ever break where the source has a line break, and
+/// blank lines are dropped.  With them, short gaps are kept as blank lines
+/// and longer ones become a marker, so every token is reported on its line.
+void PrintPPOutputPPCallbacks::MoveToLine(SourceLocation Loc) {
+  if (DisableLineMarkers) {
+    startNewLineIfNeeded();
+    return;
+  }
+
+  PresumedLoc PLoc = SM.getPresumedLoc(Loc);
+  if (PLoc.isInvalid())
+    return;
+  unsigned LineNo = PLoc.getLine();
+  if (LineNo == CurLine)
+    return;
+
+  if (EmittedTokensOnThisLine) {
+    OS << '\n';
+    EmittedTokensOnThisLine = false;
+    ++CurLine;
+  }
+  if (LineNo >= CurLine && LineNo - CurLine <= 8) {
+    const char *NewLines = "\n\n\n\n\n\n\n\n";
+    OS.write(NewLines, LineNo - CurLine);
+  } else {
+    WriteLineMarker(LineNo, 0);
+  }
+  CurLine = LineNo;
+}
+
+/// FileChanged - Whenever the preprocessor enters or exits an `include file
+/// this is called.
+void PrintPPOutputPPCallbacks::FileChanged(SourceLocation Loc,
+                                           FileChangeReason Reason,
+                                           SrcMgr::CharacteristicKind FileType,
+                                           FileID PrevFID) {
+  // The command line defines only define macros, and are not part of the
+  // output.
+  FileID PredefinesFID = PP.getPredefinesFileID();
+  if (PredefinesFID.isValid() &&
+      (PrevFID == PredefinesFID ||
+       (Reason == PPCallbacks::EnterFile &&
+        SM.getFileID(Loc) == PredefinesFID)))
+    return;
+
+  unsigned Level;
+  if (Reason == PPCallbacks::EnterFile) {
+    ++CurrentIncludeDepth;
+    Level = CurrentIncludeDepth == 1 ? 0 : 1;
+  } else if (Reason == PPCallbacks::ExitFile) {
+    if (CurrentIncludeDepth)
+      --CurrentIncludeDepth;
+    Level = 2;
+  } else {
+    return;
+  }
+
+  PresumedLoc UserLoc = SM.getPresumedLoc(SM.getExpansionLoc(Loc));
+  if (UserLoc.isInvalid())
+    return;
+
+  startNewLineIfNeeded();
+  CurLine = UserLoc.getLine();
+  CurFilename = UserLoc.getFilename();
+  Lexer::Stringify(CurFilename);
+
+  if (!DisableLineMarkers)
+    WriteLineMarker(CurLine, Level);
+}
+
+/// Timescale - The preprocessor consumes `timescale, but the tools reading
+/// the output need it, so write it back out on its own line.
+void PrintPPOutputPPCallbacks::Timescale(SourceLocation Loc,
+                                         const Token &UnitTok,
+                                         const Token &PrecisionTok) {
+  MoveToLine(Loc);
+  startNewLineIfNeeded();
+  OS << "`timescale " << PP.getSpelling(UnitTok) << " / "
+     << PP.getSpelling(PrecisionTok);
+  EmittedTokensOnThisLine = true;
+}
+
+void PrintPPOutputPPCallbacks::HandleFirstTokOnLine(Token &Tok) {
+  // Tokens expanded from a macro are reported at the line of the expansion.
+  SourceLocation Loc = Tok.getLocation();
+  if (Loc.isMacroID())
+    Loc = SM.getExpansionLoc(Loc);
+  MoveToLine(Loc);
+}
+
+void PrintPPOutputPPCallbacks::HandleNewlinesInToken(const char *TokStr,
+                                                     unsigned Len) {
+  CurLine += std::count(TokStr, TokStr + Len, '\n');
+}
+
+/// isWordChar - Characters that continue an identifier, keyword or number.
+static bool isWordChar(char C) {
+  return isIdentifierBody(C) || C == '\'' || C == '`' || C == '\\';
+}
+
+/// isOperatorChar - Characters that can be part of a multi-character
+/// operator.  Brackets and separators never join with their neighbours.
+static bool isOperatorChar(char C) {
+  switch (C) {
+  case '!': case '%': case '&': case '*': case '+': case '-': case '.':
+  case '/': case ':': case '<': case '=': case '>': case '?': case '@':
+  case '^': case '|': case '~': case '#':
+    return true;
+  default:
+    return false;
+  }
+}
+
+/// AvoidConcat - Return true if a token starting with \p First would lex
+/// together with a preceding token ending in \p PrevLast if no space were
+/// written between them.
+static bool AvoidConcat(char PrevLast, char First) {
+  if (isWordChar(PrevLast))
+    return isWordChar(First);
+  return isOperatorChar(PrevLast) && isOperatorChar(First);
+}
+
+static void PrintPreprocessedTokens(Preprocessor &PP, Token &Tok,
+                                    PrintPPOutputPPCallbacks *Callbacks,
+                                    raw_ostream &OS) {
+  char Buffer[256];
+  SourceLocation PrevEnd;
+  char PrevLast = 0;
+  bool PrevNeedsSpace = false;
+
+  while (1) {
+    const char *TokPtr;
+    unsigned Len;
+    std::string LongSpelling;
+
+    // Most tokens are identifiers or keywords, whose spelling is in the
+    // identifier table, or punctuators, whose spelling is in the token table.
+    // Literals point into their buffer.  Only the rest go to the source
+    // manager.
+    if (IdentifierInfo *II = Tok.getIdentifierInfo()) {
+      TokPtr = II->getNameStart();
+      Len = II->getLength();
+    } else if (const char *Punc = tok::getTokenSimpleSpelling(Tok.getKind())) {
+      TokPtr = Punc;
+      Len = strlen(Punc);
+    } else if (Tok.isLiteral() && Tok.getLiteralData()) {
+      TokPtr = Tok.getLiteralData();
+      Len = Tok.getLength();
+    } else if (Tok.getLength() < sizeof(Buffer)) {
+      TokPtr = Buffer;
+      Len = PP.getSpelling(Tok, TokPtr);
+    } else {
+      LongSpelling = PP.getSpelling(Tok);
+      TokPtr = LongSpelling.data();
+      Len = LongSpelling.size();
+    }
+
+    if (Len) {
+      if (Tok.isAtStartOfLine()) {
+        Callbacks->HandleFirstTokOnLine(Tok);
+      } else if (PrevLast) {
+        // Tokens that were next to each other in the source still are, so
+        // only tokens brought together by macro expansion need checking.
+        if (Tok.hasLeadingSpace() || PrevNeedsSpace ||
+            (Tok.getLocation() != PrevEnd && AvoidConcat(PrevLast, *TokPtr)))
+          OS << ' ';
+      }
+
+      OS.write(TokPtr, Len);
+      Callbacks->setEmittedTokensOnThisLine();
+      if (Tok.is(tok::comment))
+        Callbacks->HandleNewlinesInToken(TokPtr, Len);
+
+      PrevEnd = Tok.getLocation().getLocWithOffset(Tok.getLength());
+      PrevLast = TokPtr[Len - 1];
+      // An escaped identifier ends at the first white space after it.
+      PrevNeedsSpace = TokPtr[0] == '\\';
+    }
+
+    PP.Lex(Tok);
+    if (Tok.is(tok::eof)) break;
+  }
+}
+
+/// DoPrintPreprocessedInput - This implements -E mode.
+///
+void vlang::DoPrintPreprocessedInput(Preprocessor &PP, raw_ostream *OS,
+                                     const PreprocessorOutputOptions &Opts) {
+  // Show macros with no output is handled specially.
+  if (!Opts.ShowCPP) {
+    assert(Opts.ShowMacros && "Not yet implemented!");
+    return;
+  }
+
+  // Inform the preprocessor whether we want it to retain comments or not, due
+  // to -C or -CC.
+  PP.SetCommentRetentionState(Opts.ShowComments, Opts.ShowMacroComments);
+
+  // A token is usually only a few bytes, so write in large blocks.
+  if (OS->GetBufferSize() < PreferredOutputBufferSize)
+    OS->SetBufferSize(PreferredOutputBufferSize);
+
+  PrintPPOutputPPCallbacks *Callbacks =
+      new PrintPPOutputPPCallbacks(PP, *OS, Opts.ShowLineMarkers);
+  PP.addPPCallbacks(Callbacks);
+
+  // After we have configured the preprocessor, enter the main file.
+  PP.EnterMainSourceFile();
+
+  // Read all the preprocessed tokens, printing them out to the stream.
+  Token Tok;
+  PP.Lex(Tok);
+  if (Tok.isNot(tok::eof))
+    PrintPreprocessedTokens(PP, Tok, Callbacks, *OS);
+  *OS << '\n';
+  OS->flush();
+}
@@ -0,0 +1,112 @@
+//===--- SplitDesignUnits.cpp - Find design unit boundaries ---------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements the prescan that splits one large source file into
+// chunks that can be preprocessed and parsed independently.
+//
+//===----------------------------------------------------------------------===//
+
+#include "vlang/Frontend/Utils.h"
+#include "vlang/Basic/KeywordTable.h"
+#include "vlang/Lex/Lexer.h"
+#include "llvm/Support/MemoryBuffer.h"
+using namespace vlang;
+
+void vlang::FindDesignUnitBoundaries(
+    const llvm::MemoryBuffer *Buffer, const LangOptions &LangOpts,
+    unsigned MinChunkSize, SmallVectorImpl<DesignUnitBoundary> &Boundaries) {
+  const char *BufStart = Buffer->getBufferStart();
+  Lexer L(SourceLocation(), LangOpts, BufStart, BufStart,
+          Buffer->getBufferEnd());
+  unsigned Mask = keywords::getKeywordMask(LangOpts);
+
+  // Depth counts the design units we are inside of.  A design unit keyword
+  // is only known to start one once the next token is seen: `interface
+  // class` does not.
+  unsigned Depth = 0;
+  unsigned LastBoundary = 0;
+  bool PendingUnit = false;
+  unsigned PendingOffset = 0;
+  tok::TokenKind PendingKind = tok::unknown;
+  tok::TokenKind PrevKind = tok::unknown;
+
+  // The last `timescale line seen, which every later design unit inherits.
+  StringRef Timescale;
+
+  Token Tok;
+  while (true) {
+    L.LexFromRawLexer(Tok);
+    if (Tok.is(tok::eof))
+      return;
+
+    // `timescale applies to every design unit after it, so the last one is
+    // handed to each chunk to replay before its first unit.  Any other
+    // directive ends the region where chunks can start: a later chunk could
+    // depend on what it set up.  That includes `default_nettype and
+    // `celldefine, whose settings the preprocessor does not track yet.
+    if (Tok.is(tok::tick)) {
+      const char *DirStart = L.getBufferLocation() - Tok.getLength();
+      L.LexFromRawLexer(Tok);
+      if (Tok.isNot(tok::raw_identifier) ||
+          keywords::lookupDirective(StringRef(Tok.getRawIdentifierData(),
+                                              Tok.getLength())) !=
+              tok::pp_timescale)
+        return;
+      StringRef Rest(DirStart, Buffer->getBufferEnd() - DirStart);
+      Timescale = Rest.substr(0, Rest.find_first_of("\r\n"));
+      PrevKind = tok::unknown;
+      continue;
+    }
+
+    tok::TokenKind Kind = Tok.getKind();
+    if (Kind == tok::raw_identifier)
+      Kind = keywords::lookup(StringRef(Tok.getRawIdentifierData(),
+                                        Tok.getLength()), Mask);
+
+    if (PendingUnit) {
+      PendingUnit = false;
+      if (PendingKind != tok::kw_interface || Kind != tok::kw_class) {
+        if (Depth == 0 && PendingOffset != 0 &&
+            PendingOffset - LastBoundary >= MinChunkSize) {
+          DesignUnitBoundary B;
+          B.Offset = PendingOffset;
+          if (!Timescale.empty())
+            B.Preamble = Timescale.str() + "\n";
+          Boundaries.push_back(B);
+          LastBoundary = PendingOffset;
+        }
+        ++Depth;
+      }
+    }
+
+    switch (Kind) {
+    case tok::kw_module:
+    case tok::kw_macromodule:
+    case tok::kw_interface:
+    case tok::kw_program:
+      // `extern module` only declares a header; `virtual interface` names a
+      // type.
+      if (PrevKind == tok::kw_extern || PrevKind == tok::kw_virtual)
+        break;
+      PendingUnit = true;
+      PendingKind = Kind;
+      PendingOffset = L.getBufferLocation() - BufStart - Tok.getLength();
+      break;
+    case tok::kw_endmodule:
+    case tok::kw_endinterface:
+    case tok::kw_endprogram:
+      if (Depth)
+        --Depth;
+      break;
+    default:
+      break;
+    }
+    PrevKind = Kind;
+  }
+}
@@ -0,0 +1,406 @@
+//===--- DependencyScanner.cpp - Directive-only `include scanner ----------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements the DependencyScanner interface.
+//
+//===----------------------------------------------------------------------===//
+
+#include "vlang/Lex/DependencyScanner.h"
+#include "vlang/Basic/CharInfo.h"
+#include "vlang/Basic/FileManager.h"
+#include "vlang/Lex/HeaderSearch.h"
+#include "vlang/Lex/LexDiagnostic.h"
+#include "llvm/ADT/StringSwitch.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include <algorithm>
+#include <cstring>
+using namespace vlang;
+
+/// MaxIncludeDepth - The preprocessor's limit on `include nesting.
+static const unsigned MaxIncludeDepth = 200;
+
+/// FindChar - Return the first \p C in [Ptr, End), or End if there is none.
+static inline const char *FindChar(const char *Ptr, const char *End, char C) {
+  const void *P = memchr(Ptr, C, End - Ptr);
+  return P ? static_cast<const char *>(P) : End;
+}
+
+/// FindNewline - Return the first '\n' or '\r' in [Ptr, End), or End.
+static inline const char *FindNewline(const char *Ptr, const char *End) {
+  const char *NL = FindChar(Ptr, End, '\n');
+  return FindChar(Ptr, NL, '\r');
+}
+
+/// SkipNewline - Step over the newline (LF, CR or CRLF) at \p Ptr.
+static inline const char *SkipNewline(const char *Ptr) {
+  return Ptr[0] == '\r' && Ptr[1] == '\n' ? Ptr + 2 : Ptr + 1;
+}
+
+static const char *SkipHorizontalWhitespace(const char *Ptr, const char *End) {
+  while (Ptr != End && isHorizontalWhitespace(*Ptr))
+    ++Ptr;
+  return Ptr;
+}
+
+/// LexIdentifier - Return the identifier at \p CurPtr, which may be empty,
+/// and move \p CurPtr past it.
+static StringRef LexIdentifier(const char *&CurPtr, const char *End) {
+  const char *Start = CurPtr;
+  while (CurPtr != End && isIdentifierBody(*CurPtr))
+    ++CurPtr;
+  return StringRef(Start, CurPtr - Start);
+}
+
+/// isAtStartOfLine - Return true if only horizontal white space separates
+/// \p Ptr from the start of its line.
+static bool isAtStartOfLine(const char *BufferStart, const char *Ptr) {
+  while (Ptr != BufferStart && isHorizontalWhitespace(Ptr[-1]))
+    --Ptr;
+  return Ptr == BufferStart || isVerticalWhitespace(Ptr[-1]);
+}
+
+/// SkipStringLiteral - Skip the string literal whose opening quote is at
+/// \p CurPtr.  It ends at the closing quote or at an unescaped newline, as it
+/// does for the lexer.
+static const char *SkipStringLiteral(const char *CurPtr, const char *End) {
+  ++CurPtr;
+  while (CurPtr != End) {
+    char C = *CurPtr;
+    if (C == '"')
+      return CurPtr + 1;
+    if (C == '\n' || C == '\r')
+      return CurPtr;
+    if (C == '\\' && CurPtr + 1 != End) {
+      ++CurPtr;
+      if (*CurPtr == '\n' || *CurPtr == '\r') {
+        CurPtr = SkipNewline(CurPtr);
+        continue;
+      }
+    }
+    ++CurPtr;
+  }
+  return CurPtr;
+}
+
+/// SkipComment - Skip the comment that starts with the '/' at \p CurPtr, or
+/// just the '/' if it does not start one.
+static const char *SkipComment(const char *CurPtr, const char *End) {
+  if (CurPtr + 1 == End)
+    return End;
+
+  if (CurPtr[1] == '/') {
+    // Line comment, which an escaped newline extends onto the next line.
+    CurPtr = FindNewline(CurPtr + 2, End);
+    while (CurPtr != End && CurPtr[-1] == '\\')
+      CurPtr = FindNewline(SkipNewline(CurPtr), End);
+    return CurPtr;
+  }
+
+  if (CurPtr[1] == '*') {
+    // Block comment.  Search for the '/' of the terminating "*/".
+    const char *CommentStart = CurPtr + 2;
+    CurPtr = CommentStart;
+    while (true) {
+      CurPtr = FindChar(CurPtr, End, '/');
+      if (CurPtr == End)
+        return End;
+      ++CurPtr;
+      if (CurPtr - 2 >= CommentStart && CurPtr[-2] == '*')
+        return CurPtr;
+    }
+  }
+
+  return CurPtr + 1;
+}
+
+/// SkipEscapedIdentifier - Skip the escaped identifier that starts with the
+/// backslash at \p CurPtr.  It runs to the next white space, so a "//", "/*"
+/// or '"' in it, as in \bus/*x, starts neither a comment nor a string.
+static const char *SkipEscapedIdentifier(const char *CurPtr,
+                                         const char *End) {
+  ++CurPtr;
+  while (CurPtr != End && isPrintable(*CurPtr) && !isWhitespace(*CurPtr))
+    ++CurPtr;
+  return CurPtr;
+}
+
+DependencyScanner::DependencyScanner(HeaderSearch &HS, DiagnosticsEngine &D)
+  : HeaderInfo(HS), Diags(D), Active(true), IncludeDepth(0),
+    SuppressIncludeNotFoundError(false), NumDirectives(0), NumIncludes(0),
+    NumBytesScanned(0) {}
+
+void DependencyScanner::scan(const FileEntry *MainFile) {
+  ScanFile(MainFile, SrcMgr::C_User);
+}
+
+void DependencyScanner::ScanFile(const FileEntry *File,
+                                 SrcMgr::CharacteristicKind FileType) {
+  ScannedFile Entered = { File, FileType };
+  Files.push_back(Entered);
+
+  std::string ErrorStr;
+  const llvm::MemoryBuffer *Buffer =
+    HeaderInfo.getFileMgr().getSharedBufferForFile(File, &ErrorStr);
+  if (!Buffer) {
+    Diags.Report(diag::err_pp_error_opening_file)
+      << File->getName() << ErrorStr;
+    return;
+  }
+
+  const char *BufferStart = Buffer->getBufferStart();
+  const char *BufferEnd = Buffer->getBufferEnd();
+  const char *CurPtr = BufferStart;
+  NumBytesScanned += BufferEnd - BufferStart;
+  unsigned ConditionalDepth = Conditionals.size();
+
+  while (CurPtr != BufferEnd) {
+    // Find the first backtick, comment, string literal or escaped identifier
+    // on this line.  Most lines have none, and are skipped without looking at
+    // their characters.
+    const char *LineEnd = FindNewline(CurPtr, BufferEnd);
+    const char *Special = FindChar(CurPtr, LineEnd, '`');
+    Special = FindChar(CurPtr, Special, '/');
+    Special = FindChar(CurPtr, Special, '"');
+    Special = FindChar(CurPtr, Special, '\\');
+    if (Special == LineEnd) {
+      CurPtr = LineEnd == BufferEnd ? LineEnd : SkipNewline(LineEnd);
+      continue;
+    }
+
+    CurPtr = Special;
+    if (*CurPtr == '\\') {
+      CurPtr = SkipEscapedIdentifier(CurPtr, BufferEnd);
+    } else if (*CurPtr == '"') {
+      CurPtr = SkipStringLiteral(CurPtr, BufferEnd);
+    } else if (*CurPtr == '/') {
+      CurPtr = SkipComment(CurPtr, BufferEnd);
+    } else if (Active || isAtStartOfLine(BufferStart, CurPtr)) {
+      // As in the preprocessor, a branch that is not taken only ends at a
+      // directive at the start of a line.
+      CurPtr = HandleDirective(CurPtr + 1, BufferEnd, File, FileType);
+    } else {
+      ++CurPtr;
+    }
+  }
+
+  // A conditional does not continue past the end of the file it starts in.
+  // The preprocessor diagnoses any left open.
+  if (Conditionals.size() > ConditionalDepth) {
+    Active = Conditionals[ConditionalDepth].ParentActive;
+    Conditionals.resize(ConditionalDepth);
+  }
+}
+
+/// HandleDirective - Handle the directive whose name starts at \p CurPtr,
+/// just after the backtick, and return where scanning resumes.
+const char *
+DependencyScanner::HandleDirective(const char *CurPtr, const char *BufferEnd,
+                                   const FileEntry *File,
+                                   SrcMgr::CharacteristicKind FileType) {
+  enum DirectiveKind {
+    DK_Other, DK_Include, DK_Define, DK_Undef,
+    DK_Ifdef, DK_Ifndef, DK_Elsif, DK_Else, DK_Endif
+  };
+
+  StringRef Name = LexIdentifier(CurPtr, BufferEnd);
+  DirectiveKind Kind = llvm::StringSwitch<DirectiveKind>(Name)
+    .Case("include", DK_Include)
+    .Case("define", DK_Define)
+    .Case("undef", DK_Undef)
+    .Case("ifdef", DK_Ifdef)
+    .Case("ifndef", DK_Ifndef)
+    .Case("elsif", DK_Elsif)
+    .Case("else", DK_Else)
+    .Case("endif", DK_Endif)
+    .Default(DK_Other);
+
+  // Macro uses and the directives that do not affect `include are skipped.
+  if (Kind == DK_Other)
+    return CurPtr;
+  ++NumDirectives;
+
+  switch (Kind) {
+  case DK_Include:
+    if (!Active)
+      return CurPtr;
+    return HandleInclude(CurPtr, BufferEnd, File, FileType);
+  case DK_Define:
+    // The body is skipped even when the definition is not, so that a
+    // directive in it is not taken for a real one.
+    return HandleDefine(CurPtr, BufferEnd);
+  case DK_Undef:
+    CurPtr = SkipHorizontalWhitespace(CurPtr, BufferEnd);
+    Name = LexIdentifier(CurPtr, BufferEnd);
+    if (Active)
+      Macros.erase(Name);
+    return CurPtr;
+  case DK_Ifdef:
+  case DK_Ifndef:
+  case DK_Elsif:
+    CurPtr = SkipHorizontalWhitespace(CurPtr, BufferEnd);
+    Name = LexIdentifier(CurPtr, BufferEnd);
+    HandleConditional(Kind == DK_Ifdef ? CK_Ifdef :
+                      Kind == DK_Ifndef ? CK_Ifndef : CK_Elsif, Name);
+    return CurPtr;
+  case DK_Else:
+    HandleConditional(CK_Else, StringRef());
+    return CurPtr;
+  default:
+    HandleConditional(CK_Endif, StringRef());
+    return CurPtr;
+  }
+}
+
+/// HandleInclude - Resolve the operand of an `include, which is a quoted or
+/// angled file name or a macro defined as one, and scan the file it names.
+const char *
+DependencyScanner::HandleInclude(const char *CurPtr, const char *BufferEnd,
+                                 const FileEntry *File,
+                                 SrcMgr::CharacteristicKind FileType) {
+  CurPtr = SkipHorizontalWhitespace(CurPtr, BufferEnd);
+
+  StringRef Operand;
+  bool FromMacro = CurPtr != BufferEnd && *CurPtr == '`';
+  if (FromMacro) {
+    ++CurPtr;
+    llvm::StringMap<std::string>::const_iterator I =
+      Macros.find(LexIdentifier(CurPtr, BufferEnd));
+    if (I != Macros.end())
+      Operand = I->second;
+  } else {
+    Operand = StringRef(CurPtr, FindNewline(CurPtr, BufferEnd) - CurPtr);
+  }
+
+  // Make sure the operand is <x> or "x", and drop whatever follows it.
+  size_t End = StringRef::npos;
+  if (!Operand.empty() && Operand[0] == '"')
+    End = Operand.find('"', 1);
+  else if (!Operand.empty() && Operand[0] == '<')
+    End = Operand.find('>', 1);
+  if (End == StringRef::npos) {
+    Diags.Report(diag::err_pp_expects_filename);
+    return CurPtr;
+  }
+  if (End == 1) {
+    Diags.Report(diag::err_pp_empty_filename);
+    return CurPtr;
+  }
+  if (!FromMacro)
+    CurPtr += End + 1;
+
+  bool isAngled = Operand[0] == '<';
+  StringRef Filename = Operand.substr(1, End - 1);
+  if (HeaderInfo.HasIncludeAliasMap()) {
+    StringRef NewName =
+      HeaderInfo.MapHeaderToIncludeAlias(Operand.substr(0, End + 1));
+    if (!NewName.empty())
+      Filename = NewName;
+  }
+
+  ++NumIncludes;
+  if (IncludeDepth == MaxIncludeDepth - 1) {
+    Diags.Report(diag::err_pp_include_too_deep);
+    return CurPtr;
+  }
+
+  const DirectoryLookup *CurDir;
+  const FileEntry *Included =
+    HeaderInfo.LookupFile(Filename, isAngled, 0, CurDir, File, 0, 0);
+  if (!Included) {
+    MissingFiles.push_back(Filename);
+    if (!SuppressIncludeNotFoundError)
+      Diags.Report(diag::err_pp_file_not_found) << Filename;
+    return CurPtr;
+  }
+
+  // An `included file is a system file if it is in a system directory or if
+  // the file including it is one.
+  SrcMgr::CharacteristicKind IncludedType =
+    std::max(HeaderInfo.getFileDirFlavor(Included), FileType);
+
+  ++IncludeDepth;
+  ScanFile(Included, IncludedType);
+  --IncludeDepth;
+  return CurPtr;
+}
+
+/// HandleDefine - Record the macro defined at \p CurPtr, just after
+/// `define, and return the end of its body.
+const char *DependencyScanner::HandleDefine(const char *CurPtr,
+                                            const char *BufferEnd) {
+  CurPtr = SkipHorizontalWhitespace(CurPtr, BufferEnd);
+  StringRef Name = LexIdentifier(CurPtr, BufferEnd);
+  bool FunctionLike = CurPtr != BufferEnd && *CurPtr == '(';
+
+  // The body ends at the first newline that is not escaped and not inside a
+  // block comment, which the lexer reads past newlines even in a directive.
+  const char *BodyStart = CurPtr;
+  const char *BodyEnd = CurPtr;
+  while (BodyEnd != BufferEnd) {
+    char C = *BodyEnd;
+    if (C == '\n' || C == '\r') {
+      if (BodyEnd == BodyStart || BodyEnd[-1] != '\\')
+        break;
+      BodyEnd = SkipNewline(BodyEnd);
+    } else if (C == '/') {
+      BodyEnd = SkipComment(BodyEnd, BufferEnd);
+    } else if (C == '"') {
+      BodyEnd = SkipStringLiteral(BodyEnd, BufferEnd);
+    } else if (C == '\\' && BodyEnd + 1 != BufferEnd &&
+               !isVerticalWhitespace(BodyEnd[1])) {
+      BodyEnd = SkipEscapedIdentifier(BodyEnd, BufferEnd);
+    } else {
+      ++BodyEnd;
+    }
+  }
+
+  if (Active && !Name.empty()) {
+    // Only an object-like body can name an `include file.
+    if (FunctionLike)
+      Macros[Name] = std::string();
+    else
+      Macros[Name] = StringRef(BodyStart, BodyEnd - BodyStart).trim();
+  }
+  return BodyEnd;
+}
+
+/// HandleConditional - Update the conditional stack for an `ifdef, `ifndef,
+/// `elsif, `else or `endif.
+void DependencyScanner::HandleConditional(ConditionalKind Kind,
+                                          StringRef MacroName) {
+  if (Kind == CK_Ifdef || Kind == CK_Ifndef) {
+    ConditionalInfo CI;
+    CI.ParentActive = Active;
+    bool Defined = Macros.count(MacroName);
+    Active = Active && Defined == (Kind == CK_Ifdef);
+    CI.FoundTaken = Active;
+    Conditionals.push_back(CI);
+    return;
+  }
+
+  // A stray `elsif, `else or `endif is the preprocessor's to diagnose.
+  if (Conditionals.empty())
+    return;
+
+  ConditionalInfo &CI = Conditionals.back();
+  switch (Kind) {
+  case CK_Elsif:
+    Active = CI.ParentActive && !CI.FoundTaken && Macros.count(MacroName);
+    CI.FoundTaken |= Active;
+    break;
+  case CK_Else:
+    Active = CI.ParentActive && !CI.FoundTaken;
+    CI.FoundTaken = true;
+    break;
+  default:
+    Active = CI.ParentActive;
+    Conditionals.pop_back();
+    break;
+  }
+}
@@ -15,6 +15,7 @@
 #include "vlang/Diag/Diagnostic.h"
 #include "vlang/Basic/FileManager.h"
 #include "vlang/Basic/IdentifierTable.h"
+#include "vlang/Basic/Statistics.h"
 #include "vlang/Lex/HeaderMap.h"
 #include "vlang/Lex/HeaderSearchOptions.h"
 #include "vlang/Lex/Lexer.h"
@@ -22,7 +23,7 @@
 #include "llvm/Support/Capacity.h"
 #include "llvm/Support/FileSystem.h"
 #include "llvm/Support/Path.h"
-#include <cstdio>
+#include "llvm/Support/raw_ostream.h"
 #if defined(LLVM_ON_UNIX)
 #include <limits.h>
 #endif
@@ -55,6 +56,7 @@ HeaderSearch::HeaderSearch(IntrusiveRefCntPtr<HeaderSearchOptions> HSOpts,
   ExternalSource = 0;
   NumIncluded = 0;
   NumMultiIncludeFileOptzn = 0;
+  NumLookups = NumLookupCacheHits = 0;
 }
 
 HeaderSearch::~HeaderSearch() {
@@ -63,22 +65,36 @@ HeaderSearch::~HeaderSearch() {
     delete HeaderMaps[i].second;
 }
 
-void HeaderSearch::PrintStats() {
-  fprintf(stderr, "\n*** HeaderSearch Stats:\n");
-  fprintf(stderr, "%d files tracked.\n", (int)FileInfo.size());
-  unsigned NumOnceOnlyFiles = 0, MaxNumIncludes = 0, NumSingleIncludedFiles = 0;
+void HeaderSearch::PrintStats(raw_ostream &OS) {
+  OS << "\n*** HeaderSearch Stats:\n";
+  OS << FileInfo.size() << " files tracked.\n";
+  unsigned NumGuardedFiles = 0, MaxNumIncludes = 0, NumSingleIncludedFiles = 0;
   for (unsigned i = 0, e = FileInfo.size(); i != e; ++i) {
     if (MaxNumIncludes < FileInfo[i].NumIncludes)
       MaxNumIncludes = FileInfo[i].NumIncludes;
     NumSingleIncludedFiles += FileInfo[i].NumIncludes == 1;
+    NumGuardedFiles += FileInfo[i].ControllingMacro != 0 ||
+                       FileInfo[i].ControllingMacroID != 0;
   }
-  fprintf(stderr, "  %d included exactly once.\n", NumSingleIncludedFiles);
-  fprintf(stderr, "  %d max times a file is included.\n", MaxNumIncludes);
-
-  fprintf(stderr, "  %d #include/#include_next/#import.\n", NumIncluded);
-  fprintf(stderr, "    %d #includes skipped due to"
-          " the multi-include optimization.\n", NumMultiIncludeFileOptzn);
+  OS << "  " << NumGuardedFiles << " include guarded.\n";
+  OS << "  " << NumSingleIncludedFiles << " included exactly once.\n";
+  OS << "  " << MaxNumIncludes << " max times a file is included.\n";
+
+  OS << "  " << NumIncluded << " `include.\n";
+  OS << "    " << NumMultiIncludeFileOptzn << " `includes skipped due to"
+     << " the multi-include optimization.\n";
+  OS << "  " << NumLookups << " lookups, " << NumLookupCacheHits
+     << " answered by the lookup cache.\n";
+}
 
+void HeaderSearch::ReportStats(StatisticsReport &R) const {
+  R.add("header_search", "files_tracked", FileInfo.size());
+  R.add("header_search", "includes", NumIncluded);
+  R.add("header_search", "includes_skipped_by_guard",
+        NumMultiIncludeFileOptzn);
+  R.add("header_search", "lookups", NumLookups);
+  R.add("header_search", "lookup_cache_hits", NumLookupCacheHits);
+  R.add("header_search", "memory_bytes", getTotalMemory());
 }
 
 /// CreateHeaderMap - This method returns a HeaderMap for the specified
@@ -139,7 +155,7 @@ const FileEntry *DirectoryLookup::LookupFile(
       RelativePath->append(Filename.begin(), Filename.end());
     }
     
-    return HS.getFileMgr().getFile(TmpDir.str(), /*openFile=*/true);
+    return HS.getFileMgr().getFile(TmpDir.str(), /*openFile=*/false);
   }
 
   assert(isHeaderMap() && "Unknown directory lookup");
@@ -169,6 +185,10 @@ const FileEntry *DirectoryLookup::LookupFile(
 /// for system \#include's or not (i.e. using <> instead of "").  CurFileEnt, if
 /// non-null, indicates where the \#including file is, in case a relative search
 /// is needed.
+///
+/// Files are only stat'ed here, not opened.  A file whose include guard is
+/// already defined is then skipped by ShouldEnterIncludeFile without being
+/// opened at all; any other file is opened when its buffer is read.
 const FileEntry *HeaderSearch::LookupFile(
     StringRef Filename,
     bool isAngled,
@@ -179,7 +199,8 @@ const FileEntry *HeaderSearch::LookupFile(
     SmallVectorImpl<char> *RelativePath,
     bool SkipCache)
 {
-    
+  ++NumLookups;
+
   // If 'Filename' is absolute, check to see if it exists and no searching.
   if (llvm::sys::path::is_absolute(Filename)) {
     CurDir = 0;
@@ -194,7 +215,7 @@ const FileEntry *HeaderSearch::LookupFile(
       RelativePath->append(Filename.begin(), Filename.end());
     }
     // Otherwise, just return the file.
-    return FileMgr.getFile(Filename, /*openFile=*/true);
+    return FileMgr.getFile(Filename, /*openFile=*/false);
   }
 
   // Unless disabled, check to see if the file is in the `includer's
@@ -209,7 +230,7 @@ const FileEntry *HeaderSearch::LookupFile(
     TmpDir += CurFileEnt->getDir()->getName();
     TmpDir.push_back('/');
     TmpDir.append(Filename.begin(), Filename.end());
-    if (const FileEntry *FE = FileMgr.getFile(TmpDir.str(),/*openFile=*/true)) {
+    if (const FileEntry *FE = FileMgr.getFile(TmpDir.str(),/*openFile=*/false)) {
       // Leave CurDir unset.
       // This file is a system header or C++ unfriendly if the old file is.
       //
@@ -260,6 +281,7 @@ const FileEntry *HeaderSearch::LookupFile(
   if (!SkipCache && CacheLookup.first == i+1) {
     // Skip querying potentially lots of directories for this lookup.
     i = CacheLookup.second;
+    ++NumLookupCacheHits;
   } else {
     // Otherwise, this is the first query, or the previous query didn't match
     // our search start.  We will fill in our found location below, so prime the
@@ -26,10 +26,12 @@
 
 #include "vlang/Lex/Lexer.h"
 #include "vlang/Basic/CharInfo.h"
+#include "vlang/Basic/CharScan.h"
 #include "vlang/Basic/SourceManager.h"
 #include "vlang/Lex/CodeCompletionHandler.h"
 #include "vlang/Lex/LexDiagnostic.h"
 #include "vlang/Lex/Preprocessor.h"
+#include "vlang/Lex/PTHManager.h"
 #include "llvm/ADT/STLExtras.h"
 #include "llvm/ADT/StringExtras.h"
 #include "llvm/ADT/StringSwitch.h"
@@ -37,6 +39,7 @@
 #include "llvm/Support/ConvertUTF.h"
 #include "llvm/Support/MemoryBuffer.h"
 #include "UnicodeCharSets.h"
+#include <algorithm>
 #include <cstring>
 using namespace vlang;
 
@@ -77,6 +80,7 @@ void Lexer::InitLexer(const char *BufStart, const char *BufPtr,
   }
 
   CurrentConflictMarkerState = CMK_None;
+  NumTokensLexed = 0;
 
   // Start of the file is a start of line.
   IsAtStartOfLine = true;
@@ -94,6 +98,10 @@ void Lexer::InitLexer(const char *BufStart, const char *BufPtr,
 
   // Default to not keeping comments.
   ExtendedTokenMode = 0;
+
+  // No token cache until one is attached.
+  CachedToksBegin = CachedToksEnd = CachedTok = 0;
+  CachedTokPtr = 0;
 }
 
 /// Lexer constructor - Create a new lexer object for the specified buffer
@@ -1080,6 +1088,124 @@ void Lexer::SkipBytes(unsigned Bytes, bool StartOfLine) {
   IsAtStartOfLine = StartOfLine;
 }
 
+/// FindChar - Return the first \p C in [Ptr, End), or End if there is none.
+static inline const char *FindChar(const char *Ptr, const char *End, char C) {
+  const void *P = memchr(Ptr, C, End - Ptr);
+  return P ? static_cast<const char *>(P) : End;
+}
+
+/// FindNewline - Return the first '\n' or '\r' in [Ptr, End), or End.
+static inline const char *FindNewline(const char *Ptr, const char *End) {
+  const char *NL = FindChar(Ptr, End, '\n');
+  return FindChar(Ptr, NL, '\r');
+}
+
+/// SkipNewline - Step over the newline (LF, CR or CRLF) at \p Ptr.
+static inline const char *SkipNewline(const char *Ptr) {
+  return Ptr[0] == '\r' && Ptr[1] == '\n' ? Ptr + 2 : Ptr + 1;
+}
+
+/// SkipExcludedLines - Nothing in an excluded block is tokenized except
+/// directives, and a directive is only recognized at the start of a line.  So
+/// rather than raw lexing every token, jump from line to line with memchr and
+/// only look inside a line if it contains something that could start a
+/// comment or a string literal, since those can span lines and hide a
+/// backtick that would otherwise start one.  Escaped identifiers are stepped
+/// over whole, as the raw lexer forms them, since they may contain either.
+///
+/// Escaped newlines continue the line, as they do for the raw lexer, so a
+/// backtick after one is not at the start of a line.
+void Lexer::SkipExcludedLines() {
+  assert(LexingRawMode && "Can only skip lines in an excluded block");
+  const char *CurPtr = BufferPtr;
+
+  // Are we at the start of a line, possibly after some indentation?
+  const char *LineStart = CurPtr;
+  while (LineStart != BufferStart && isHorizontalWhitespace(LineStart[-1]))
+    --LineStart;
+  bool AtStartOfLine = LineStart == BufferStart ||
+                       isVerticalWhitespace(LineStart[-1]);
+
+  while (CurPtr != BufferEnd) {
+    if (AtStartOfLine) {
+      while (isHorizontalWhitespace(*CurPtr))
+        ++CurPtr;
+      if (*CurPtr == '`')
+        break;
+      AtStartOfLine = false;
+    }
+
+    const char *LineEnd = FindNewline(CurPtr, BufferEnd);
+    const char *Special = FindChar(CurPtr, LineEnd, '/');
+    Special = FindChar(CurPtr, Special, '"');
+    Special = FindChar(CurPtr, Special, '\\');
+
+    // Common case: nothing on the rest of this line can span lines.
+    if (Special == LineEnd) {
+      CurPtr = LineEnd;
+      if (CurPtr == BufferEnd)
+        break;
+      AtStartOfLine = CurPtr == BufferStart || CurPtr[-1] != '\\';
+      CurPtr = SkipNewline(CurPtr);
+      continue;
+    }
+
+    CurPtr = Special;
+    if (*CurPtr == '\\') {
+      // An escaped identifier runs to the next white space, and a '/' or '"'
+      // in it starts nothing.  A backslash before a newline is left for the
+      // end of line check above.
+      ++CurPtr;
+      while (CurPtr != BufferEnd && isPrintable(*CurPtr) &&
+             !isWhitespace(*CurPtr))
+        ++CurPtr;
+    } else if (*CurPtr == '"') {
+      // String literal.  It ends at the closing quote or at an unescaped
+      // newline, which leaves it unterminated just like the raw lexer does.
+      ++CurPtr;
+      while (CurPtr != BufferEnd) {
+        char C = *CurPtr;
+        if (C == '"') {
+          ++CurPtr;
+          break;
+        }
+        if (C == '\n' || C == '\r')
+          break;
+        if (C == '\\' && CurPtr + 1 != BufferEnd) {
+          ++CurPtr;
+          if (*CurPtr == '\n' || *CurPtr == '\r') {
+            CurPtr = SkipNewline(CurPtr);
+            continue;
+          }
+        }
+        ++CurPtr;
+      }
+    } else if (CurPtr[1] == '/') {
+      // Line comment, which an escaped newline extends onto the next line.
+      CurPtr = FindNewline(CurPtr + 2, BufferEnd);
+      while (CurPtr != BufferEnd && CurPtr[-1] == '\\')
+        CurPtr = FindNewline(SkipNewline(CurPtr), BufferEnd);
+    } else if (CurPtr[1] == '*') {
+      // Block comment.  Search for the '/' of the terminating "*/".
+      const char *CommentStart = CurPtr + 2;
+      CurPtr = CommentStart;
+      while (true) {
+        CurPtr = FindChar(CurPtr, BufferEnd, '/');
+        if (CurPtr == BufferEnd)
+          break;
+        ++CurPtr;
+        if (CurPtr - 2 >= CommentStart && CurPtr[-2] == '*')
+          break;
+      }
+    } else {
+      ++CurPtr;
+    }
+  }
+
+  BufferPtr = CurPtr;
+  IsAtStartOfLine = AtStartOfLine;
+}
+
 static bool isAllowedIDChar(uint32_t C, const LangOptions &LangOpts) {
   return isCharInSet(C, C99AllowedIDChars);
 }
@@ -1111,14 +1237,30 @@ void Lexer::LexMacroIdentifier(Token &Result, const char *curPtr){
 	return;
 }
 
+/// LexEscapedIdentifier - Lex an escaped identifier: a backslash followed by
+/// printable characters up to white space.  The backslash is part of the
+/// spelling, but not of the name in the identifier table; the white space is
+/// part of neither.  LookUpIdentifierInfo makes the token an identifier even
+/// if its name is a keyword.
+void Lexer::LexEscapedIdentifier(Token &Result, const char *CurPtr) {
+  // We have already matched the backslash, and know a name character follows.
+  while (isPrintable(*CurPtr) && !isWhitespace(*CurPtr))
+    ++CurPtr;
+
+  const char *IdStart = BufferPtr;
+  FormTokenWithChars(Result, CurPtr, tok::raw_identifier);
+  Result.setRawIdentifierData(IdStart);
+
+  if (LexingRawMode)
+    return;
+  PP->LookUpIdentifierInfo(Result);
+}
+
 void Lexer::LexAnyIdentifier(Token &Result, const char *CurPtr, bool isMacroReference) {
-  // Match [_A-Za-z0-9]*, we have already matched [_A-Za-z$]
+  // Match [_A-Za-z0-9$]*, we have already matched [_A-Za-z$]
   unsigned Size;
-  unsigned char C = *CurPtr++;
-  while (isIdentifierBody(C))
-    C = *CurPtr++;
-
-  --CurPtr;   // Back up over the skipped character.
+  CurPtr = charscan::skipIdentifierBody(CurPtr, BufferEnd);
+  unsigned char C = *CurPtr;
 
   // Fast path, no $,\,? in identifier found.  '\' might be an escaped newline
   // or UCN, and ? might be a trigraph for '\', an escaped newline or UCN.
@@ -1282,8 +1424,10 @@ bool Lexer::SkipWhitespace(Token &Result, const char *CurPtr) {
   // Skip consecutive spaces efficiently.
   while (1) {
     // Skip horizontal whitespace very aggressively.
-    while (isHorizontalWhitespace(Char))
-      Char = *++CurPtr;
+    if (isHorizontalWhitespace(Char)) {
+      CurPtr = charscan::skipHorizontalWhitespace(CurPtr + 1, BufferEnd);
+      Char = *CurPtr;
+    }
 
     // Otherwise if we have something other than whitespace, we're done.
     if (!isVerticalWhitespace(Char))
@@ -1334,11 +1478,10 @@ bool Lexer::SkipLineComment(Token &Result, const char *CurPtr) {
   // them.  As such, optimize for this case with the inner loop.
   char C;
   do {
+    // Skip over characters in the fast loop, up to a potential EOF, a
+    // newline or a DOS-style newline.
+    CurPtr = charscan::findLineCommentEnd(CurPtr, BufferEnd);
     C = *CurPtr;
-    // Skip over characters in the fast loop.
-    while (C != 0 &&                // Potentially EOF.
-           C != '\n' && C != '\r')  // Newline or DOS-style newline.
-      C = *++CurPtr;
 
     const char *NextLine = CurPtr;
     if (C != 0) {
@@ -1937,6 +2080,84 @@ bool Lexer::isCodeCompletionPoint(const char *CurPtr) const {
   return false;
 }
 
+static bool PTHTokenOffsetLess(const PTHToken &Tok, unsigned Offset) {
+  return Tok.Offset < Offset;
+}
+
+/// LexFromTokenCache - Replay the next token from the pre-tokenized form of
+/// the buffer.  Only ordinary tokens outside of directives are replayed; the
+/// start of a directive, anything the raw lexer could not classify, and any
+/// change in lexing mode fall back to scanning characters, after which we
+/// resynchronize with the cache at the next token boundary.
+bool Lexer::LexFromTokenCache(Token &Result) {
+  // If somebody else moved BufferPtr (a directive, a skipped block, ...),
+  // find our place again.  If BufferPtr is in the middle of a cached token
+  // the cache doesn't describe what follows, so lex it by hand.
+  if (BufferPtr != CachedTokPtr) {
+    unsigned Offset = BufferPtr - BufferStart;
+    CachedTok = std::lower_bound(CachedToksBegin, CachedToksEnd, Offset,
+                                 PTHTokenOffsetLess);
+    CachedTokPtr = BufferPtr;
+    if (CachedTok != CachedToksBegin &&
+        CachedTok[-1].Offset + CachedTok[-1].Length > Offset) {
+      CachedTokPtr = 0;
+      return false;
+    }
+  }
+
+  // Find the next real token and make sure it can be replayed before
+  // consuming any comments in front of it.
+  const PTHToken *Tok = CachedTok;
+  while (Tok != CachedToksEnd && Tok->Kind == tok::comment)
+    ++Tok;
+  if (Tok == CachedToksEnd || Tok->Kind == tok::tick ||
+      Tok->Kind == tok::unknown || (Tok->Flags & Token::NeedsCleaning))
+    return false;
+
+  // Let comment handlers see the comments we skip over.
+  for (; CachedTok != Tok; ++CachedTok) {
+    const char *CommentStart = BufferStart + CachedTok->Offset;
+    BufferPtr = CommentStart + CachedTok->Length;
+    CachedTokPtr = BufferPtr;
+    Result.setFlag(Token::LeadingSpace);
+    if (PP->HandleComment(Result, SourceRange(getSourceLocation(CommentStart),
+                                              getSourceLocation(BufferPtr))))
+      return true; // A token has to be returned.
+  }
+
+  const char *TokStart = BufferStart + Tok->Offset;
+  if (Tok->Flags & Token::StartOfLine)
+    Result.setFlag(Token::StartOfLine);
+  if (Tok->Flags & Token::LeadingSpace)
+    Result.setFlag(Token::LeadingSpace);
+
+  // Notify MIOpt that we read a non-whitespace/non-comment token.
+  MIOpt.ReadToken();
+
+  BufferPtr = TokStart;
+  FormTokenWithChars(Result, TokStart + Tok->Length,
+                     static_cast<tok::TokenKind>(Tok->Kind));
+  CachedTok = Tok + 1;
+  CachedTokPtr = BufferPtr;
+
+  switch (Result.getKind()) {
+  case tok::raw_identifier: {
+    Result.setRawIdentifierData(TokStart);
+    IdentifierInfo *II = PP->LookUpIdentifierInfo(Result);
+    if (II->isHandleIdentifierCase())
+      PP->HandleIdentifier(Result);
+    break;
+  }
+  case tok::numeric_constant:
+  case tok::string_literal:
+    Result.setLiteralData(TokStart);
+    break;
+  default:
+    break;
+  }
+  return true;
+}
+
 /// LexTokenInternal - This implements a simple verilog family lexer.  It is an
 /// extremely performance critical piece of code.  This assumes that the buffer
 /// has a null character at the end of the file.  This returns a preprocessing
@@ -1948,6 +2169,12 @@ void Lexer::LexTokenInternal(Token &Result) {
    }
    BufferLast = BufferPtr;
 
+  // Replay pre-tokenized input when we can.  Directives, raw lexing and the
+  // comment/whitespace retaining modes always scan characters.
+  if (CachedToksBegin && !LexingRawMode && !ParsingPreprocessorDirective &&
+      ExtendedTokenMode == 0 && LexFromTokenCache(Result))
+    return;
+
 LexNextToken:
   // New token, can't need cleaning yet.
   Result.clearFlag(Token::NeedsCleaning);
@@ -2518,6 +2745,16 @@ LexNextToken:
     Kind = tok::at;
     break;
 
+  // Escaped identifiers
+  case '\\':
+    if (isPrintable(*CurPtr) && !isWhitespace(*CurPtr)) {
+      // Notify MIOpt that we read a non-whitespace/non-comment token.
+      MIOpt.ReadToken();
+      return LexEscapedIdentifier(Result, CurPtr);
+    }
+    Kind = tok::unknown;
+    break;
+
   default: {
     if (isASCII(Char)) {
       Kind = tok::unknown;
@@ -8,17 +8,21 @@
 //===----------------------------------------------------------------------===//
 //
 // This file implements the NumericLiteralParser, CharLiteralParser, and
-// StringLiteralParser interfaces.
+// StringLiteralParser interfaces, and the decoding of four-state integral
+// literals.
 //
 //===----------------------------------------------------------------------===//
 
 #include "vlang/Lex/LiteralSupport.h"
 #include "vlang/Basic/CharInfo.h"
+#include "vlang/Basic/CharScan.h"
 #include "vlang/Lex/LexDiagnostic.h"
 #include "vlang/Lex/Preprocessor.h"
 #include "llvm/ADT/StringExtras.h"
 #include "llvm/Support/ConvertUTF.h"
 #include "llvm/Support/ErrorHandling.h"
+#include <algorithm>
+#include <cstring>
 
 using namespace vlang;
 
@@ -680,3 +684,193 @@ unsigned StringLiteralParser::getOffsetOfStringByte(const Token &Tok,
 
   return SpellingPtr-SpellingStart;
 }
+
+//===----------------------------------------------------------------------===//
+// Four-state integral literals
+//===----------------------------------------------------------------------===//
+
+static bool isUnknownDigit(char C) {
+  return (C | 0x20) == 'x' || (C | 0x20) == 'z' || C == '?';
+}
+
+static bool isDigitOfRadix(char C, unsigned Radix) {
+  if (isDigit(C))
+    return unsigned(C - '0') < Radix;
+  if (isHexDigit(C))
+    return Radix == 16;
+  // A decimal number may only be a single x or z digit; that is checked by
+  // the caller.
+  return isUnknownDigit(C);
+}
+
+/// setBits - Or the low \p N bits of \p Bits into a plane at bit \p Pos,
+/// dropping whatever falls past the end of the plane.
+static void setBits(uint64_t *Plane, unsigned NumWords, unsigned Pos,
+                    uint64_t Bits, unsigned N) {
+  unsigned Word = Pos / 64, Shift = Pos % 64;
+  if (N < 64)
+    Bits &= (uint64_t(1) << N) - 1;
+  if (Word < NumWords)
+    Plane[Word] |= Bits << Shift;
+  if (Shift && Shift + N > 64 && Word + 1 < NumWords)
+    Plane[Word + 1] |= Bits >> (64 - Shift);
+}
+
+/// fillBits - Set bits [From, To) of a plane.
+static void fillBits(uint64_t *Plane, unsigned From, unsigned To) {
+  for (; From < To && From % 64; ++From)
+    Plane[From / 64] |= uint64_t(1) << (From % 64);
+  for (; From + 64 <= To; From += 64)
+    Plane[From / 64] = ~uint64_t(0);
+  if (From < To)
+    Plane[From / 64] |= (uint64_t(1) << (To - From)) - 1;
+}
+
+/// multiplyAdd - Plane = Plane * Mul + Add, modulo the size of the plane.
+static void multiplyAdd(uint64_t *Plane, unsigned NumWords, uint32_t Mul,
+                        uint32_t Add) {
+  uint64_t Carry = Add;
+  for (unsigned i = 0; i != NumWords; ++i) {
+    uint64_t Lo = (Plane[i] & 0xFFFFFFFF) * Mul + Carry;
+    uint64_t Hi = (Plane[i] >> 32) * Mul + (Lo >> 32);
+    Plane[i] = (Lo & 0xFFFFFFFF) | (Hi << 32);
+    Carry = Hi >> 32;
+  }
+}
+
+/// decodeWords - Decode binary or hexadecimal digits a word at a time, from
+/// the least significant end.  The leftmost, partial word is padded with
+/// zero digits so that it can use the same decoder.
+static bool decodeWords(StringRef Digits, unsigned BitsPerDigit,
+                        uint64_t *Value, uint64_t *Unknown,
+                        unsigned NumWords) {
+  bool (*DecodeWord)(const char *, uint64_t &, uint64_t &) =
+    BitsPerDigit == 4 ? charscan::decodeHexWord : charscan::decodeBinaryWord;
+  size_t DigitsPerWord = 64 / BitsPerDigit;
+  char Buf[64];
+
+  // Digits past the width are still decoded, so that they are checked.
+  for (size_t End = Digits.size(), Word = 0; End; ++Word) {
+    size_t N = std::min(End, DigitsPerWord);
+    const char *Ptr = Digits.data() + End - N;
+    if (N != DigitsPerWord) {
+      memset(Buf, '0', DigitsPerWord - N);
+      memcpy(Buf + DigitsPerWord - N, Ptr, N);
+      Ptr = Buf;
+    }
+    uint64_t V, U;
+    if (!DecodeWord(Ptr, V, U))
+      return false;
+    if (Word < NumWords) {
+      Value[Word] = V;
+      Unknown[Word] = U;
+    }
+    End -= N;
+  }
+  return true;
+}
+
+unsigned vlang::getIntegralLiteralWidth(StringRef Digits, unsigned Radix) {
+  unsigned NumDigits = Digits.size() - Digits.count('_');
+  switch (Radix) {
+  case 2:  return NumDigits;
+  case 8:  return NumDigits * 3;
+  case 16: return NumDigits * 4;
+  default:
+    // log2(10) < 3.322
+    return (NumDigits * 3322 + 999) / 1000;
+  }
+}
+
+bool vlang::decodeIntegralLiteral(StringRef Digits, unsigned Radix,
+                                  unsigned Width, uint64_t *Value,
+                                  uint64_t *Unknown, char &BadDigit) {
+  unsigned NumWords = (Width + 63) / 64;
+  std::fill(Value, Value + NumWords, 0);
+  std::fill(Unknown, Unknown + NumWords, 0);
+
+  // Underscores are rare; only copy the digits when there are some.
+  SmallString<64> Stripped;
+  if (memchr(Digits.data(), '_', Digits.size())) {
+    for (unsigned i = 0, e = Digits.size(); i != e; ++i)
+      if (Digits[i] != '_')
+        Stripped.push_back(Digits[i]);
+    Digits = Stripped;
+  }
+
+  BadDigit = 0;
+  if (Digits.empty())
+    return false;
+
+  unsigned DigitBits = 0;
+  switch (Radix) {
+  case 2:
+  case 16: {
+    unsigned BitsPerDigit = Radix == 2 ? 1 : 4;
+    if (!decodeWords(Digits, BitsPerDigit, Value, Unknown, NumWords)) {
+      for (unsigned i = 0, e = Digits.size(); i != e; ++i)
+        if (!isDigitOfRadix(Digits[i], Radix)) {
+          BadDigit = Digits[i];
+          break;
+        }
+      return false;
+    }
+    DigitBits = Digits.size() * BitsPerDigit;
+    break;
+  }
+
+  case 8:
+    for (unsigned i = 0, e = Digits.size(); i != e; ++i) {
+      char C = Digits[e - 1 - i];
+      if (!isDigitOfRadix(C, 8)) {
+        BadDigit = C;
+        return false;
+      }
+      unsigned Pos = i * 3;
+      if (isUnknownDigit(C)) {
+        setBits(Unknown, NumWords, Pos, 7, 3);
+        if ((C | 0x20) == 'x')
+          setBits(Value, NumWords, Pos, 7, 3);
+      } else
+        setBits(Value, NumWords, Pos, C - '0', 3);
+    }
+    DigitBits = Digits.size() * 3;
+    break;
+
+  default:
+    // A decimal number is either all digits or a single x or z digit that
+    // stands for every bit.
+    if (Digits.size() == 1 && isUnknownDigit(Digits[0]))
+      break;
+    for (unsigned i = 0, e = Digits.size(); i != e; ) {
+      // Nine digits at a time keep the products within 64 bits.
+      unsigned Chunk = 0, Mul = 1;
+      for (unsigned n = 0; n != 9 && i != e; ++n, ++i) {
+        if (!isDigit(Digits[i])) {
+          BadDigit = Digits[i];
+          return false;
+        }
+        Chunk = Chunk * 10 + (Digits[i] - '0');
+        Mul *= 10;
+      }
+      multiplyAdd(Value, NumWords, Mul, Chunk);
+    }
+    DigitBits = Width;
+    break;
+  }
+
+  // Extend an x or z leftmost digit over the rest of the width.
+  if (DigitBits < Width && isUnknownDigit(Digits[0])) {
+    fillBits(Unknown, DigitBits, Width);
+    if ((Digits[0] | 0x20) == 'x')
+      fillBits(Value, DigitBits, Width);
+  }
+
+  // Truncate to the width.
+  if (unsigned Rem = Width % 64) {
+    uint64_t Mask = (uint64_t(1) << Rem) - 1;
+    Value[NumWords - 1] &= Mask;
+    Unknown[NumWords - 1] &= Mask;
+  }
+  return true;
+}
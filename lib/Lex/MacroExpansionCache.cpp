@@ -0,0 +1,150 @@
+//===--- MacroExpansionCache.cpp - Memoized macro substitution ------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements the MacroExpansionCache interface.
+//
+//===----------------------------------------------------------------------===//
+
+#include "vlang/Lex/MacroExpansionCache.h"
+#include "vlang/Lex/MacroArgs.h"
+#include "vlang/Lex/Preprocessor.h"
+#include "llvm/ADT/Hashing.h"
+#include "llvm/Support/Capacity.h"
+
+using namespace vlang;
+
+/// getLiteralSpelling - The spelling of a literal token, straight from its
+/// buffer.  Returns an empty string for tokens that are not literals.
+static StringRef getLiteralSpelling(const Token &Tok) {
+  if (!Tok.isLiteral() || !Tok.getLiteralData())
+    return StringRef();
+  return StringRef(Tok.getLiteralData(), Tok.getLength());
+}
+
+/// hashToken - Hash what substitution depends on: the kind, the spelling and
+/// whether the token has a leading space, which stringification keeps.
+static unsigned hashToken(const Token &Tok, const Preprocessor &PP) {
+  size_t Hash = llvm::hash_combine(Tok.getKind(), Tok.hasLeadingSpace());
+  if (const IdentifierInfo *II = Tok.getIdentifierInfo())
+    return llvm::hash_combine(Hash, II);
+  if (Tok.isLiteral()) {
+    StringRef Spelling = getLiteralSpelling(Tok);
+    if (Spelling.empty())
+      return llvm::hash_combine(Hash, PP.getSpelling(Tok));
+    return llvm::hash_combine(Hash, Spelling);
+  }
+  if (tok::getTokenSimpleSpelling(Tok.getKind()) || Tok.is(tok::eof))
+    return Hash;
+  return llvm::hash_combine(Hash, PP.getSpelling(Tok));
+}
+
+/// isSameToken - Return true if \p A and \p B substitute the same way.
+static bool isSameToken(const Token &A, const Token &B,
+                        const Preprocessor &PP) {
+  if (A.getKind() != B.getKind() ||
+      A.hasLeadingSpace() != B.hasLeadingSpace() ||
+      A.getIdentifierInfo() != B.getIdentifierInfo())
+    return false;
+  if (A.getIdentifierInfo())
+    return true;
+  if (A.isLiteral()) {
+    StringRef SA = getLiteralSpelling(A), SB = getLiteralSpelling(B);
+    if (!SA.empty() && !SB.empty())
+      return SA == SB;
+    return PP.getSpelling(A) == PP.getSpelling(B);
+  }
+  if (tok::getTokenSimpleSpelling(A.getKind()) || A.is(tok::eof))
+    return true;
+  return PP.getSpelling(A) == PP.getSpelling(B);
+}
+
+const MacroExpansionCache::Entry *
+MacroExpansionCache::lookup(const MacroInfo *MI, const MacroArgs *Args,
+                            unsigned &Hash, bool &Cacheable,
+                            const Preprocessor &PP) {
+  const Token *ArgToks = Args->getUnexpArgument(0);
+  unsigned NumArgToks = Args->getNumArguments();
+
+  size_t H = llvm::hash_value(NumArgToks);
+  for (unsigned i = 0; i != NumArgToks; ++i) {
+    const IdentifierInfo *II = ArgToks[i].getIdentifierInfo();
+    if (II && II->hasMacroDefinition()) {
+      Cacheable = false;
+      return 0;
+    }
+    H = llvm::hash_combine(H, hashToken(ArgToks[i], PP));
+  }
+  Hash = H;
+
+  llvm::DenseMap<const MacroInfo *, MacroEntries>::iterator I = Cache.find(MI);
+  if (I != Cache.end()) {
+    std::vector<Entry> &Entries = I->second.Entries;
+    for (unsigned e = 0, ee = Entries.size(); e != ee; ++e) {
+      const Entry &E = Entries[e];
+      if (E.Hash != Hash || E.Args.size() != NumArgToks)
+        continue;
+
+      bool Same = true;
+      for (unsigned i = 0; i != NumArgToks && Same; ++i)
+        Same = isSameToken(E.Args[i], ArgToks[i], PP);
+      if (Same) {
+        ++NumHits;
+        return &E;
+      }
+    }
+  }
+
+  ++NumMisses;
+  return 0;
+}
+
+MacroExpansionCache::Entry &
+MacroExpansionCache::insert(const MacroInfo *MI, const MacroArgs *Args,
+                            unsigned Hash) {
+  MacroEntries &ME = Cache[MI];
+  Entry *E;
+  if (ME.Entries.size() < MaxEntriesPerMacro) {
+    ME.Entries.push_back(Entry());
+    E = &ME.Entries.back();
+  } else {
+    E = &ME.Entries[ME.NextVictim];
+    ME.NextVictim = (ME.NextVictim + 1) % MaxEntriesPerMacro;
+    E->Tokens.clear();
+    E->Origins.clear();
+    E->Substitutions.clear();
+  }
+
+  const Token *ArgToks = Args->getUnexpArgument(0);
+  E->Hash = Hash;
+  E->Args.assign(ArgToks, ArgToks + Args->getNumArguments());
+  return *E;
+}
+
+void MacroExpansionCache::invalidate(const MacroInfo *MI) {
+  llvm::DenseMap<const MacroInfo *, MacroEntries>::iterator I = Cache.find(MI);
+  if (I == Cache.end())
+    return;
+  NumInvalidated += I->second.Entries.size();
+  Cache.erase(I);
+}
+
+size_t MacroExpansionCache::getMemorySize() const {
+  size_t Size = llvm::capacity_in_bytes(Cache);
+  for (llvm::DenseMap<const MacroInfo *, MacroEntries>::const_iterator
+         I = Cache.begin(), E = Cache.end(); I != E; ++I) {
+    const std::vector<Entry> &Entries = I->second.Entries;
+    Size += Entries.capacity() * sizeof(Entry);
+    for (unsigned e = 0, ee = Entries.size(); e != ee; ++e)
+      Size += Entries[e].Args.capacity() * sizeof(Token) +
+              Entries[e].Tokens.capacity() * sizeof(Token) +
+              Entries[e].Origins.capacity() * sizeof(int) +
+              Entries[e].Substitutions.capacity() * sizeof(Substitution);
+  }
+  return Size;
+}
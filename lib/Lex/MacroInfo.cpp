@@ -22,6 +22,7 @@ MacroInfo::MacroInfo(SourceLocation DefLoc)
     NumArguments(0),
     IsDefinitionLengthCached(false),
     IsFunctionLike(false),
+    UsesArguments(false),
     IsDisabled(false),
     IsUsed(false),
     IsAllowRedefinitionsWithoutWarning(false),
@@ -57,6 +58,51 @@ unsigned MacroInfo::getDefinitionLengthSlow(SourceManager &SM) const {
   return DefinitionLength;
 }
 
+void MacroInfo::computeExpansionPlan() {
+  assert(isFunctionLike() && "Only function-like macros have arguments");
+  ExpansionPlan.clear();
+  UsesArguments = false;
+
+  for (unsigned i = 0, e = ReplacementTokens.size(); i != e; ++i) {
+    const Token &Tok = ReplacementTokens[i];
+    ExpansionStep Step;
+    Step.Begin = i;
+
+    if (Tok.is(tok::tick)) {
+      // The preprocessor verified that the ` operator is followed by a
+      // parameter when the `define was parsed.
+      assert(i+1 != e && "` at the end of the macro body?");
+      int ArgNo = getArgumentNum(ReplacementTokens[i+1].getIdentifierInfo());
+      assert(ArgNo != -1 && "Token following ` is not an argument?");
+      Step.Kind = ExpansionStep::StringifyArg;
+      Step.ArgNo = ArgNo;
+      Step.End = i + 2;
+      ++i;  // Skip arg name.
+    } else {
+      IdentifierInfo *II = Tok.getIdentifierInfo();
+      int ArgNo = II ? getArgumentNum(II) : -1;
+      if (ArgNo == -1) {
+        // Extend the run of copied tokens, if there is one.
+        if (!ExpansionPlan.empty() &&
+            ExpansionPlan.back().Kind == ExpansionStep::CopyTokens) {
+          ExpansionPlan.back().End = i + 1;
+          continue;
+        }
+        Step.Kind = ExpansionStep::CopyTokens;
+        Step.ArgNo = 0;
+      } else {
+        Step.Kind = ExpansionStep::SubstituteArg;
+        Step.ArgNo = ArgNo;
+      }
+      Step.End = i + 1;
+    }
+
+    if (Step.Kind != ExpansionStep::CopyTokens)
+      UsesArguments = true;
+    ExpansionPlan.push_back(Step);
+  }
+}
+
 /// \brief Return true if the specified macro definition is equal to
 /// this macro in spelling, arguments, and whitespace.
 ///
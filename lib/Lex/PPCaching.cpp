@@ -40,6 +40,7 @@ void Preprocessor::CommitBacktrackedTokens() {
 void Preprocessor::Backtrack() {
   assert(!BacktrackPositions.empty()
          && "EnableBacktrackAtThisPos was not called!");
+  ++NumBacktracks;
   CachedLexPos = BacktrackPositions.back();
   BacktrackPositions.pop_back();
   recomputeCurLexerKind();
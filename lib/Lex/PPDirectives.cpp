@@ -14,6 +14,7 @@
 
 #include "vlang/Lex/Preprocessor.h"
 #include "vlang/Basic/FileManager.h"
+#include "vlang/Basic/KeywordTable.h"
 #include "vlang/Basic/SourceManager.h"
 #include "vlang/Lex/CodeCompletionHandler.h"
 #include "vlang/Lex/HeaderSearch.h"
@@ -23,6 +24,7 @@
 #include "llvm/ADT/APInt.h"
 #include "llvm/Support/ErrorHandling.h"
 #include "llvm/Support/SaveAndRestore.h"
+#include <algorithm>
 using namespace vlang;
 
 //===----------------------------------------------------------------------===//
@@ -80,6 +82,7 @@ Preprocessor::AllocateVisibilityMacroDirective(SourceLocation Loc,
 /// \brief Release the specified MacroInfo to be reused for allocating
 /// new MacroInfo objects.
 void Preprocessor::ReleaseMacroInfo(MacroInfo *MI) {
+  ExpansionCache.invalidate(MI);
   MacroInfoChain *MIChain = (MacroInfoChain*) MI;
   if (MacroInfoChain *Prev = MIChain->Prev) {
     MacroInfoChain *Next = MIChain->Next;
@@ -211,8 +214,17 @@ void Preprocessor::SkipExcludedConditionalBlock(SourceLocation IfTokenLoc,
   // Enter raw mode to disable identifier lookup (and thus macro expansion),
   // disabling warnings, etc.
   CurPPLexer->LexingRawMode = true;
+
+  // Only lines starting with a backtick can end the block, so jump straight
+  // to those instead of lexing everything in between.  The raw lexer is still
+  // used when a code completion point could be hiding in the block.
+  bool SkipLines = !isCodeCompletionEnabled();
+  const char *SkipStart = CurLexer ? CurLexer->getBufferLocation() : 0;
+
   Token Tok;
   while (1) {
+    if (SkipLines)
+      CurLexer->SkipExcludedLines();
     CurLexer->Lex(Tok);
 
     if (Tok.is(tok::code_completion)) {
@@ -297,10 +309,9 @@ void Preprocessor::SkipExcludedConditionalBlock(SourceLocation IfTokenLoc,
       Directive = StringRef(DirectiveBuf, IdLen);
     }
 
+    tok::TokenKind DirectiveKind = keywords::lookupDirective(Directive);
     if (Directive.startswith("if")) {
-      StringRef Sub = Directive.substr(2);
-      if (Sub == "def" ||   // "ifdef"
-          Sub == "ndef") {  // "ifndef"
+      if (DirectiveKind == tok::pp_ifdef || DirectiveKind == tok::pp_ifndef) {
         // We know the entire `ifdef/`ifndef block will be skipped, don't
         // bother parsing the condition.
         DiscardUntilEndOfDirective();
@@ -309,8 +320,7 @@ void Preprocessor::SkipExcludedConditionalBlock(SourceLocation IfTokenLoc,
                                        /*foundelse*/false);
       }
     } else if (Directive[0] == 'e') {
-      StringRef Sub = Directive.substr(1);
-      if (Sub == "ndif") {  // "endif"
+      if (DirectiveKind == tok::pp_endif) {
         PPConditionalInfo CondInfo;
         CondInfo.WasSkipping = true; // Silence bogus warning.
         bool InCond = CurPPLexer->popConditionalLevel(CondInfo);
@@ -330,7 +340,7 @@ void Preprocessor::SkipExcludedConditionalBlock(SourceLocation IfTokenLoc,
         } else {
           DiscardUntilEndOfDirective();
         }
-      } else if (Sub == "lse") { // "else".
+      } else if (DirectiveKind == tok::pp_else) {
         // `else directive in a skipping conditional.  If not in some other
         // skipping conditional, and if `else hasn't already been seen, enter it
         // as a non-skipping conditional.
@@ -357,7 +367,7 @@ void Preprocessor::SkipExcludedConditionalBlock(SourceLocation IfTokenLoc,
         } else {
           DiscardUntilEndOfDirective();
         }
-      } else if (Sub == "lsif") {  // "elsif".
+      } else if (DirectiveKind == tok::pp_elsif) {
         PPConditionalInfo &CondInfo = CurPPLexer->peekConditionalLevel();
 
         bool ShouldEnter = true;
@@ -373,9 +383,21 @@ void Preprocessor::SkipExcludedConditionalBlock(SourceLocation IfTokenLoc,
           assert(CurPPLexer->LexingRawMode && "We have to be skipping here!");
           CurPPLexer->LexingRawMode = false;
 
-		  // TODO: Check if defined
-          IdentifierInfo *IfNDefMacro = 0;
-          //ShouldEnter = EvaluateDirectiveExpression(IfNDefMacro);
+          // `elsif takes a single macro name; enter the block if it is
+          // defined.
+          Token MacroNameTok;
+          ReadMacroName(MacroNameTok);
+          if (MacroNameTok.is(tok::eod)) {
+            ShouldEnter = false;
+          } else {
+            CheckEndOfDirective("elsif");
+            MacroDirective *MD =
+              getMacroDirective(MacroNameTok.getIdentifierInfo());
+            MacroInfo *MI = MD ? MD->getMacroInfo() : 0;
+            if (MI)
+              markMacroAsUsed(MI);
+            ShouldEnter = MI != 0;
+          }
           CurPPLexer->LexingRawMode = true;
         }
         const SourceLocation ConditionalEnd = CurPPLexer->getSourceLocation();
@@ -405,6 +427,11 @@ void Preprocessor::SkipExcludedConditionalBlock(SourceLocation IfTokenLoc,
   // the #if block.
   CurPPLexer->LexingRawMode = false;
 
+  if (CountSkippedLines && CurLexer &&
+      CurLexer->getBufferLocation() > SkipStart)
+    NumSkippedLines += std::count(SkipStart, CurLexer->getBufferLocation(),
+                                  '\n');
+
   if (Callbacks) {
     SourceLocation BeginLoc = ElseLoc.isValid() ? ElseLoc : IfTokenLoc;
     Callbacks->SourceRangeSkipped(SourceRange(BeginLoc, Tok.getLocation()));
@@ -488,6 +515,12 @@ bool Preprocessor::HandleDirective(Token &Result) {
   // pp-directive.
   bool ReadAnyTokensBeforeDirective =CurPPLexer->MIOpt.getHasReadAnyTokensVal();
 
+  // Likewise, a `define directly after the top-level `ifndef is expected to
+  // define the include guard.  Any other directive ends that window.
+  bool ImmediatelyAfterTopLevelIfndef =
+      CurPPLexer->MIOpt.getImmediatelyAfterTopLevelIfndef();
+  CurPPLexer->MIOpt.resetImmediatelyAfterTopLevelIfndef();
+
   // C99 6.10.3p11: Is this preprocessor directive in macro invocation?  e.g.:
   //   `define A(x) #x
   //   A(abc
@@ -590,7 +623,7 @@ bool Preprocessor::HandleDirective(Token &Result) {
 
     // SV2012-22.5
     case tok::pp_define:
-       HandleDefineDirective(Result);
+       HandleDefineDirective(Result, ImmediatelyAfterTopLevelIfndef);
        return false;
     case tok::pp_undef:
        HandleUndefDirective(Result);
@@ -940,6 +973,7 @@ bool Preprocessor::ReadMacroDefinitionArgList(MacroInfo *MI, Token &Tok) {
 }
 
 void Preprocessor::HandleTimescaleDirective(Token &Tok){
+   SourceLocation DirectiveLoc = Tok.getLocation();
    Token TimeUnitNum;
    Token TimePrecNum;
 
@@ -963,13 +997,16 @@ void Preprocessor::HandleTimescaleDirective(Token &Tok){
       Diag(Tok, diag::err_pp_expected_timescale_num) << "time precision";
       goto HandleTimescaleError;
    }
-   TimeUnitNum = Tok;
+   TimePrecNum = Tok;
 
    LexUnexpandedToken(Tok);
    if( Tok.isNot(tok::eod) ) {
       Diag(Tok, diag::err_pp_expected_eol);
    }
 
+   if (Callbacks)
+      Callbacks->Timescale(DirectiveLoc, TimeUnitNum, TimePrecNum);
+
 HandleTimescaleError:
    while( Tok.isNot(tok::eod) ){
       LexUnexpandedToken(Tok);
@@ -978,7 +1015,8 @@ HandleTimescaleError:
 
 /// HandleDefineDirective - Implements \`define.  This consumes the entire macro
 /// line then lets the caller lex the next real token.
-void Preprocessor::HandleDefineDirective(Token &DefineTok) {
+void Preprocessor::HandleDefineDirective(Token &DefineTok,
+                                         bool ImmediatelyAfterHeaderGuard) {
   ++NumDefined;
 
   Token MacroNameTok;
@@ -988,6 +1026,12 @@ void Preprocessor::HandleDefineDirective(Token &DefineTok) {
   if (MacroNameTok.is(tok::eod))
     return;
 
+  // Remember what the `ifndef guard was followed by, so that a guard that
+  // never gets defined can be diagnosed at the end of the file.
+  if (ImmediatelyAfterHeaderGuard)
+    CurPPLexer->MIOpt.SetDefinedMacro(MacroNameTok.getIdentifierInfo(),
+                                      MacroNameTok.getLocation());
+
   Token LastTok = MacroNameTok;
 
   // If we are supposed to keep comments in `defines, reenable comment saving
@@ -1098,6 +1142,9 @@ void Preprocessor::HandleDefineDirective(Token &DefineTok) {
       // Get the next token of the macro.
       LexUnexpandedToken(Tok);
     }
+
+    // Work out once how the body is expanded, rather than on every use.
+    MI->computeExpansionPlan();
   }
 
   MI->setDefinitionEndLoc(LastTok.getLocation());
@@ -1124,6 +1171,7 @@ void Preprocessor::HandleDefineDirective(Token &DefineTok) {
     }
     if (OtherMI->isWarnIfUnused())
       WarnUnusedMacroLocs.erase(OtherMI->getDefinitionLoc());
+    ExpansionCache.invalidate(OtherMI);
   }
 
   DefMacroDirective *MD =
@@ -1177,6 +1225,8 @@ void Preprocessor::HandleUndefDirective(Token &UndefTok) {
   if (MI->isWarnIfUnused())
     WarnUnusedMacroLocs.erase(MI->getDefinitionLoc());
 
+  ExpansionCache.invalidate(MI);
+
   appendMacroDirective(MacroNameTok.getIdentifierInfo(),
                        AllocateUndefMacroDirective(MacroNameTok.getLocation()));
 }
@@ -1222,7 +1272,7 @@ void Preprocessor::HandleIfdefDirective(Token &Result, bool isIfndef,
     // handle.
     if (!ReadAnyTokensBeforeDirective && MI == 0) {
       assert(isIfndef && "`ifdef shouldn't reach here");
-      CurPPLexer->MIOpt.EnterTopLevelIFNDEF(MII);
+      CurPPLexer->MIOpt.EnterTopLevelIFNDEF(MII, MacroNameTok.getLocation());
     } else
       CurPPLexer->MIOpt.EnterTopLevelConditional();
   }
@@ -15,13 +15,16 @@
 #include "vlang/Lex/Preprocessor.h"
 #include "vlang/Basic/FileManager.h"
 #include "vlang/Basic/SourceManager.h"
+#include "vlang/Basic/TimeTrace.h"
 #include "vlang/Lex/HeaderSearch.h"
 #include "vlang/Lex/LexDiagnostic.h"
 #include "vlang/Lex/MacroInfo.h"
+#include "vlang/Lex/PTHManager.h"
 #include "llvm/ADT/StringSwitch.h"
 #include "llvm/Support/FileSystem.h"
 #include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/PathV2.h"
+#include <algorithm>
 using namespace vlang;
 
 PPCallbacks::~PPCallbacks() {}
@@ -86,6 +89,13 @@ void Preprocessor::EnterSourceFile(FileID FID, const DirectoryLookup *CurDir,
     return;
   }
 
+  NumBytesEntered += InputFile->getBufferSize();
+
+  if (TimeTrace)
+    FileTraceIDs.push_back(TimeTrace->begin(
+        SourceMgr.getIncludeLoc(FID).isValid() ? "Include" : "Source",
+        InputFile->getBufferIdentifier()));
+
   if (isCodeCompletionEnabled() &&
       SourceMgr.getFileEntryForID(FID) == CodeCompletionFile) {
     CodeCompletionFileLoc = SourceMgr.getLocForStartOfFile(FID);
@@ -93,7 +103,17 @@ void Preprocessor::EnterSourceFile(FileID FID, const DirectoryLookup *CurDir,
         CodeCompletionFileLoc.getLocWithOffset(CodeCompletionOffset);
   }
 
-  EnterSourceFileWithLexer(new Lexer(FID, InputFile, *this), CurDir);
+  Lexer *TheLexer = new Lexer(FID, InputFile, *this);
+
+  // If the file was pre-tokenized, replay its tokens rather than lexing it.
+  if (PTH) {
+    const PTHToken *Begin, *End;
+    const FileEntry *FE = SourceMgr.getFileEntryForID(FID);
+    if (FE && PTH->getTokens(FE, InputFile, Begin, End))
+      TheLexer->setTokenCache(Begin, End);
+  }
+
+  EnterSourceFileWithLexer(TheLexer, CurDir);
   return;
 }
 
@@ -203,14 +223,51 @@ bool Preprocessor::HandleEndOfFile(Token &Result, bool isEndOfMacro) {
   assert(!CurTokenLexer &&
          "Ending a file when currently in a macro!");
 
+  // Collect the token count of the file before its lexer goes away.
+  if (!isEndOfMacro && CurLexer) {
+    NumTokensLexed += CurLexer->NumTokensLexed;
+    CurLexer->NumTokensLexed = 0;
+  }
+
+  // End the region of the file.  Lexing past the end of the main file gets
+  // here again, with nothing left to end.
+  if (TimeTrace && !isEndOfMacro && CurPPLexer && !FileTraceIDs.empty()) {
+    TimeTrace->end(FileTraceIDs.back());
+    FileTraceIDs.pop_back();
+  }
+
   // See if this file had a controlling macro.
   if (CurPPLexer) {  // Not ending a macro, ignore it.
     if (const IdentifierInfo *ControllingMacro =
           CurPPLexer->MIOpt.GetControllingMacroAtEndOfFile()) {
       // Okay, this has a controlling macro, remember in HeaderFileInfo.
       if (const FileEntry *FE =
-            SourceMgr.getFileEntryForID(CurPPLexer->getFileID()))
+            SourceMgr.getFileEntryForID(CurPPLexer->getFileID())) {
         HeaderInfo.SetFileControllingMacro(FE, ControllingMacro);
+
+        // A guard that is never defined makes every `include of the file
+        // re-read it.  If the `define after the `ifndef names something
+        // close to the guard, it is most likely a typo.
+        if (const IdentifierInfo *DefinedMacro =
+              CurPPLexer->MIOpt.GetDefinedMacro()) {
+          if (!ControllingMacro->hasMacroDefinition() &&
+              DefinedMacro != ControllingMacro &&
+              HeaderInfo.getFileInfo(FE).NumIncludes <= 1) {
+            StringRef ControllingMacroName = ControllingMacro->getName();
+            StringRef DefinedMacroName = DefinedMacro->getName();
+            unsigned MaxHalfLength = std::max(ControllingMacroName.size(),
+                                              DefinedMacroName.size()) / 2;
+            unsigned ED = ControllingMacroName.edit_distance(
+                DefinedMacroName, true, MaxHalfLength);
+            if (ED <= MaxHalfLength) {
+              Diag(CurPPLexer->MIOpt.GetMacroLocation(),
+                   diag::warn_header_guard) << ControllingMacro;
+              Diag(CurPPLexer->MIOpt.GetDefinedLocation(),
+                   diag::note_header_guard) << DefinedMacro << ControllingMacro;
+            }
+          }
+        }
+      }
     }
   }
 
@@ -17,6 +17,7 @@
 #include "vlang/Basic/FileManager.h"
 #include "vlang/Basic/SourceManager.h"
 #include "vlang/Basic/TargetInfo.h"
+#include "vlang/Basic/TimeTrace.h"
 #include "vlang/Lex/CodeCompletionHandler.h"
 #include "vlang/Lex/ExternalPreprocessorSource.h"
 #include "vlang/Lex/LexDiagnostic.h"
@@ -130,6 +131,11 @@ bool Preprocessor::HandleMacroExpandedIdentifier(Token &Identifier,
   assert(Def.isValid());
   MacroInfo *MI = Def.getMacroInfo();
 
+  // Covers reading the arguments and entering the expansion, which
+  // pre-expands the arguments.  The tokens of the body are lexed later.
+  TimeTraceScope TraceScope(TimeTrace, "MacroExpansion",
+                            Identifier.getIdentifierInfo()->getName());
+
   // If this is a macro expansion in the "`if !defined(x)" line for the file,
   // then the macro could expand to different things in other contexts, we need
   // to disable the optimization in this case.
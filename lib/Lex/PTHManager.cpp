@@ -0,0 +1,180 @@
+//===--- PTHManager.cpp - Manager object for pre-tokenized files ----------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+//  This file implements the PTHManager interface.
+//
+//===----------------------------------------------------------------------===//
+
+#include "vlang/Lex/PTHManager.h"
+#include "vlang/Basic/FileManager.h"
+#include "vlang/Basic/TokenKinds.h"
+#include "vlang/Lex/LexDiagnostic.h"
+#include "vlang/Lex/Lexer.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/system_error.h"
+#include <cstring>
+using namespace vlang;
+
+PTHManager::PTHManager(const llvm::MemoryBuffer *buf)
+  : Buf(buf), LexFiles(false) {}
+
+PTHManager::~PTHManager() {
+  for (llvm::DenseMap<const FileEntry *, LexedFile *>::iterator
+         I = LexedFiles.begin(), E = LexedFiles.end(); I != E; ++I)
+    delete I->second;
+}
+
+PTHManager *PTHManager::CreateInMemory(const LangOptions &LangOpts) {
+  PTHManager *PTH = new PTHManager(0);
+  PTH->setLexFiles(LangOpts);
+  return PTH;
+}
+
+PTHManager *PTHManager::Create(StringRef FileName, DiagnosticsEngine &Diags) {
+  // Memory map the token cache.  It does not need a null terminator, which
+  // lets the MemoryBuffer use mmap for any file size.
+  OwningPtr<llvm::MemoryBuffer> File;
+  if (llvm::MemoryBuffer::getFile(FileName, File, -1,
+                                  /*RequiresNullTerminator=*/false)) {
+    Diags.Report(diag::err_invalid_pth_file) << FileName;
+    return 0;
+  }
+
+  const char *BufStart = File->getBufferStart();
+  uint64_t BufSize = File->getBufferSize();
+
+  // Check the header.
+  const PTHFileHeader *Header =
+    reinterpret_cast<const PTHFileHeader *>(BufStart);
+  if (BufSize < sizeof(PTHFileHeader) ||
+      memcmp(Header->Magic, "VPTH", 4) != 0 ||
+      Header->Version != PTHVersion ||
+      BufSize < sizeof(PTHFileHeader) +
+                uint64_t(Header->NumFiles) * sizeof(PTHFileRecord)) {
+    Diags.Report(diag::err_invalid_pth_file) << FileName;
+    return 0;
+  }
+
+  PTHManager *PTH = new PTHManager(File.take());
+
+  // Index the file table, validating every record against the buffer so that
+  // a truncated cache can't make the lexer read out of bounds.
+  const PTHFileRecord *Records =
+    reinterpret_cast<const PTHFileRecord *>(Header + 1);
+  for (unsigned i = 0, e = Header->NumFiles; i != e; ++i) {
+    const PTHFileRecord &R = Records[i];
+    if (uint64_t(R.NameOffset) + R.NameLength > BufSize ||
+        (R.TokenOffset & 3) != 0 ||
+        uint64_t(R.TokenOffset) + uint64_t(R.NumTokens) * sizeof(PTHToken) >
+          BufSize) {
+      Diags.Report(diag::err_invalid_pth_file) << FileName;
+      delete PTH;
+      return 0;
+    }
+    PTH->Files[StringRef(BufStart + R.NameOffset, R.NameLength)] = &R;
+  }
+
+  return PTH;
+}
+
+bool PTHManager::getTokens(const FileEntry *FE,
+                           const llvm::MemoryBuffer *Buffer,
+                           const PTHToken *&Begin, const PTHToken *&End) {
+  llvm::StringMap<const PTHFileRecord *>::const_iterator I =
+    Files.find(FE->getName());
+  if (I == Files.end())
+    return LexFiles && getLexedTokens(FE, Buffer, Begin, End);
+
+  // Only use the tokens if the file is the one that was cached.
+  const PTHFileRecord &R = *I->second;
+  uint64_t BufferSize = Buffer->getBufferSize();
+  if (R.Size != uint64_t(FE->getSize()) || R.Size != BufferSize ||
+      R.ModTime != int64_t(FE->getModificationTime()))
+    return false;
+
+  const PTHToken *Toks = reinterpret_cast<const PTHToken *>(
+    Buf->getBufferStart() + R.TokenOffset);
+
+  // The lexer forms tokens straight from these ranges and searches them by
+  // offset, so every token has to lie inside the buffer, after the one
+  // before it.
+  uint64_t PrevEnd = 0;
+  for (unsigned i = 0, e = R.NumTokens; i != e; ++i) {
+    uint64_t TokEnd = uint64_t(Toks[i].Offset) + Toks[i].Length;
+    if (Toks[i].Offset < PrevEnd || TokEnd > BufferSize ||
+        Toks[i].Kind >= tok::NUM_TOKENS)
+      return false;
+    PrevEnd = TokEnd;
+  }
+
+  Begin = Toks;
+  End = Toks + R.NumTokens;
+  return true;
+}
+
+bool PTHManager::getLexedTokens(const FileEntry *FE,
+                                const llvm::MemoryBuffer *Buffer,
+                                const PTHToken *&Begin, const PTHToken *&End) {
+  // Token offsets are 32 bits.
+  if (Buffer->getBufferSize() > ~0U)
+    return false;
+
+  LexedFile *F;
+  {
+    llvm::sys::ScopedLock Guard(Lock);
+    std::pair<llvm::DenseMap<const FileEntry *, LexedFile *>::iterator, bool>
+      Inserted = LexedFiles.insert(std::make_pair(FE, (LexedFile *)0));
+    F = Inserted.first->second;
+
+    // If another thread is still lexing the file, lex it directly rather
+    // than wait.
+    if (!Inserted.second && (!F || F->Buffer != Buffer))
+      return false;
+  }
+
+  // The first preprocessor to ask for a file lexes it, without holding the
+  // lock, so that preprocessors entering other files are not held up.
+  if (!F) {
+    F = new LexedFile;
+    F->Buffer = Buffer;
+    LexRawTokens(Buffer, LangOpts, F->Tokens);
+    llvm::sys::ScopedLock Guard(Lock);
+    LexedFiles[FE] = F;
+  }
+
+  if (F->Tokens.empty())
+    return false;
+  Begin = &F->Tokens[0];
+  End = Begin + F->Tokens.size();
+  return true;
+}
+
+void PTHManager::LexRawTokens(const llvm::MemoryBuffer *Buffer,
+                              const LangOptions &LangOpts,
+                              std::vector<PTHToken> &Tokens) {
+  const char *BufStart = Buffer->getBufferStart();
+  Lexer L(SourceLocation(), LangOpts, BufStart, BufStart,
+          Buffer->getBufferEnd());
+  L.SetCommentRetentionState(true);
+
+  Token Tok;
+  while (true) {
+    L.LexFromRawLexer(Tok);
+    if (Tok.is(tok::eof))
+      break;
+
+    // The lexer leaves its buffer pointer just past the token.
+    PTHToken T;
+    T.Offset = L.getBufferLocation() - BufStart - Tok.getLength();
+    T.Length = Tok.getLength();
+    T.Kind = Tok.getKind();
+    T.Flags = Tok.getFlags();
+    Tokens.push_back(T);
+  }
+}
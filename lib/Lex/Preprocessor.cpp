@@ -29,6 +29,7 @@
 #include "vlang/Lex/MacroArgs.h"
 #include "vlang/Basic/FileManager.h"
 #include "vlang/Basic/SourceManager.h"
+#include "vlang/Basic/Statistics.h"
 #include "vlang/Lex/CodeCompletionHandler.h"
 #include "vlang/Lex/ExternalPreprocessorSource.h"
 #include "vlang/Lex/HeaderSearch.h"
@@ -59,7 +60,7 @@ Preprocessor::Preprocessor(IntrusiveRefCntPtr<PreprocessorOptions> PPOpts,
                            bool DelayInitialization, bool IncrProcessing)
     : PPOpts(PPOpts), Diags(&diags), LangOpts(opts),
       FileMgr(Headers.getFileMgr()), SourceMgr(SM), HeaderInfo(Headers),
-      ExternalSource(0),
+      ExternalSource(0), PTH(0), TimeTrace(0),
       Identifiers(opts, IILookup), IncrementalProcessing(IncrProcessing),
       CodeComplete(0), CodeCompletionFile(0), CodeCompletionOffset(0),
       CodeCompletionReached(0), SkipMainFilePreamble(0, true), CurPPLexer(0),
@@ -77,7 +78,10 @@ Preprocessor::Preprocessor(IntrusiveRefCntPtr<PreprocessorOptions> PPOpts,
   NumMacroExpanded = NumFnMacroExpanded = NumBuiltinMacroExpanded = 0;
   NumFastMacroExpanded = NumTokenPaste = NumFastTokenPaste = 0;
   MaxIncludeStackDepth = 0;
-  NumSkipped = 0;
+  NumSkipped = NumSkippedLines = NumBacktracks = 0;
+  NumTokensLexed = NumBytesEntered = 0;
+  CountSkippedLines = false;
+  CacheMacroExpansions = true;
   
   // Default to discarding comments.
   KeepComments = false;
@@ -179,37 +183,49 @@ void Preprocessor::DumpMacro(const MacroInfo &MI) const {
   llvm::errs() << "\n";
 }
 
-void Preprocessor::PrintStats() {
-  llvm::errs() << "\n*** Preprocessor Stats:\n";
-  llvm::errs() << NumDirectives << " directives found:\n";
-  llvm::errs() << "  " << NumDefined << " #define.\n";
-  llvm::errs() << "  " << NumUndefined << " #undef.\n";
-  llvm::errs() << "  #include/#include_next/#import:\n";
-  llvm::errs() << "    " << NumEnteredSourceFiles << " source files entered.\n";
-  llvm::errs() << "    " << MaxIncludeStackDepth << " max include stack depth\n";
-  llvm::errs() << "  " << NumIf << " #if/#ifndef/#ifdef.\n";
-  llvm::errs() << "  " << NumElse << " #else/#elif.\n";
-  llvm::errs() << "  " << NumEndif << " #endif.\n";
-  llvm::errs() << NumSkipped << " #if/#ifndef#ifdef regions skipped\n";
-
-  llvm::errs() << NumMacroExpanded << "/" << NumFnMacroExpanded << "/"
-             << NumBuiltinMacroExpanded << " obj/fn/builtin macros expanded, "
-             << NumFastMacroExpanded << " on the fast path.\n";
-  llvm::errs() << (NumFastTokenPaste+NumTokenPaste)
-             << " token paste (##) operations performed, "
-             << NumFastTokenPaste << " on the fast path.\n";
-
-  llvm::errs() << "\nPreprocessor Memory: " << getTotalMemory() << "B total";
-
-  llvm::errs() << "\n  BumpPtr: " << BP.getTotalMemory();
-  llvm::errs() << "\n  Macro Expanded Tokens: "
-               << llvm::capacity_in_bytes(MacroExpandedTokens);
-  llvm::errs() << "\n  Predefines Buffer: " << Predefines.capacity();
-  llvm::errs() << "\n  Macros: " << llvm::capacity_in_bytes(Macros);
-  llvm::errs() << "\n  Poison Reasons: "
-               << llvm::capacity_in_bytes(PoisonReasons);
-  llvm::errs() << "\n  Comment Handlers: "
-               << llvm::capacity_in_bytes(CommentHandlers) << "\n";
+void Preprocessor::PrintStats(raw_ostream &OS) {
+  OS << "\n*** Preprocessor Stats:\n";
+  OS << NumDirectives << " directives found:\n";
+  OS << "  " << NumDefined << " #define.\n";
+  OS << "  " << NumUndefined << " #undef.\n";
+  OS << "  #include/#include_next/#import:\n";
+  OS << "    " << NumEnteredSourceFiles << " source files entered.\n";
+  OS << "    " << MaxIncludeStackDepth << " max include stack depth\n";
+  OS << "  " << NumIf << " #if/#ifndef/#ifdef.\n";
+  OS << "  " << NumElse << " #else/#elif.\n";
+  OS << "  " << NumEndif << " #endif.\n";
+  OS << NumSkipped << " #if/#ifndef#ifdef regions skipped";
+  if (CountSkippedLines)
+    OS << ", " << NumSkippedLines << " lines";
+  OS << "\n";
+  OS << getNumTokensLexed() << " tokens lexed from "
+     << NumBytesEntered << " bytes, " << NumBacktracks
+     << " backtracks.\n";
+
+  OS << NumMacroExpanded << "/" << NumFnMacroExpanded << "/"
+     << NumBuiltinMacroExpanded << " obj/fn/builtin macros expanded, "
+     << NumFastMacroExpanded << " on the fast path.\n";
+  OS << ExpansionCache.getNumHits() << "/"
+     << ExpansionCache.getNumMisses()
+     << " macro substitutions replayed/computed, "
+     << ExpansionCache.getNumInvalidated() << " invalidated.\n";
+  OS << (NumFastTokenPaste+NumTokenPaste)
+     << " token paste (##) operations performed, "
+     << NumFastTokenPaste << " on the fast path.\n";
+
+  OS << "\nPreprocessor Memory: " << getTotalMemory() << "B total";
+
+  OS << "\n  BumpPtr: " << BP.getTotalMemory();
+  OS << "\n  Macro Expanded Tokens: "
+     << llvm::capacity_in_bytes(MacroExpandedTokens);
+  OS << "\n  Macro Expansion Cache: "
+     << ExpansionCache.getMemorySize();
+  OS << "\n  Predefines Buffer: " << Predefines.capacity();
+  OS << "\n  Macros: " << llvm::capacity_in_bytes(Macros);
+  OS << "\n  Poison Reasons: "
+     << llvm::capacity_in_bytes(PoisonReasons);
+  OS << "\n  Comment Handlers: "
+     << llvm::capacity_in_bytes(CommentHandlers) << "\n";
 }
 
 Preprocessor::macro_iterator
@@ -223,9 +239,49 @@ Preprocessor::macro_begin(bool IncludeExternalMacros) const {
   return Macros.begin();
 }
 
+void Preprocessor::ReportStats(StatisticsReport &R) const {
+  R.add("preprocessor", "tokens_lexed", getNumTokensLexed());
+  R.add("preprocessor", "bytes_entered", NumBytesEntered);
+  R.add("preprocessor", "source_files_entered", NumEnteredSourceFiles);
+  R.add("preprocessor", "max_include_depth", MaxIncludeStackDepth);
+  R.add("preprocessor", "directives", NumDirectives);
+  R.add("preprocessor", "defines", NumDefined);
+  R.add("preprocessor", "undefs", NumUndefined);
+  R.add("preprocessor", "conditionals", NumIf);
+  R.add("preprocessor", "skipped_regions", NumSkipped);
+  if (CountSkippedLines)
+    R.add("preprocessor", "skipped_lines", NumSkippedLines);
+  R.add("preprocessor", "macro_expansions", NumMacroExpanded);
+  R.add("preprocessor", "function_macro_expansions", NumFnMacroExpanded);
+  R.add("preprocessor", "builtin_macro_expansions", NumBuiltinMacroExpanded);
+  R.add("preprocessor", "fast_macro_expansions", NumFastMacroExpanded);
+  R.add("preprocessor", "token_pastes", NumFastTokenPaste + NumTokenPaste);
+  R.add("preprocessor", "macro_substitutions_replayed",
+        ExpansionCache.getNumHits());
+  R.add("preprocessor", "macro_substitutions_computed",
+        ExpansionCache.getNumMisses());
+  R.add("preprocessor", "backtracks", NumBacktracks);
+  R.add("preprocessor", "sloc_entries", SourceMgr.local_sloc_entry_size());
+  R.add("preprocessor", "sloc_offset", SourceMgr.getNextLocalOffset());
+  R.add("preprocessor", "memory_bytes", getTotalMemory());
+}
+
+/// getNumTokensLexed - The tokens of the files already left, plus those
+/// lexed so far from the files still on the include stack.
+uint64_t Preprocessor::getNumTokensLexed() const {
+  uint64_t Count = NumTokensLexed;
+  if (CurLexer)
+    Count += CurLexer->NumTokensLexed;
+  for (unsigned I = 0, E = IncludeMacroStack.size(); I != E; ++I)
+    if (IncludeMacroStack[I].TheLexer)
+      Count += IncludeMacroStack[I].TheLexer->NumTokensLexed;
+  return Count;
+}
+
 size_t Preprocessor::getTotalMemory() const {
   return BP.getTotalMemory()
     + llvm::capacity_in_bytes(MacroExpandedTokens)
+    + ExpansionCache.getMemorySize()
     + Predefines.capacity() /* Predefines buffer. */
     + llvm::capacity_in_bytes(Macros)
     + llvm::capacity_in_bytes(PoisonReasons)
@@ -421,8 +477,12 @@ void Preprocessor::EnterMainSourceFile() {
       HeaderInfo.IncrementIncludeCount(FE);
   }
 
-  /*
-  // Preprocess Predefines to populate the initial preprocessor state.
+  // Preprocess Predefines to populate the initial preprocessor state.  The
+  // buffer only holds the command line `define and `undef lines, so there is
+  // nothing to enter without them.
+  if (Predefines.empty())
+    return;
+
   llvm::MemoryBuffer *SB =
     llvm::MemoryBuffer::getMemBufferCopy(Predefines, "<built-in>");
   assert(SB && "Cannot create predefined source buffer");
@@ -432,7 +492,6 @@ void Preprocessor::EnterMainSourceFile() {
 
   // Start parsing the predefines.
   EnterSourceFile(FID, 0, SourceLocation());
-  */
 }
 
 void Preprocessor::EndSourceFile() {
@@ -461,18 +520,30 @@ static void appendCodePoint(unsigned Codepoint,
 IdentifierInfo *Preprocessor::LookUpIdentifierInfo(Token &Identifier) const {
   assert(Identifier.getRawIdentifierData() != 0 && "No raw identifier data!");
 
+  // An escaped identifier names the identifier spelled without its
+  // backslash, so \n1 and n1 are the same net (IEEE 1800-2012 5.6.1).  It is
+  // an identifier even if that name is a keyword, as in \module.
+  const char *RawData = Identifier.getRawIdentifierData();
+  if (RawData[0] == '\\') {
+    IdentifierInfo *II =
+      &Identifiers.get(StringRef(RawData + 1, Identifier.getLength() - 1));
+    Identifier.setIdentifierInfo(II);
+    Identifier.setKind(tok::identifier);
+    return II;
+  }
+
   // Look up this token, see if it is a macro, or if it is a language keyword.
   IdentifierInfo *II;
   if (!Identifier.needsCleaning() ) {
     // No cleaning needed, just use the characters from the lexed buffer.
-    II = getIdentifierInfo(StringRef(Identifier.getRawIdentifierData(),
-                                     Identifier.getLength()));
+    II = &Identifiers.getIdentifierOrKeyword(
+        StringRef(Identifier.getRawIdentifierData(), Identifier.getLength()));
   } else {
     // Cleaning needed, alloca a buffer, clean into it, then use the buffer.
     SmallString<64> IdentifierBuffer;
     StringRef CleanedStr = getSpelling(Identifier, IdentifierBuffer);
 
-    II = getIdentifierInfo(CleanedStr);
+    II = &Identifiers.getIdentifierOrKeyword(CleanedStr);
   }
 
   // Update the token info (identifier info and appropriate token kind).
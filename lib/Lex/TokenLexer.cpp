@@ -17,6 +17,7 @@
 #include "vlang/Lex/LexDiagnostic.h"
 #include "vlang/Lex/MacroInfo.h"
 #include "vlang/Lex/Preprocessor.h"
+#include "vlang/Lex/PreprocessorOptions.h"
 #include "llvm/ADT/SmallString.h"
 using namespace vlang;
 
@@ -40,6 +41,8 @@ void TokenLexer::Init(Token &Tok, SourceLocation ELEnd, MacroInfo *MI,
   Tokens = &*Macro->tokens_begin();
   OwnsTokens = false;
   DisableMacroExpansion = false;
+  CollapseArgLocs = PP.getPreprocessorOpts().MacroArgLocations ==
+                    MacroArgLocs_Collapsed;
   NumTokens = Macro->tokens_end()-Macro->tokens_begin();
   MacroExpansionStart = SourceLocation();
 
@@ -90,6 +93,7 @@ void TokenLexer::Init(const Token *TokArray, unsigned NumToks,
   Tokens = TokArray;
   OwnsTokens = ownsTokens;
   DisableMacroExpansion = disableMacroExpansion;
+  CollapseArgLocs = false;
   NumTokens = NumToks;
   CurToken = 0;
   ExpandLocStart = ExpandLocEnd = SourceLocation();
@@ -122,89 +126,105 @@ void TokenLexer::destroy() {
 /// Expand the arguments of a function-like macro so that we can quickly
 /// return preexpanded tokens from Tokens.
 void TokenLexer::ExpandFunctionArguments() {
+  // A body that never mentions its parameters expands to itself.
+  if (!Macro->usesArguments())
+    return;
+
+  // Invoking a macro again with the same arguments substitutes them the same
+  // way, so replay the last substitution if there was one.
+  MacroExpansionCache *Cache = 0;
+  unsigned ArgHash = 0;
+  bool Cacheable = PP.isMacroExpansionCachingEnabled();
+  if (Cacheable) {
+    Cache = &PP.getMacroExpansionCache();
+    if (const MacroExpansionCache::Entry *E =
+          Cache->lookup(Macro, ActualArgs, ArgHash, Cacheable, PP)) {
+      ReplayFunctionArguments(*E);
+      return;
+    }
+  }
 
   SmallVector<Token, 128> ResultToks;
 
-  // Loop through 'Tokens', expanding them into ResultToks.  Keep
-  // track of whether we change anything.  If not, no need to keep them.  If so,
-  // we install the newly expanded sequence as the new 'Tokens' list.
-  bool MadeChange = false;
+  // Where each result token came from, for the cache.  A substitution that
+  // pre-expands an argument depends on more than the argument spellings, and
+  // is not cached.
+  SmallVector<int, 128> Origins;
+  SmallVector<MacroExpansionCache::Substitution, 8> Substitutions;
+  const Token *FirstArgTok = ActualArgs->getUnexpArgument(0);
 
   // NextTokGetsSpace - When this is true, the next token appended to the
   // output list will get a leading space, regardless of whether it had one to
   // begin with or not.  This is used for placemarker support.
   bool NextTokGetsSpace = false;
 
-  for (unsigned i = 0, e = NumTokens; i != e; ++i) {
-    // If we found the stringify operator, get the argument stringified.  The
-    // preprocessor already verified that the following token is a macro name
-    // when the #define was parsed.
-    const Token &CurTok = Tokens[i];
-    if (CurTok.is(tok::tick) ) {
-      int ArgNo = Macro->getArgumentNum(Tokens[i+1].getIdentifierInfo());
-      assert(ArgNo != -1 && "Token following # is not an argument?");
+  // Run the plan the macro was given when it was defined, expanding 'Tokens'
+  // into ResultToks.
+  for (MacroInfo::plan_iterator Step = Macro->plan_begin(),
+         StepEnd = Macro->plan_end(); Step != StepEnd; ++Step) {
+    const Token &CurTok = Tokens[Step->Begin];
+
+    if (Step->Kind == MacroInfo::ExpansionStep::CopyTokens) {
+      // Tokens that are not arguments are just added to the output buffer.
+      unsigned FirstResult = ResultToks.size();
+      ResultToks.append(Tokens + Step->Begin, Tokens + Step->End);
+      if (Cacheable)
+        Origins.append(Step->End - Step->Begin,
+                       MacroExpansionCache::FromBody);
+
+      if (NextTokGetsSpace) {
+        ResultToks[FirstResult].setFlag(Token::LeadingSpace);
+        NextTokGetsSpace = false;
+      }
+      continue;
+    }
 
+    if (Step->Kind == MacroInfo::ExpansionStep::StringifyArg) {
+      // The ` operator is followed by the parameter whose argument it
+      // stringifies.
+      const Token &ArgNameTok = Tokens[Step->Begin + 1];
       SourceLocation ExpansionLocStart =
           getExpansionLocForMacroDefLoc(CurTok.getLocation());
       SourceLocation ExpansionLocEnd =
-          getExpansionLocForMacroDefLoc(Tokens[i+1].getLocation());
-
-      Token Res;
-      if (CurTok.is(tok::tick))  // Stringify
-        Res = ActualArgs->getStringifiedArgument(ArgNo, PP,
-                                                 ExpansionLocStart,
-                                                 ExpansionLocEnd);
-      else {
-        // 'charify': don't bother caching these.
-        Res = MacroArgs::StringifyArgument(ActualArgs->getUnexpArgument(ArgNo),
-                                           PP,
-                                           ExpansionLocStart,
-                                           ExpansionLocEnd);
-      }
+          getExpansionLocForMacroDefLoc(ArgNameTok.getLocation());
 
-      // The stringified/charified string leading space flag gets set to match
-      // the #/#@ operator.
+      Token Res = ActualArgs->getStringifiedArgument(Step->ArgNo, PP,
+                                                     ExpansionLocStart,
+                                                     ExpansionLocEnd);
+
+      // The stringified string leading space flag gets set to match the `
+      // operator.
       if (CurTok.hasLeadingSpace() || NextTokGetsSpace)
         Res.setFlag(Token::LeadingSpace);
 
+      if (Cacheable) {
+        MacroExpansionCache::Substitution S;
+        S.Begin = ResultToks.size();
+        S.End = S.Begin + 1;
+        S.DefLoc = CurTok.getLocation();
+        S.DefLocEnd = ArgNameTok.getLocation();
+        Substitutions.push_back(S);
+        Origins.push_back(MacroExpansionCache::FromStringify);
+      }
       ResultToks.push_back(Res);
-      MadeChange = true;
-      ++i;  // Skip arg name.
       NextTokGetsSpace = false;
       continue;
     }
 
-    // Otherwise, if this is not an argument token, just add the token to the
-    // output buffer.
-    IdentifierInfo *II = CurTok.getIdentifierInfo();
-    int ArgNo = II ? Macro->getArgumentNum(II) : -1;
-    if (ArgNo == -1) {
-      // This isn't an argument, just add it.
-      ResultToks.push_back(CurTok);
-
-      if (NextTokGetsSpace) {
-        ResultToks.back().setFlag(Token::LeadingSpace);
-        NextTokGetsSpace = false;
-      }
-      continue;
-    }
-
-    // An argument is expanded somehow, the result is different than the
-    // input.
-    MadeChange = true;
-
-    // If it is not the LHS/RHS of a ## operator, we must pre-expand the
-    // argument and substitute the expanded tokens into the result.  This is
-    // C99 6.10.3.1p1.
+    // Otherwise the parameter is replaced by its argument.  We must pre-expand
+    // the argument and substitute the expanded tokens into the result.  This
+    // is C99 6.10.3.1p1.
     const Token *ResultArgToks;
 
     // Only preexpand the argument if it could possibly need it.  This
     // avoids some work in common cases.
-    const Token *ArgTok = ActualArgs->getUnexpArgument(ArgNo);
-    if (ActualArgs->ArgNeedsPreexpansion(ArgTok, PP))
-      ResultArgToks = &ActualArgs->getPreExpArgument(ArgNo, Macro, PP)[0];
-    else
+    const Token *ArgTok = ActualArgs->getUnexpArgument(Step->ArgNo);
+    if (ActualArgs->ArgNeedsPreexpansion(ArgTok, PP)) {
+      ResultArgToks = &ActualArgs->getPreExpArgument(Step->ArgNo, Macro, PP)[0];
+      Cacheable = false;
+    } else {
       ResultArgToks = ArgTok;  // Use non-preexpanded tokens.
+    }
 
     // If the arg token expanded into anything, append it.
     if (ResultArgToks->isNot(tok::eof)) {
@@ -212,10 +232,14 @@ void TokenLexer::ExpandFunctionArguments() {
       unsigned NumToks = MacroArgs::getArgLength(ResultArgToks);
       ResultToks.append(ResultArgToks, ResultArgToks+NumToks);
 
-      // If the '##' came from expanding an argument, turn it into 'unknown'
-      // to avoid pasting.
-      for (unsigned i = FirstResult, e = ResultToks.size(); i != e; ++i) {
-        Token &Tok = ResultToks[i];
+      if (Cacheable) {
+        MacroExpansionCache::Substitution S;
+        S.Begin = FirstResult;
+        S.End = FirstResult + NumToks;
+        S.DefLoc = CurTok.getLocation();
+        Substitutions.push_back(S);
+        for (unsigned i = 0; i != NumToks; ++i)
+          Origins.push_back(ArgTok - FirstArgTok + i);
       }
 
       if(ExpandLocStart.isValid()) {
@@ -236,74 +260,65 @@ void TokenLexer::ExpandFunctionArguments() {
       // formal token, make sure the next token gets whitespace before it.
       NextTokGetsSpace = CurTok.hasLeadingSpace();
     }
-    continue;
-
-    // Okay, we have a token that is either the LHS or RHS of a paste (##)
-    // argument.  It gets substituted as its non-pre-expanded tokens.
-    const Token *ArgToks = ActualArgs->getUnexpArgument(ArgNo);
-    unsigned NumToks = MacroArgs::getArgLength(ArgToks);
-    if (NumToks) {  // Not an empty argument?
-      // If this is the GNU ", ## __VA_ARGS__" extension, and we just learned
-      // that __VA_ARGS__ expands to multiple tokens, avoid a pasting error when
-      // the expander trys to paste ',' with the first token of the __VA_ARGS__
-      // expansion.
-      ResultToks.append(ArgToks, ArgToks+NumToks);
-
-      // If the '##' came from expanding an argument, turn it into 'unknown'
-      // to avoid pasting.
-      for (unsigned i = ResultToks.size() - NumToks, e = ResultToks.size();
-             i != e; ++i) {
-        Token &Tok = ResultToks[i];
-      }
-
-      if (ExpandLocStart.isValid()) {
-        updateLocForMacroArgTokens(CurTok.getLocation(),
-                                   ResultToks.end()-NumToks, ResultToks.end());
-      }
-
-      // If this token (the macro argument) was supposed to get leading
-      // whitespace, transfer this information onto the first token of the
-      // expansion.
-      //
-      // Do not do this if the paste operator occurs before the macro argument,
-      // as in "A ## MACROARG".  In valid code, the first token will get
-      // smooshed onto the preceding one anyway (forming AMACROARG).  In
-      // assembler-with-cpp mode, invalid pastes are allowed through: in this
-      // case, we do not want the extra whitespace to be added.  For example,
-      // we want ". ## foo" -> ".foo" not ". foo".
-      if ((CurTok.hasLeadingSpace() || NextTokGetsSpace))
-        ResultToks[ResultToks.size()-NumToks].setFlag(Token::LeadingSpace);
+  }
 
-      NextTokGetsSpace = false;
-      continue;
-    }
+  // An argument was substituted, so install this as the new Tokens list.
+  assert(!OwnsTokens && "This would leak if we already own the token list");
+  if (Cacheable) {
+    MacroExpansionCache::Entry &E =
+      Cache->insert(Macro, ActualArgs, ArgHash);
+    E.Tokens.assign(ResultToks.begin(), ResultToks.end());
+    E.Origins.assign(Origins.begin(), Origins.end());
+    E.Substitutions.assign(Substitutions.begin(), Substitutions.end());
+  }
 
-    // If an empty argument is on the LHS or RHS of a paste, the standard (C99
-    // 6.10.3.3p2,3) calls for a bunch of placemarker stuff to occur.  We
-    // implement this by eating ## operators when a LHS or RHS expands to
-    // empty.
-    NextTokGetsSpace |= CurTok.hasLeadingSpace();
+  // This is deleted in the dtor.
+  NumTokens = ResultToks.size();
+  // The tokens will be added to Preprocessor's cache and will be removed
+  // when this TokenLexer finishes lexing them.
+  Tokens = PP.cacheMacroExpandedTokens(this, ResultToks);
 
-    // If this is on the RHS of a paste operator, we've already copied the
-    // paste operator to the ResultToks list.  Remove it.
-    NextTokGetsSpace |= ResultToks.back().hasLeadingSpace();
-    ResultToks.pop_back();
+  // The preprocessor cache of macro expanded tokens owns these tokens,not us.
+  OwnsTokens = false;
+}
 
-    continue;
+void TokenLexer::ReplayFunctionArguments(
+                                        const MacroExpansionCache::Entry &E) {
+  SourceManager &SM = PP.getSourceManager();
+  const Token *ArgToks = ActualArgs->getUnexpArgument(0);
+  SmallVector<Token, 128> ResultToks(E.Tokens.begin(), E.Tokens.end());
+
+  // Argument tokens have the same spellings as those the entry was made from,
+  // but are taken from this invocation for their locations.  The cached token
+  // has the leading space the substitution gave it.
+  for (unsigned i = 0, e = ResultToks.size(); i != e; ++i) {
+    int Origin = E.Origins[i];
+    if (Origin < 0)
+      continue;
+    bool LeadingSpace = ResultToks[i].hasLeadingSpace();
+    ResultToks[i] = ArgToks[Origin];
+    ResultToks[i].setFlagValue(Token::LeadingSpace, LeadingSpace);
   }
 
-  // If anything changed, install this as the new Tokens list.
-  if (MadeChange) {
-    assert(!OwnsTokens && "This would leak if we already own the token list");
-    // This is deleted in the dtor.
-    NumTokens = ResultToks.size();
-    // The tokens will be added to Preprocessor's cache and will be removed
-    // when this TokenLexer finishes lexing them.
-    Tokens = PP.cacheMacroExpandedTokens(this, ResultToks);
-
-    // The preprocessor cache of macro expanded tokens owns these tokens,not us.
-    OwnsTokens = false;
+  for (unsigned i = 0, e = E.Substitutions.size(); i != e; ++i) {
+    const MacroExpansionCache::Substitution &S = E.Substitutions[i];
+    if (E.Origins[S.Begin] == MacroExpansionCache::FromStringify) {
+      // Reuse the string in the scratch buffer, expanded at this invocation.
+      Token &Tok = ResultToks[S.Begin];
+      Tok.setLocation(
+        SM.createExpansionLoc(SM.getSpellingLoc(Tok.getLocation()),
+                              getExpansionLocForMacroDefLoc(S.DefLoc),
+                              getExpansionLocForMacroDefLoc(S.DefLocEnd),
+                              Tok.getLength()));
+    } else if (ExpandLocStart.isValid()) {
+      updateLocForMacroArgTokens(S.DefLoc, ResultToks.begin() + S.Begin,
+                                 ResultToks.begin() + S.End);
+    }
   }
+
+  NumTokens = ResultToks.size();
+  Tokens = PP.cacheMacroExpandedTokens(this, ResultToks);
+  OwnsTokens = false;
 }
 
 /// Lex - Lex and return a token from this macro stream.
@@ -344,7 +359,10 @@ void TokenLexer::Lex(Token &Tok) {
   // that captures all of this.
   if (ExpandLocStart.isValid() &&   // Don't do this for token streams.
       // Check that the token's location was not already set properly.
-      SM.isBeforeInSLocAddrSpace(Tok.getLocation(), MacroStartSLocOffset)) {
+      SM.isBeforeInSLocAddrSpace(Tok.getLocation(), MacroStartSLocOffset) &&
+      // Collapsed argument tokens keep the location they were written at.
+      (!CollapseArgLocs ||
+       SM.isInSLocAddrSpace(Tok.getLocation(), MacroDefStart, MacroDefLength))) {
     SourceLocation instLoc;
     if (Tok.is(tok::comment)) {
       instLoc = SM.createExpansionLoc(Tok.getLocation(),
@@ -423,10 +441,18 @@ TokenLexer::getExpansionLocForMacroDefLoc(SourceLocation loc) const {
 ///
 /// \arg begin_tokens will be updated to a position past all the found
 /// consecutive tokens.
+///
+/// \arg MergeFileRanges keeps tokens written in a file together however far
+/// apart they are.  The tokens of one argument are all written between the
+/// parentheses of the invocation, so the chunk is no longer than that.  It
+/// can still be much longer than the 50 character gaps otherwise allowed,
+/// and the whole chunk is allocated from the local source location space,
+/// so fewer entries are traded for faster growth of NextLocalOffset.
 static void updateConsecutiveMacroArgTokens(SourceManager &SM,
                                             SourceLocation InstLoc,
                                             Token *&begin_tokens,
-                                            Token * end_tokens) {
+                                            Token * end_tokens,
+                                            bool MergeFileRanges) {
   assert(begin_tokens < end_tokens);
 
   SourceLocation FirstLoc = begin_tokens->getLocation();
@@ -453,7 +479,8 @@ static void updateConsecutiveMacroArgTokens(SourceManager &SM,
       break; // Token from different local/loaded location.
     // Check that token is not before the previous token or more than 50
     // "characters" away.
-    if (RelOffs < 0 || RelOffs > 50)
+    if (RelOffs < 0 ||
+        (RelOffs > 50 && !(MergeFileRanges && NextLoc.isFileID())))
       break;
     CurLoc = NextLoc;
   }
@@ -489,7 +516,13 @@ static void updateConsecutiveMacroArgTokens(SourceManager &SM,
 void TokenLexer::updateLocForMacroArgTokens(SourceLocation ArgIdSpellLoc,
                                             Token *begin_tokens,
                                             Token *end_tokens) {
+  // Collapsed argument tokens keep the location they were written at.
+  if (CollapseArgLocs)
+    return;
+
   SourceManager &SM = PP.getSourceManager();
+  bool MergeFileRanges = PP.getPreprocessorOpts().MacroArgLocations ==
+                         MacroArgLocs_Ranges;
 
   SourceLocation InstLoc =
       getExpansionLocForMacroDefLoc(ArgIdSpellLoc);
@@ -504,6 +537,7 @@ void TokenLexer::updateLocForMacroArgTokens(SourceLocation ArgIdSpellLoc,
       return;
     }
 
-    updateConsecutiveMacroArgTokens(SM, InstLoc, begin_tokens, end_tokens);
+    updateConsecutiveMacroArgTokens(SM, InstLoc, begin_tokens, end_tokens,
+                                    MergeFileRanges);
   }
 }
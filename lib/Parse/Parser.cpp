@@ -15,6 +15,7 @@
 #include "vlang/Sema/Sema.h"
 #include "RAIIObjectsForParser.h"
 #include "vlang/Parse/ParseDiagnostic.h"
+#include "vlang/Basic/TimeTrace.h"
 #include "llvm/Support/raw_ostream.h"
 using namespace vlang;
 
@@ -36,7 +37,8 @@ public:
 } // end anonymous namespace
 
 Parser::Parser(Preprocessor &pp, Sema &actions, bool skipFunctionBodies)
-  : PP(pp), Actions(actions), Diags(PP.getDiagnostics()) {
+  : PP(pp), Actions(actions), Diags(PP.getDiagnostics()),
+    SkipFunctionBodies(skipFunctionBodies) {
   Tok.startToken();
   Tok.setKind(tok::eof);
   Actions.CurScope = 0;
@@ -446,10 +448,12 @@ bool Parser::ParseDesignElementDeclaration()
    llvm::StringRef module_name;
    llvm::StringRef module_end_name;
    bool isInterface = false;
+   TimeTraceScope TraceScope(PP.getTimeTraceProfiler(), "DesignUnit");
 
    // TODO: Handle extern's
 
    // Find the design type being declared
+   tok::TokenKind keyword = Tok.getKind();
    DesignType type;
    switch(Tok.getKind()) {
    case tok::kw_module:
@@ -467,7 +471,12 @@ bool Parser::ParseDesignElementDeclaration()
       return false;
       break;
    }
-   ConsumeToken();
+   SourceLocation KeywordLoc = ConsumeToken();
+
+   if( SkipFunctionBodies )
+      return SkipDesignElementDeclaration(type, KeywordLoc);
+
+   Actions.ActOnStartOfDesignUnit(keyword, KeywordLoc);
 
    // Check for optional lifetime
    DeclLifetime lifetime = DeclLifetime::Unknown;
@@ -480,12 +489,14 @@ bool Parser::ParseDesignElementDeclaration()
    }
 
    // Check for name of module
+   IdentifierInfo *name = Tok.is(tok::identifier) ? Tok.getIdentifierInfo() : 0;
    if( !ParseIdentifier( &module_name ) ) {
       Diag(Tok, diag::err_expected_ident_for) << "Module";
 
       // Skip until semicolon or hit "#" or "(", or ";"
       SkipUntil(tok::hash, tok::l_paren, true);
    }
+   TraceScope.setDetail(module_name);
 
    // Call semantic analysis of design declaration start
    //	if( !actions->ActOnDesignDeclaration(module_name, type, lifetime ) ) {
@@ -519,11 +530,12 @@ bool Parser::ParseDesignElementDeclaration()
    // Process the body of the module
    while( ParseModuleItem() ) { }
 
+   SourceLocation endLoc;
    switch(Tok.getKind()){
    case tok::kw_endmodule:
    case tok::kw_endinterface:
    case tok::kw_endprogram:
-      ConsumeToken();
+      endLoc = ConsumeToken();
 //      if( type != DesignType::Module){
 //         Diag(Tok, diag::err_expected_end_design) <<  "module"
 //            << FixItHint::CreateReplacement(ExpectedLoc, tok::getTokenSimpleSpelling(tok::kw_endmodule));
@@ -543,8 +555,167 @@ bool Parser::ParseDesignElementDeclaration()
          // TODO: Check it matches start name
       }
    }
+
+   // Hand the finished unit to the consumer, if any
+   Actions.ActOnEndOfDesignUnit(name, endLoc);
+   return true;
+}
+
+/// SkipDesignElementDeclaration - Scan the header of a design unit for its
+/// name, parameters and ports, then skip its body by token matching alone.
+/// The design unit keyword has already been consumed.
+bool Parser::SkipDesignElementDeclaration(DesignType Type,
+                                          SourceLocation KeywordLoc)
+{
+   DesignUnits.push_back(DesignUnitSummary());
+   DesignUnitSummary &Unit = DesignUnits.back();
+   Unit.Kind = Type;
+   Unit.Loc = KeywordLoc;
+
+   tok::TokenKind BeginKind = tok::kw_module;
+   tok::TokenKind EndKind = tok::kw_endmodule;
+   const char *EndName = "module";
+   if( Type == DesignType::Interface ) {
+      BeginKind = tok::kw_interface;
+      EndKind = tok::kw_endinterface;
+      EndName = "interface";
+   } else if( Type == DesignType::Program ) {
+      BeginKind = tok::kw_program;
+      EndKind = tok::kw_endprogram;
+      EndName = "program";
+   }
+
+   if( Tok.is(tok::kw_static) || Tok.is(tok::kw_automatic) )
+      ConsumeToken();
+
+   if( Tok.is(tok::identifier) ) {
+      Unit.Name = Tok.getIdentifierInfo()->getName();
+      ConsumeToken();
+   } else {
+      Diag(Tok, diag::err_expected_ident_for) << EndName;
+   }
+
+   while( Tok.is(tok::kw_import) )
+      SkipUntil(tok::semi);
+
+   if( Tok.is(tok::hash) ) {
+      ConsumeToken();
+      if( Tok.is(tok::l_paren) )
+         ScanHeaderList(Unit, /*Ports=*/false);
+   }
+   if( Tok.is(tok::l_paren) )
+      ScanHeaderList(Unit, /*Ports=*/true);
+
+   ExpectAndConsumeSemi(diag::err_expected_semi_after_decl);
+
+   // Skip to the matching end keyword.  Only a nested declaration of the same
+   // kind of design unit can hide it; `extern module` only declares a header,
+   // and neither `virtual interface` nor `interface class` starts an
+   // interface.
+   unsigned Depth = 0;
+   tok::TokenKind PrevKind = tok::semi;
+   while( Tok.isNot(tok::eof) ) {
+      tok::TokenKind Kind = Tok.getKind();
+      if( Kind == EndKind ) {
+         if( Depth == 0 )
+            break;
+         --Depth;
+      } else if( Kind == BeginKind ||
+                 (BeginKind == tok::kw_module && Kind == tok::kw_macromodule) ) {
+         if( PrevKind != tok::kw_extern && PrevKind != tok::kw_virtual &&
+             !(Kind == tok::kw_interface && NextToken().is(tok::kw_class)) )
+            ++Depth;
+      }
+      PrevKind = Kind;
+      ConsumeAnyToken();
+   }
+
+   if( Tok.isNot(EndKind) ) {
+      Diag(Tok, diag::err_expected_end_design) << EndName;
+      return true;
+   }
+   Unit.EndLoc = ConsumeToken();
+
+   if( ConsumeIfMatch(tok::colon) && Tok.is(tok::identifier) )
+      ConsumeToken();
    return true;
 }
+
+/// ScanHeaderList - Record the names in a parenthesized parameter port list
+/// or port list without parsing it.  Each comma separated item at the top
+/// level contributes its last identifier before any '=', which is the
+/// parameter or port name in every form of either list.  For ports, the
+/// direction carries over from one item to the next, as in ANSI headers.
+void Parser::ScanHeaderList(DesignUnitSummary &Unit, bool Ports)
+{
+   assert(Tok.is(tok::l_paren) && "");
+   unsigned Depth = 0;
+   PortKind Direction = PortKind::Unknown;
+   StringRef Name;
+   bool SeenEqual = false;
+
+   do {
+      bool EndOfItem = false;
+      switch( Tok.getKind() ) {
+      case tok::l_paren:
+      case tok::l_square:
+      case tok::l_brace:
+         ++Depth;
+         break;
+      case tok::r_paren:
+      case tok::r_square:
+      case tok::r_brace:
+         if( Depth )
+            --Depth;
+         EndOfItem = Depth == 0;
+         break;
+      case tok::comma:
+         EndOfItem = Depth == 1;
+         break;
+      case tok::equal:
+         if( Depth == 1 )
+            SeenEqual = true;
+         break;
+      case tok::kw_input:
+         if( Depth == 1 )
+            Direction = PortKind::Input;
+         break;
+      case tok::kw_output:
+         if( Depth == 1 )
+            Direction = PortKind::Output;
+         break;
+      case tok::kw_inout:
+         if( Depth == 1 )
+            Direction = PortKind::Inout;
+         break;
+      case tok::kw_ref:
+         if( Depth == 1 )
+            Direction = PortKind::Ref;
+         break;
+      case tok::identifier:
+         if( Depth == 1 && !SeenEqual )
+            Name = Tok.getIdentifierInfo()->getName();
+         break;
+      default:
+         break;
+      }
+
+      if( EndOfItem ) {
+         if( !Name.empty() ) {
+            if( Ports ) {
+               DesignUnitPort Port = { Name, Direction };
+               Unit.Ports.push_back(Port);
+            } else {
+               Unit.Parameters.push_back(Name);
+            }
+         }
+         Name = StringRef();
+         SeenEqual = false;
+      }
+      ConsumeAnyToken();
+   } while( Depth != 0 && Tok.isNot(tok::eof) );
+}
+
 UNIMPLEMENTED_PARSE(ParseUdpDeclaration)
 UNIMPLEMENTED_PARSE(ParsePackageDeclaration)
 UNIMPLEMENTED_PARSE(ParseBindDirective)
@@ -564,12 +735,9 @@ bool Parser::ParseParameterPortList()
       return false;
    }
 
-   // TODO
-   //   if( ParseListOfParamAssignments() ) {
-   //      expect_comma = true;
-   //   }
+   unsigned flags = ParameterDecl::Port;
    do{
-      if( !ParseParameterPortDeclaration()){
+      if( !ParseParameterPortDeclaration(flags)){
          break;
       }
    } while (ConsumeIfMatch(tok::comma));
@@ -585,8 +753,42 @@ bool Parser::ParseParameterPortList()
 // parameter_port_declaration ::= parameter_declaration
 //                              | local_parameter_declaration
 //                              | data_type list_of_param_assignments
-//                              | type list_of_type_assignments
-UNIMPLEMENTED_PARSE(ParseParameterPortDeclaration)
+//                              | type list_of_type_assignments      -- TODO
+// The list_of_param_assignments of the first form, without a keyword, is
+//   handled here too; a declaration without a keyword keeps the one before it,
+//   which Flags carries from one declaration to the next.
+bool Parser::ParseParameterPortDeclaration(unsigned &Flags)
+{
+   if( Tok.is(tok::r_paren) ) {
+      return false;
+   }
+
+   if( Tok.is(tok::kw_localparam) ) {
+      Flags = ParameterDecl::Port | ParameterDecl::Local;
+      ConsumeToken();
+   } else if( Tok.is(tok::kw_parameter) ) {
+      Flags = ParameterDecl::Port;
+      ConsumeToken();
+   }
+
+   if( Tok.is(tok::kw_type) ) {
+      Diag(Tok, diag::err_unsupported_feature) << "Type parameters";
+      SkipUntil(tok::comma, tok::r_paren, true, true);
+      return true;
+   }
+
+   // data_type_or_implicit.  A user defined type name is followed by the
+   //   parameter name.
+   if( Tok.is(tok::identifier) ) {
+      if( NextToken().is(tok::identifier) ) {
+         ConsumeToken();
+      }
+   } else {
+      ParseDeclarationTypeInfo();
+   }
+
+   return ParseListOfParamAssignments(Flags);
+}
 
 // list_of_ports   ::= ( port { , port } )
 // port            ::= [ port_expression ]
@@ -1158,27 +1360,45 @@ bool Parser::ParseListOfIdentifiers(/* DeclTypeInfo *declType*/)
 
 // list_of_param_assignments ::= param_assignment { , param_assignment }
 // param_assignment ::= parameter_identifier { unpacked_dimension } [ = constant_param_expression ]
-bool Parser::ParseListOfParamAssignments()
+//   A comma is only consumed if an identifier follows it; otherwise it
+//   separates the next parameter_port_declaration.
+bool Parser::ParseListOfParamAssignments(unsigned Flags)
 {
-   llvm::StringRef ident;
    if( Tok.isNot(tok::identifier)){
+      Diag(Tok, diag::err_expected_ident);
       return false;
    }
 
-   do {
-      if( Tok.isNot(tok::identifier) ){
-         Diag(Tok, diag::err_expected_ident);
-         SkipUntil(tok::comma, true, false);
-      }
+   while(1) {
+      IdentifierInfo *name = Tok.getIdentifierInfo();
+      SourceLocation loc = ConsumeToken();
 
-      if(Tok.is(tok::l_square)) {
+      while( Tok.is(tok::l_square) ) {
          ParseDimension();
       }
 
+      ExprResult init = ExprEmpty();
       if( ConsumeIfMatch( tok::equal ) ) {
-         ParseExpression(prec::Assignment);
+         init = ParseExpression(prec::Assignment);
+         if( init.isInvalid() ) {
+            SkipUntil(tok::comma, tok::r_paren, true, true);
+         }
       }
-   } while( ConsumeIfMatch( tok::comma ) );
+      Actions.ActOnParameter(loc, name, init.isUsable() ? init.get() : 0, Flags);
+
+      // After the comma, "name =", "name [", "name ," or "name )" continues
+      //   the list; anything else, such as the type name of "my_t B = 2",
+      //   starts the next parameter_port_declaration.
+      if( Tok.isNot(tok::comma) || NextToken().isNot(tok::identifier) ) {
+         break;
+      }
+      const Token &AfterName = GetLookAheadToken(2);
+      if( AfterName.isNot(tok::equal) && AfterName.isNot(tok::l_square) &&
+          AfterName.isNot(tok::comma) && AfterName.isNot(tok::r_paren) ) {
+         break;
+      }
+      ConsumeToken();
+   }
 
    return true;
 }
@@ -1544,6 +1764,7 @@ UNIMPLEMENTED_PARSE(ParseOverloadProtoFormals)
 // TODO: pullup/pulldown
 bool Parser::ParseGateInstantiation()
 {
+   tok::TokenKind gateKind = Tok.getKind();
    switch(Tok.getKind()){
    case tok::kw_buf:   case tok::kw_bufif0:   case tok::kw_bufif1:
    case tok::kw_not:   case tok::kw_notif0:   case tok::kw_notif1:
@@ -1575,7 +1796,10 @@ bool Parser::ParseGateInstantiation()
 
    do{
       // Parse instance name
+      IdentifierInfo *name = 0;
+      SourceLocation loc = Tok.getLocation();
       if( Tok.is(tok::identifier) ){
+         name = Tok.getIdentifierInfo();
          ParseIdentifier(&ident);
       }
 
@@ -1586,11 +1810,14 @@ bool Parser::ParseGateInstantiation()
       }
       ConsumeParen();
 
+      PortConnections.clear();
       do{
-         ParseExpression(prec::Assignment);
+         PortConnections.push_back(PortConnection());
+         ParsePortConnectionActual(PortConnections.back());
       } while(ConsumeIfMatch(tok::comma));
 
       ExpectAndConsume(tok::r_paren, diag::err_expected_rparen, "", tok::semi);
+      Actions.ActOnInstance(loc, gateKind, 0, name, PortConnections);
    } while(ConsumeIfMatch(tok::comma));
 
    ExpectAndConsumeSemi(diag::err_expected_semi_after_decl);
@@ -1608,10 +1835,11 @@ bool Parser::ParseModuleInstantiation()
    if( Tok.isNot(tok::identifier)){
       return false;
    }
+   IdentifierInfo *definition = Tok.getIdentifierInfo();
    ParseIdentifier(&ident);
 
    do {
-      if( ParseHierarchicalInstance() ) {
+      if( ParseHierarchicalInstance(definition) ) {
          require_ident = true;
       } else if ( require_ident ) {
          // TODO: Error handling
@@ -1629,16 +1857,22 @@ UNIMPLEMENTED_PARSE(ParseOrderedParameterAssignment)
 UNIMPLEMENTED_PARSE(ParseNamedParameterAssignment)
 
 //  hierarchical_instance ::= name_of_instance ( [ list_of_port_connections ] )
-bool Parser::ParseHierarchicalInstance()
+bool Parser::ParseHierarchicalInstance(IdentifierInfo *Definition)
 {
    llvm::StringRef ident;
    if( Tok.isNot(tok::identifier)){
       return false;
    }
+   IdentifierInfo *name = Tok.getIdentifierInfo();
+   SourceLocation nameLoc = Tok.getLocation();
   ParseIdentifier( &ident );
   ExpectAndConsume(tok::l_paren, diag::err_expected_lparen_after, "module instance name");
-  ParseListOfPortConnections();
+  PortConnections.clear();
+  if( Tok.isNot(tok::r_paren) ) {
+     ParseListOfPortConnections(PortConnections);
+  }
   ExpectAndConsume(tok::r_paren, diag::err_expected_rparen);
+  Actions.ActOnInstance(nameLoc, tok::identifier, Definition, name, PortConnections);
    return true;
 }
 bool Parser::ParseNameOfInstance()
@@ -1653,7 +1887,7 @@ bool Parser::ParseNameOfInstance()
 // named_port_connection ::=
 //      { attribute_instance } . port_identifier [ ( [ expression ] ) ]
 //    | { attribute_instance } .*   // TODO
-bool Parser::ParseListOfPortConnections()
+bool Parser::ParseListOfPortConnections(SmallVectorImpl<PortConnection> &Connections)
 {
    llvm::StringRef ident;
 
@@ -1661,13 +1895,15 @@ bool Parser::ParseListOfPortConnections()
    bool namedPortConnection = Tok.is(tok::period);
 
    do {
+      Connections.push_back(PortConnection());
+      PortConnection &connection = Connections.back();
 
       if( Tok.isNot(tok::period) ){
          if(namedPortConnection) {
             Diag(Tok, diag::err_cant_mix_port_connection);
          }
 
-         ParseExpression(prec::Assignment);
+         ParsePortConnectionActual(connection);
          continue;
       }
 
@@ -1681,19 +1917,74 @@ bool Parser::ParseListOfPortConnections()
       if(Tok.isNot(tok::identifier)){
          Diag(Tok, diag::err_expected_ident);
          SkipUntil(tok::comma, tok::r_paren, true, true);
+         Connections.pop_back();
          continue;
       }
 
+      connection.Port = Tok.getIdentifierInfo();
+      connection.PortLoc = Tok.getLocation();
       ParseIdentifier(&ident);
 
       ExpectAndConsume(tok::l_paren, diag::err_expected_lparen_after, "port identifier");
-      ParseExpression(prec::Assignment);
+      ParsePortConnectionActual(connection);
       ExpectAndConsume(tok::r_paren, diag::err_expected_rparen);
    } while( ConsumeIfMatch( tok::comma ) );
 
    return true;
 }
 
+// Netlist fast path
+//   Nearly every connection in a post-synthesis netlist is a net or a
+//   constant bit select of a net.  Those are recognized from the tokens
+//   alone and recorded directly, everything else goes through the
+//   expression parser.
+void Parser::ParsePortConnectionActual(PortConnection &Connection)
+{
+   Connection.Loc = Tok.getLocation();
+
+   // Empty connection
+   if( Tok.is(tok::comma) || Tok.is(tok::r_paren) ) {
+      Connection.Kind = PortConnection::Unconnected;
+      return;
+   }
+
+   if( Tok.is(tok::identifier) ) {
+      tok::TokenKind nextKind = NextToken().getKind();
+
+      // net
+      if( nextKind == tok::comma || nextKind == tok::r_paren ) {
+         Connection.Kind = PortConnection::Net;
+         Connection.Net = Tok.getIdentifierInfo();
+         ConsumeToken();
+         return;
+      }
+
+      // net [ decimal_number ]
+      if( nextKind == tok::l_square &&
+          GetLookAheadToken(2).is(tok::numeric_constant) &&
+          GetLookAheadToken(3).is(tok::r_square) &&
+          (GetLookAheadToken(4).is(tok::comma) || GetLookAheadToken(4).is(tok::r_paren)) ) {
+         SmallVector<char, 16> buffer;
+         StringRef digits = PP.getSpelling(GetLookAheadToken(2), buffer);
+         unsigned bit;
+         if( !digits.getAsInteger(10, bit) ) {
+            Connection.Kind = PortConnection::NetBit;
+            Connection.Net = Tok.getIdentifierInfo();
+            Connection.Bit = bit;
+            ConsumeToken();
+            ConsumeBracket();
+            ConsumeToken();
+            ConsumeBracket();
+            return;
+         }
+      }
+   }
+
+   ExprResult actual = ParseExpression(prec::Assignment);
+   Connection.Kind = PortConnection::Expression;
+   Connection.Actual = actual.get();
+}
+
 // Section A.4.1.2 - Interface instantiation
 // Section A.4.1.3 - Program instantiation
 // Section A.4.1.4 - Checker instantiation
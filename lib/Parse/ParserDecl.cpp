@@ -115,6 +115,9 @@ TypeResult Parser::ParseDataTypeOrImplicit(NetType nType)
 // parameter_declaration ::=   parameter data_type_or_implicit list_of_param_assignments
 //                         | parameter type list_of_type_assignments
 bool Parser::ParseDataDeclarationList(){
+   // Parameters and localparams are recorded for constant evaluation
+   bool isParameter = Tok.is(tok::kw_parameter) || Tok.is(tok::kw_localparam);
+   unsigned paramFlags = Tok.is(tok::kw_localparam) ? ParameterDecl::Local : 0;
    if( Tok.is(tok::kw_parameter) || Tok.is(tok::kw_specparam) || Tok.is(tok::kw_localparam) ){
       ConsumeToken();
    }
@@ -129,10 +132,13 @@ bool Parser::ParseDataDeclarationList(){
 	// Parse list_of_*_decl_assignments
 	llvm::StringRef ident;
 	do {
+      IdentifierInfo *name = 0;
+      SourceLocation nameLoc = Tok.getLocation();
       if( Tok.isNot(tok::identifier) ){
          Diag(Tok, diag::err_expected_ident_for) << "Declaration";
          // TODO: Handle error
       } else {
+         name = Tok.getIdentifierInfo();
          ParseIdentifier(&ident);
       }
 
@@ -156,6 +162,10 @@ bool Parser::ParseDataDeclarationList(){
          }
 		}
 
+		if( isParameter && name ) {
+			Actions.ActOnParameter(nameLoc, name, expr.isUsable() ? expr.get() : 0, paramFlags);
+		}
+
 		if(expr.isUsable()) {
 			//sema->ActOnDataDeclaration(getTokenRange(tokenStart, token), ident, declTypeResult.get(), expr.release() );
 		} else {
@@ -1,8 +1,10 @@
 #include <stdio.h>
 #include <assert.h>
 #include <limits>
+#include <algorithm>
 
 #include "vlang/Parse/Parser.h"
+#include "vlang/AST/Expr.h"
 #include "vlang/Basic/TokenKinds.h"
 #include "vlang/Parse/ParseDiagnostic.h"
 #include "vlang/Sema/Sema.h"
@@ -32,7 +34,7 @@ using namespace prec;
 ExprResult Parser::ParseConcatenation( )
 {
     assert( Tok.is(tok::l_brace) && "'{' Required to enter ParseConcatenation\n");
-	ConsumeBrace();
+	SourceLocation LBraceLoc = ConsumeBrace();
 	
 	ExprVector ExprList;
 
@@ -50,16 +52,20 @@ ExprResult Parser::ParseConcatenation( )
       }
 		auto internalConcat = ParseConcatenation();
 
-		//result = sema->ActOnMultipleConcatenation(lBraceLoc.Start, rBraceLoc.Start, ExprList.front(), internalConcat.release());
-      return ExprResult(false);
+      ExpectAndConsume(tok::r_brace, diag::err_expected_rparen, "", tok::r_brace);
+      if( ExprList.size() != 1 || !ExprList.front() || internalConcat.isNotUsable() ||
+          !isa<Concatenation>(internalConcat.get()) ) {
+         return ExprEmpty();
+      }
+      return Actions.ActOnMultipleConcatenation(LBraceLoc, ExprList.front(), internalConcat.get());
     // Otherwise it is a normal concatenation
 	}
 
    ExpectAndConsume(tok::r_brace, diag::err_expected_rparen, "", tok::r_brace);
-   // TODO: Handle error correctly
-   //result = sema->ActOnConcatenation(lBraceLoc.Start, rBraceLoc.Start, ExprList, CommaList);
-
-   return ExprResult(false);
+   if( std::find(ExprList.begin(), ExprList.end(), (Expr*)0) != ExprList.end() ) {
+      return ExprEmpty();
+   }
+   return Actions.ActOnConcatenation(LBraceLoc, ExprList);
 }
 UNIMPLMENETED_PARSE_EXPR(ParseStreamingConcatenation)
 UNIMPLMENETED_PARSE_EXPR(ParseStreamOperator)
@@ -91,43 +97,63 @@ bool Parser::ParseListOfExpressions(ExprVector &Exprs){
 // tf_call ::= ps_or_hierarchical_tf_identifier { attribute_instance } [ ( list_of_arguments ) ]
 ExprResult  Parser::ParseTfCall(bool parse_ident, llvm::StringRef ident)
 {
+   // When the caller already consumed the identifier there is no callee to
+   //   build the call on
+   ExprResult callee = ExprEmpty();
    if( parse_ident) {
-      if( !ParseHierarchicalIdentifier() ) {
+      if( Tok.isNot(tok::identifier) ) {
          return ExprResult(true);
       }
+      callee = ParseHierarchicalIdentifierExpr();
    }
 
+   ExprVector args;
+   bool argsValid = true;
+   SourceLocation lParenLoc;
    if( Tok.is(tok::l_paren)) {
-      ConsumeParen();
+      lParenLoc = ConsumeParen();
 		if( Tok.isNot(tok::r_paren) ) {
-			auto listResult = ParseListOfArguments();
+			argsValid = ParseListOfArguments(args);
 		}
 
       ExpectAndConsume(tok::r_paren, diag::err_expected_rparen);
    }
-	return ExprResult(false);
+
+   if( callee.isNotUsable() || !argsValid ) {
+      return ExprEmpty();
+   }
+   if( lParenLoc.isInvalid() ) {
+      lParenLoc = callee.get()->getExprLoc();
+   }
+	return Actions.ActOnCallExpr(callee.get(), lParenLoc, args);
 }
 
 // list_of_arguments ::=
 //   [ expression ] { , [ expression ] } { , . identifier ( [ expression ] ) }
 // | . identifier ( [ expression ] ) { , . identifier ( [ expression ] ) }      -- TODO
-ExprResult Parser::ParseListOfArguments()
+//
+// Omitted arguments are added to Args as null.  Returns false if an argument
+//   could not be built.
+bool Parser::ParseListOfArguments(ExprVector &Args)
 {
-	auto result = ExprResult(false);
-	bool firstLoop = true;
+	bool valid = true;
 
 	do{
 		// Seen an empty expressions
-		if( !firstLoop && result.isInvalid()) {
+		if( Tok.is(tok::comma) || Tok.is(tok::r_paren) ) {
+			Args.push_back(0);
+			continue;
 		}
 
 		// Parse optional expression
 		auto argumentResult = ParseExpression(prec::Concatenation);
-		if( !argumentResult.isInvalid() ) {
+		if( argumentResult.isNotUsable() ) {
+			valid = false;
 		}
+		Args.push_back(argumentResult.get());
 	} while( ConsumeIfMatch(tok::comma) );
 
-	return result;
+	return valid;
 }
 
 UNIMPLMENETED_PARSE_EXPR(ParseMethodCall)
@@ -185,16 +211,19 @@ ExprResult Parser::ParseRhsExpression(ExprResult LHS, prec::Level minPrec){
 
 	while(1){
 		// Finish if precedence is less then MinPrec
-		//   Should never get a ":" here
-		if( nextTokPrec < minPrec || Tok.is(tok::colon) || Tok.is(tok::r_brace) || Tok.is(tok::l_brace))
+		//   Should never get a ":" here, and a "+:" or "-:" ends the index of
+		//   an indexed part select
+		if( nextTokPrec < minPrec || Tok.is(tok::colon) || Tok.is(tok::r_brace) || Tok.is(tok::l_brace) ||
+          isIndexedPartSelectOperator())
 			return LHS;
 
 		// Grab the token value
 		auto opTokenKind = Tok.getKind();
-		ConsumeAnyToken();
+		bool isConditional = nextTokPrec == prec::Conditional;
+		SourceLocation opLoc = ConsumeAnyToken();
 
 		ExprResult ConditionalMiddle(true);
-		if( nextTokPrec == prec::Conditional) {
+		if( isConditional ) {
          // LHS is select for condition, now we need to parse actual conditional
          ConditionalMiddle = ParseExpression(prec::Conditional);
                 
@@ -211,7 +240,9 @@ ExprResult Parser::ParseRhsExpression(ExprResult LHS, prec::Level minPrec){
 		// operator immediately to the right of the RHS.
 		auto currentPrec = nextTokPrec;
 		nextTokPrec = getBinOpPrecedence(Tok.getKind());
-		bool isRightAssoc = false;
+
+		// The conditional operator groups right to left
+		bool isRightAssoc = isConditional;
 
 		// Get the precedence of the operator to the right of the RHS.  If it binds
 		// more tightly with RHS than we do, evaluate it completely first.
@@ -222,12 +253,15 @@ ExprResult Parser::ParseRhsExpression(ExprResult LHS, prec::Level minPrec){
 		}
 		assert(nextTokPrec <= currentPrec && "Recursion didn't work!");
 
-		if( !LHS.isInvalid() ) {
-			if(ConditionalMiddle.isInvalid() ) {
-				//LHS = sema->ActOnBinaryOperation(llvm::SMRange(), opTokenKind, LHS.get(), RHS.get());
+		if( LHS.isUsable() && RHS.isUsable() && (!isConditional || ConditionalMiddle.isUsable()) ) {
+			if( isConditional ) {
+				LHS = Actions.ActOnConditionalOp(opLoc, LHS.get(), ConditionalMiddle.get(), RHS.get());
 			} else {
-				//LHS = sema->ActOnConditionalOperation(llvm::SMRange(), llvm::SMRange(), LHS.get(), ConditionalMiddle.get(), RHS.get());
+				LHS = Actions.ActOnBinaryOp(opLoc, opTokenKind, LHS.get(), RHS.get());
 			}
+		} else if( LHS.isUsable() ) {
+			// An operand could not be built, keep parsing but drop the tree
+			LHS = ExprEmpty();
 		}
 	}
 
@@ -247,14 +281,19 @@ ExprResult Parser::ParseMintypmaxExpression()
 	auto result = ParseExpression(prec::Assignment);
 
 	if( !result.isInvalid() && ConsumeIfMatch( tok::colon ) ) {
-		auto localResult = ParseExpression(prec::Assignment);
+		auto typResult = ParseExpression(prec::Assignment);
         // TODO: Handle bad expression
 
         ExpectAndConsume(tok::colon, diag::err_expected_colon);
         // TODO: Handle missing colon
 
-		localResult = ParseExpression(prec::Assignment);
+		auto maxResult = ParseExpression(prec::Assignment);
         // TODO: Handle bad expression
+
+		if( result.isUsable() && typResult.isUsable() && maxResult.isUsable() ) {
+			return Actions.ActOnMinTypMaxExpr(result.get(), typResult.get(), maxResult.get());
+		}
+		return ExprEmpty();
 	}
 	return result;
 }
@@ -299,10 +338,10 @@ UNIMPLMENETED_PARSE_EXPR(ParseGenvarExpression)
 ExprResult Parser::ParsePrimaryWithUnary()
 {
 
-	// First Check for a possible unary operator
-	auto unaryOperator = tok::unknown;
+	// First Check for possible unary operators, they apply right to left
+	SmallVector<Token, 4> unaryOperators;
    while( isUnaryOperator() ){
-		unaryOperator = Tok.getKind();
+		unaryOperators.push_back(Tok);
 		ConsumeToken();
 	}
 
@@ -311,25 +350,29 @@ ExprResult Parser::ParsePrimaryWithUnary()
 		case tok::l_brace:
 			primary = ParseConcatenation();
 			if( Tok.is(tok::l_square) ) {
-				ParseDimension();
+				primary = ParseSelectOrRange(primary);
 			}
-         return primary;
+         break;
 
 		case tok::identifier:
-         ParseHierarchicalIdentifier();
+         primary = ParseHierarchicalIdentifierExpr();
 
          // Check if it is a function/subroutine call
          //  May still be a subroutine if '(' is missing
          // tf_call ::= ps_or_hierarchical_tf_identifier { attribute_instance } [ ( list_of_arguments ) ]
          if( Tok.is(tok::l_paren) ) {
-            ConsumeParen();
-            ParseListOfArguments();
+            SourceLocation lParenLoc = ConsumeParen();
+            ExprVector args;
+            bool argsValid = Tok.is(tok::r_paren) || ParseListOfArguments(args);
                     
             ExpectAndConsume(tok::r_paren, diag::err_expected_rparen);
-         } else {
-            ParseSelectOrRange();
+            if( primary.isUsable() && argsValid ) {
+               primary = Actions.ActOnCallExpr(primary.get(), lParenLoc, args);
+            } else {
+               primary = ExprEmpty();
+            }
          }
-         return ExprResult(false);
+         break;
  
 		case tok::l_paren:
             ConsumeParen();
@@ -337,29 +380,69 @@ ExprResult Parser::ParsePrimaryWithUnary()
             // TODO: Handle primary not valid
             
             ExpectAndConsume(tok::r_paren, diag::err_expected_rparen);
-			return primary;
+			break;
 
       // primary_literal ::= number | time_literal | unbased_unsized_literal | string_literal
       // time_literal    ::= unsigned_number time_unit
       //                   | fixed_point_number time_unit
-      case tok::string_literal:
+      case tok::string_literal: {
+         SmallVector<char, 64> buffer;
+         StringRef text = PP.getSpelling(Tok, buffer);
+         if( text.size() >= 2 && text.front() == '"' && text.back() == '"' ) {
+            text = text.substr(1, text.size() - 2);
+         }
+         primary = Actions.ActOnStringLiteral(Tok.getLocation(), text);
          ConsumeStringToken();
-         return ExprResult(false);
+         break;
+      }
       case tok::base_binary:  case tok::base_signed_binary:
       case tok::base_decimal: case tok::base_signed_decimal:
       case tok::base_hex:     case tok::base_signed_hex:
       case tok::base_oct:     case tok::base_signed_oct:
       case tok::numeric_constant: case tok::numeric_constant_xz:
-         ParseNumber();
+      case tok::quote:
+         primary = ParseNumber();
          // TODO: Handle time literal
-         return ExprResult(false);
+         break;
 		default:
          // TODO: Handle error
-			break;
+			return ExprError();
 	}
 
-	// Invalid
-	return ExprResult(true);
+	// Apply the unary operators, innermost first
+	for( unsigned i = unaryOperators.size(); i != 0 && primary.isUsable(); --i ) {
+		const Token &op = unaryOperators[i-1];
+		primary = Actions.ActOnUnaryOp(op.getLocation(), op.getKind(), primary.get());
+	}
+	return primary;
+}
+
+// hierarchical_identifier select
+//   Builds a NameExpr for the first identifier, then a MemberExpr for every
+//   '.' and a SelectExpr for every '[ ]' that follows.
+ExprResult Parser::ParseHierarchicalIdentifierExpr()
+{
+   assert( Tok.is(tok::identifier) && "Identifier required to enter ParseHierarchicalIdentifierExpr");
+   ExprResult result = Actions.ActOnIdentifierExpr(Tok.getLocation(), Tok.getIdentifierInfo());
+   ConsumeToken();
+
+   while(1) {
+      if( Tok.is(tok::l_square) ) {
+         result = ParseSelectOrRange(result);
+      } else if( Tok.is(tok::period) ) {
+         ConsumeToken();
+         if( Tok.isNot(tok::identifier) ) {
+            Diag(Tok, diag::err_expected_ident);
+            return ExprEmpty();
+         }
+         if( result.isUsable() ) {
+            result = Actions.ActOnMemberExpr(result.get(), Tok.getLocation(), Tok.getIdentifierInfo());
+         }
+         ConsumeToken();
+      } else {
+         return result;
+      }
+   }
 }
 UNIMPLMENETED_PARSE_EXPR(ParseClassQualifier)
 
@@ -375,26 +458,38 @@ UNIMPLMENETED_PARSE_EXPR(ParseImplicitClassHandle)
 // constant_range ::= constant_expression : constant_expression
 // range_expression ::= expression | part_select_range
 // select ::= [ { . member_identifier bit_select } . member_identifier ] bit_select [ [ part_select_range ] ]
-ExprResult  Parser::ParseSelectOrRange(  )
+ExprResult  Parser::ParseSelectOrRange( ExprResult Base )
 {
-    if( Tok.isNot(tok::l_square)){
-        return ExprResult(true);
+    while( Tok.is(tok::l_square) ) {
+        SourceLocation lBracketLoc = ConsumeBracket();
+
+        // Get first expression value
+        auto resultLeft = ParseExpression(prec::Assignment);
+
+        auto kind = SelectExpr::BitSelect;
+        ExprResult resultRight;
+        if( ConsumeIfMatch(tok::colon) ) {
+            kind = SelectExpr::PartSelect;
+            resultRight = ParseExpression(prec::Assignment);
+        } else if( isIndexedPartSelectOperator() ) {
+            kind = Tok.is(tok::plus) ? SelectExpr::IndexedUp : SelectExpr::IndexedDown;
+            ConsumeToken();
+            ConsumeToken();
+            resultRight = ParseExpression(prec::Assignment);
+        }
+
+        ExpectAndConsume(tok::r_square, diag::err_expected_rparen);
+        // TODO: Handle missing ']'
+
+        if( Base.isUsable() && resultLeft.isUsable() &&
+            (kind == SelectExpr::BitSelect || resultRight.isUsable()) ) {
+            Base = Actions.ActOnSelectExpr(Base.get(), lBracketLoc, kind, resultLeft.get(), resultRight.get());
+        } else {
+            Base = ExprEmpty();
+        }
     }
-    
-    ConsumeBracket();
-
-    // Get first expression value
-    auto resultLeft = ParseExpression(prec::Assignment);
-    
-    if(ConsumeIfMatch(tok::colon)){
-        auto resultRight = ParseExpression(prec::Assignment);
-    }
-    
-
-    ExpectAndConsume(tok::r_square, diag::err_expected_rparen);
-    // TODO: Handle missing ']'
 
-	return ExprResult(false);
+	return Base;
 }
 
 UNIMPLMENETED_PARSE_EXPR(ParseConstantCast)
@@ -416,25 +511,25 @@ UNIMPLMENETED_PARSE_EXPR(ParseCast)
 // ps_or_hierarchical_net_identifier ::= [ package_scope ] net_identifier | hierarchical_net_identifier
 ExprResult  Parser::ParseLvalue(bool net_lvalue)
 {
-	llvm::StringRef ident;
-
 	// Handles
 	if( Tok.is(tok::l_brace)){
-        ConsumeBrace();
+        SourceLocation lBraceLoc = ConsumeBrace();
+        ExprVector lvalues;
         do {
-            ParseLvalue(true);
+            lvalues.push_back(ParseLvalue(true).get());
 		} while ( ConsumeIfMatch(tok::comma));
 
         ExpectAndConsume(tok::r_brace, diag::err_expected_rparen);
-	} else {
-		if( !ParseHierarchicalIdentifier( ) ) {
-			return ExprResult(true);
-		}
-
-		auto result = ParseSelectOrRange();
+        if( std::find(lvalues.begin(), lvalues.end(), (Expr*)0) != lvalues.end() ) {
+            return ExprEmpty();
+        }
+        return Actions.ActOnConcatenation(lBraceLoc, lvalues);
 	}
 
-	return ExprResult(false);
+	if( Tok.isNot(tok::identifier) ) {
+		return ExprResult(true);
+	}
+	return ParseHierarchicalIdentifierExpr();
 }
 
 // Section A.8.6 - Operators
@@ -503,6 +598,13 @@ bool Parser::isBinaryOperator()
 	}
 	return false;
 }
+
+// indexed_range ::= expression +: constant_expression | expression -: constant_expression
+//   There are no '+:' and '-:' tokens, so look for '+' or '-' followed by ':'
+bool Parser::isIndexedPartSelectOperator()
+{
+	return (Tok.is(tok::plus) || Tok.is(tok::minus)) && NextToken().is(tok::colon);
+}
 UNIMPLMENETED_PARSE_EXPR(ParseIncOrDecOperator)
 
 // Section A.8.7 - Numbers
@@ -549,8 +651,25 @@ UNIMPLMENETED_PARSE_EXPR(ParseIncOrDecOperator)
 
 ExprResult  Parser::ParseNumber()
 {
+   // The lexer splits '1 into a quote and a number, and 'x into a quote and
+   // an identifier.
+   if( Tok.is(tok::quote) ) {
+      Token digitToken = NextToken();
+      SmallVector<char, 8> buffer;
+      StringRef digit;
+      if( (digitToken.is(tok::numeric_constant) || digitToken.is(tok::identifier)) && !digitToken.hasLeadingSpace() ) {
+         digit = PP.getSpelling(digitToken, buffer);
+      }
+      if( digit.size() != 1 || StringRef("01xXzZ").find(digit[0]) == StringRef::npos ) {
+         return ExprError();
+      }
+      SourceLocation quoteLoc = ConsumeToken();
+      ConsumeToken();
+      return Actions.ActOnNumberLiteral(quoteLoc, digit, 1, 2, NumberLiteral::Unbased);
+   }
 
    auto baseToken = Tok;
+   SourceLocation startLoc = Tok.getLocation();
 
    // Check to see if the number is the [ size ]
 	if( Tok.is(tok::numeric_constant ) ) {
@@ -590,14 +709,26 @@ ExprResult  Parser::ParseNumber()
 		break;
 	}
 
-	// Get bitwidth
-	int bitwidth = 32;
+	// Get bitwidth, 0 when unsized
+	unsigned bitwidth = 0;
+	unsigned flags = 0;
 	if( has_base ) {
+		flags |= NumberLiteral::Based;
+		if( allow_sign ) {
+			flags |= NumberLiteral::Signed;
+		}
 
         // Consume the bitwidth
 		if( Tok.is(tok::numeric_constant) ){
-            //auto arbitraty_int = new llvm::APInt(32, token->tokenString, 10 ) ;
-			//bitwidth = arbitraty_int->getLimitedValue(std::numeric_limits<int>::max());
+			SmallVector<char, 16> buffer;
+			StringRef size = PP.getSpelling(Tok, buffer);
+			for( char c : size ) {
+				// Saturate rather than wrap on absurd sizes
+				if( c >= '0' && c <= '9' && bitwidth < (1U << 24) ) {
+					bitwidth = bitwidth * 10 + (c - '0');
+				}
+			}
+			flags |= NumberLiteral::Sized;
 			ConsumeToken();
 		}
 
@@ -605,23 +736,16 @@ ExprResult  Parser::ParseNumber()
 		ConsumeToken();
 	}
 
-	//IntegerLiteralExpr *literalExpr = nullptr;
 	switch( Tok.getKind() ) {
 	case tok::numeric_constant_xz:
-		ConsumeToken();
-		return ExprResult(false);
-		break;
 	case tok::numeric_constant:
-		//literalExpr = new IntegerLiteralExpr(getTokenRange(baseToken, token), bitwidth, radix, Tok.);
-		ConsumeToken();
-		//return ExprResult(literalExpr);
-        return ExprResult(false);
-		break;
-
     // If an identifier has Z|z|X|x|Z|z then it could be okay
-	case tok::identifier:
-      ConsumeToken();
-      return ExprResult(false);
+	case tok::identifier: {
+		SmallVector<char, 32> buffer;
+		StringRef digits = PP.getSpelling(Tok, buffer);
+		ConsumeToken();
+		return Actions.ActOnNumberLiteral(startLoc, digits, bitwidth, radix, flags);
+	}
 	default:
 		break;
 	}
@@ -0,0 +1,554 @@
+//===--- ConstantEvaluator.cpp - Evaluate constant expressions ------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+//  This file implements the four-state evaluation of constant expressions.
+//
+//  Operands are extended to the wider of the two, and are signed only if
+//  both are.  Arithmetic with an X or Z bit anywhere gives all X; the bitwise
+//  and logical operators follow the four-state truth tables.  Widths are
+//  self-determined: a value does not widen to fit the context it is used
+//  in.
+//
+//===----------------------------------------------------------------------===//
+
+#include "vlang/Sema/ConstantEvaluator.h"
+#include "vlang/AST/Expr.h"
+#include "vlang/Basic/IdentifierTable.h"
+#include "vlang/Basic/Statistics.h"
+#include "llvm/Support/raw_ostream.h"
+#include <algorithm>
+#include <cstdlib>
+using namespace vlang;
+using llvm::APInt;
+
+//===----------------------------------------------------------------------===//
+// ConstantValue
+//===----------------------------------------------------------------------===//
+
+void ConstantValue::print(raw_ostream &OS) const {
+  if (!Valid) {
+    OS << "<invalid>";
+    return;
+  }
+  if (!hasUnknownBits()) {
+    Value.print(OS, Signed);
+    return;
+  }
+  OS << getWidth() << "'b";
+  for (unsigned i = getWidth(); i != 0; --i)
+    OS << (Unknown[i - 1] ? (Value[i - 1] ? 'x' : 'z')
+                          : (Value[i - 1] ? '1' : '0'));
+}
+
+//===----------------------------------------------------------------------===//
+// Four-state helpers
+//===----------------------------------------------------------------------===//
+
+/// extend - Convert \p V to \p Width bits.  Sign extension copies an X or Z
+/// sign bit too.
+static ConstantValue extend(const ConstantValue &V, unsigned Width,
+                            bool SignExtend) {
+  if (V.getWidth() == Width)
+    return V;
+  if (SignExtend)
+    return ConstantValue(V.getValue().sextOrTrunc(Width),
+                         V.getUnknown().sextOrTrunc(Width), V.isSigned());
+  return ConstantValue(V.getValue().zextOrTrunc(Width),
+                       V.getUnknown().zextOrTrunc(Width), V.isSigned());
+}
+
+/// unify - Extend both operands to the wider width.  Returns whether the
+/// operation is signed.
+static bool unify(ConstantValue &L, ConstantValue &R) {
+  bool Signed = L.isSigned() && R.isSigned();
+  unsigned Width = std::max(L.getWidth(), R.getWidth());
+  L = extend(L, Width, Signed);
+  R = extend(R, Width, Signed);
+  return Signed;
+}
+
+/// getTruth - 1 if some bit of \p V is a known 1, 0 if all bits are known
+/// 0s, and -1 for X.
+static int getTruth(const ConstantValue &V) {
+  if ((V.getValue() & ~V.getUnknown()).getBoolValue())
+    return 1;
+  return V.getUnknown().getBoolValue() ? -1 : 0;
+}
+
+static int notTruth(int T) {
+  return T < 0 ? T : !T;
+}
+
+static ConstantValue getBit(int T) {
+  if (T < 0)
+    return ConstantValue::getAllX(1, false);
+  return ConstantValue(APInt(1, T), false);
+}
+
+/// getIndex - The value of a known index or width that fits in 63 bits.
+static bool getIndex(const ConstantValue &V, int64_t &Index) {
+  if (!V.isValid() || V.hasUnknownBits())
+    return false;
+  const APInt &I = V.getValue();
+  if (V.isSigned()) {
+    if (I.getMinSignedBits() > 63)
+      return false;
+    Index = I.getSExtValue();
+  } else {
+    if (I.getActiveBits() > 63)
+      return false;
+    Index = I.getZExtValue();
+  }
+  return true;
+}
+
+/// extractBits - Bits [LSB, LSB + Width) of \p V; X if they are not all in
+/// range.
+static ConstantValue extractBits(const ConstantValue &V, int64_t LSB,
+                                 int64_t Width) {
+  if (Width <= 0 || Width > (1 << 24))
+    return ConstantValue();
+  // Compare without adding, which could overflow for a huge LSB.
+  if (LSB < 0 || LSB > int64_t(V.getWidth()) - Width)
+    return ConstantValue::getAllX(Width, false);
+  return ConstantValue(V.getValue().lshr(LSB).trunc(Width),
+                       V.getUnknown().lshr(LSB).trunc(Width), false);
+}
+
+static ConstantValue evaluateUnary(tok::TokenKind Op, const ConstantValue &V) {
+  const APInt &Val = V.getValue(), &Unk = V.getUnknown();
+  switch (Op) {
+  case tok::plus:
+    return V;
+  case tok::minus:
+    if (V.hasUnknownBits())
+      return ConstantValue::getAllX(V.getWidth(), V.isSigned());
+    return ConstantValue(-Val, V.isSigned());
+  case tok::tilde:
+    return ConstantValue(~Val | Unk, Unk, V.isSigned());
+  case tok::exclaim:
+    return getBit(notTruth(getTruth(V)));
+
+  case tok::amp:
+  case tok::tildeamp: {
+    int T = 1;
+    if ((~Val & ~Unk).getBoolValue())
+      T = 0;
+    else if (Unk.getBoolValue())
+      T = -1;
+    return getBit(Op == tok::amp ? T : notTruth(T));
+  }
+  case tok::pipe:
+    return getBit(getTruth(V));
+  case tok::tildepipe:
+    return getBit(notTruth(getTruth(V)));
+  case tok::caret:
+  case tok::tildecaret: {
+    if (V.hasUnknownBits())
+      return getBit(-1);
+    int T = Val.countPopulation() & 1;
+    return getBit(Op == tok::caret ? T : !T);
+  }
+  default:
+    return ConstantValue();
+  }
+}
+
+/// power - Base ** Exp in the width of \p Base, for known operands.
+static ConstantValue power(const ConstantValue &Base,
+                           const ConstantValue &Exp) {
+  unsigned Width = Base.getWidth();
+  bool Signed = Base.isSigned();
+  const APInt &B = Base.getValue();
+  APInt E = Exp.getValue();
+
+  if (Exp.isSigned() && E.isNegative()) {
+    // Only 1 and -1 have a non-zero result with a negative exponent.
+    if (B == 0)
+      return ConstantValue::getAllX(Width, Signed);
+    if (B == 1)
+      return ConstantValue(APInt(Width, 1), Signed);
+    if (Signed && B.isAllOnesValue())
+      return ConstantValue(E[0] ? B : APInt(Width, 1), Signed);
+    return ConstantValue(APInt(Width, 0), Signed);
+  }
+
+  // Square and multiply; the result wraps in the width of the base.
+  APInt Result(Width, 1), Square = B;
+  for (unsigned i = 0, e = E.getActiveBits(); i != e; ++i) {
+    if (E[i])
+      Result *= Square;
+    Square *= Square;
+  }
+  return ConstantValue(Result, Signed);
+}
+
+static ConstantValue evaluateBinary(tok::TokenKind Op, ConstantValue L,
+                                    ConstantValue R) {
+  switch (Op) {
+  case tok::ampamp: {
+    int TL = getTruth(L), TR = getTruth(R);
+    if (TL == 0 || TR == 0)
+      return getBit(0);
+    return getBit(TL == 1 && TR == 1 ? 1 : -1);
+  }
+  case tok::pipepipe: {
+    int TL = getTruth(L), TR = getTruth(R);
+    if (TL == 1 || TR == 1)
+      return getBit(1);
+    return getBit(TL == 0 && TR == 0 ? 0 : -1);
+  }
+
+  // The shifts and the power keep the width and sign of the left operand.
+  case tok::lessless:
+  case tok::lesslessless:
+  case tok::greatergreater:
+  case tok::greatergreatergreater: {
+    if (R.hasUnknownBits())
+      return ConstantValue::getAllX(L.getWidth(), L.isSigned());
+    unsigned Amount = R.getValue().getLimitedValue(L.getWidth());
+    const APInt &Val = L.getValue(), &Unk = L.getUnknown();
+    if (Op == tok::lessless || Op == tok::lesslessless)
+      return ConstantValue(Val.shl(Amount), Unk.shl(Amount), L.isSigned());
+    if (Op == tok::greatergreatergreater && L.isSigned())
+      return ConstantValue(Val.ashr(Amount), Unk.ashr(Amount), true);
+    return ConstantValue(Val.lshr(Amount), Unk.lshr(Amount), L.isSigned());
+  }
+  case tok::starstar:
+    if (L.hasUnknownBits() || R.hasUnknownBits())
+      return ConstantValue::getAllX(L.getWidth(), L.isSigned());
+    return power(L, R);
+
+  default:
+    break;
+  }
+
+  bool Signed = unify(L, R);
+  unsigned Width = L.getWidth();
+  const APInt &LV = L.getValue(), &LU = L.getUnknown();
+  const APInt &RV = R.getValue(), &RU = R.getUnknown();
+  bool Unknown = L.hasUnknownBits() || R.hasUnknownBits();
+
+  switch (Op) {
+  case tok::plus:
+  case tok::minus:
+  case tok::star:
+  case tok::slash:
+  case tok::percent:
+    if (Unknown)
+      return ConstantValue::getAllX(Width, Signed);
+    switch (Op) {
+    case tok::plus:  return ConstantValue(LV + RV, Signed);
+    case tok::minus: return ConstantValue(LV - RV, Signed);
+    case tok::star:  return ConstantValue(LV * RV, Signed);
+    default:
+      break;
+    }
+    if (!RV)
+      return ConstantValue::getAllX(Width, Signed);
+    if (Op == tok::slash)
+      return ConstantValue(Signed ? LV.sdiv(RV) : LV.udiv(RV), Signed);
+    return ConstantValue(Signed ? LV.srem(RV) : LV.urem(RV), Signed);
+
+  case tok::amp: {
+    APInt One = (LV & ~LU) & (RV & ~RU);
+    APInt Zero = (~LV & ~LU) | (~RV & ~RU);
+    APInt X = ~(One | Zero);
+    return ConstantValue(One | X, X, Signed);
+  }
+  case tok::pipe: {
+    APInt One = (LV & ~LU) | (RV & ~RU);
+    APInt Zero = (~LV & ~LU) & (~RV & ~RU);
+    APInt X = ~(One | Zero);
+    return ConstantValue(One | X, X, Signed);
+  }
+  case tok::caret:
+  case tok::tildecaret:
+  case tok::carettilde: {
+    APInt X = LU | RU;
+    APInt Val = LV ^ RV;
+    if (Op != tok::caret)
+      Val.flipAllBits();
+    return ConstantValue(Val | X, X, Signed);
+  }
+
+  case tok::equalequal:
+  case tok::exclaimequal:
+  case tok::equalequalquestion:
+  case tok::exclaimequalquestion: {
+    // The wildcard equalities ignore the X and Z bits of the right operand.
+    bool Wildcard = Op == tok::equalequalquestion ||
+                    Op == tok::exclaimequalquestion;
+    int T;
+    if (((LV ^ RV) & ~LU & ~RU).getBoolValue())
+      T = 0;
+    else if (Wildcard ? (LU & ~RU).getBoolValue() : Unknown)
+      T = -1;
+    else
+      T = 1;
+    bool Equal = Op == tok::equalequal || Op == tok::equalequalquestion;
+    return getBit(Equal ? T : notTruth(T));
+  }
+  case tok::equalequalequal:
+    return getBit(LV == RV && LU == RU);
+  case tok::exclaimequalequal:
+    return getBit(LV != RV || LU != RU);
+
+  case tok::less:
+  case tok::lessequal:
+  case tok::greater:
+  case tok::greaterequal:
+    if (Unknown)
+      return getBit(-1);
+    switch (Op) {
+    case tok::less:    return getBit(Signed ? LV.slt(RV) : LV.ult(RV));
+    case tok::lessequal: return getBit(Signed ? LV.sle(RV) : LV.ule(RV));
+    case tok::greater: return getBit(Signed ? LV.sgt(RV) : LV.ugt(RV));
+    default:           return getBit(Signed ? LV.sge(RV) : LV.uge(RV));
+    }
+
+  default:
+    return ConstantValue();
+  }
+}
+
+//===----------------------------------------------------------------------===//
+// ConstantEvaluator
+//===----------------------------------------------------------------------===//
+
+ConstantEvaluator::ConstantEvaluator() : NumEvaluations(0), NumCacheHits(0) {}
+
+void ConstantEvaluator::setParameters(ArrayRef<ParameterDecl> P) {
+  clear();
+  Params = P;
+}
+
+void ConstantEvaluator::clear() {
+  Params = ArrayRef<ParameterDecl>();
+  Index.clear();
+  Cache.clear();
+}
+
+ConstantValue ConstantEvaluator::evaluate(const Expr *E) {
+  llvm::DenseMap<const Expr *, ConstantValue>::iterator I = Cache.find(E);
+  if (I != Cache.end()) {
+    ++NumCacheHits;
+    return I->second;
+  }
+  if (std::find(InProgress.begin(), InProgress.end(), E) != InProgress.end())
+    return ConstantValue();
+
+  ++NumEvaluations;
+  InProgress.push_back(E);
+  ConstantValue Result = evaluateUncached(E);
+  InProgress.pop_back();
+  Cache[E] = Result;
+  return Result;
+}
+
+ConstantValue ConstantEvaluator::evaluateParameter(IdentifierInfo *Name) {
+  if (Index.empty())
+    for (unsigned i = 0, e = Params.size(); i != e; ++i)
+      Index.insert(std::make_pair(Params[i].Name, i));
+
+  llvm::DenseMap<IdentifierInfo *, unsigned>::iterator I = Index.find(Name);
+  if (I == Index.end() || !Params[I->second].Init)
+    return ConstantValue();
+  return evaluate(Params[I->second].Init);
+}
+
+ConstantValue ConstantEvaluator::evaluateUncached(const Expr *E) {
+  switch (E->getExprClass()) {
+  case Expr::NumberLiteralClass: {
+    const NumberLiteral *N = cast<NumberLiteral>(E);
+    if (!N->isDecoded())
+      return ConstantValue();
+    // Unsized decimal numbers are signed.
+    bool Signed = N->isSigned() || (!N->isBased() && !N->isUnbasedUnsized());
+    return ConstantValue(APInt(N->getWidth(), N->getValueWords()),
+                         APInt(N->getWidth(), N->getUnknownWords()), Signed);
+  }
+
+  case Expr::StringLiteralClass: {
+    StringRef Str = cast<StringLiteral>(E)->getString();
+    unsigned Width = std::max<size_t>(Str.size(), 1) * 8;
+    APInt Val(Width, 0);
+    for (unsigned i = 0, e = Str.size(); i != e; ++i)
+      Val = Val.shl(8) | APInt(Width, (unsigned char)Str[i]);
+    return ConstantValue(Val, false);
+  }
+
+  case Expr::NameExprClass:
+    return evaluateParameter(cast<NameExpr>(E)->getName());
+
+  case Expr::SelectExprClass: {
+    const SelectExpr *S = cast<SelectExpr>(E);
+    ConstantValue Base = evaluateUncached(S->getBase());
+    ConstantValue Index = evaluateUncached(S->getIndex());
+    if (!Base.isValid() || !Index.isValid())
+      return ConstantValue();
+
+    int64_t I, W = 1;
+    if (S->getSelectKind() != SelectExpr::BitSelect) {
+      ConstantValue Second = evaluateUncached(S->getWidth());
+      if (!getIndex(Second, W))
+        return ConstantValue();
+    }
+    if (S->getSelectKind() == SelectExpr::PartSelect) {
+      // W is the lsb here.
+      int64_t MSB;
+      if (!getIndex(Index, MSB))
+        return ConstantValue();
+      return extractBits(Base, std::min(MSB, W), std::abs(MSB - W) + 1);
+    }
+    if (!getIndex(Index, I))
+      return S->getSelectKind() == SelectExpr::BitSelect ?
+        ConstantValue::getAllX(1, false) : ConstantValue();
+    if (S->getSelectKind() == SelectExpr::IndexedDown)
+      I -= W - 1;
+    return extractBits(Base, I, W);
+  }
+
+  case Expr::UnaryOperatorClass: {
+    const UnaryOperator *U = cast<UnaryOperator>(E);
+    ConstantValue V = evaluateUncached(U->getSubExpr());
+    if (!V.isValid())
+      return V;
+    return evaluateUnary(U->getOpcode(), V);
+  }
+
+  case Expr::BinaryOperatorClass: {
+    const BinaryOperator *B = cast<BinaryOperator>(E);
+    ConstantValue L = evaluateUncached(B->getLHS());
+    if (!L.isValid())
+      return L;
+    ConstantValue R = evaluateUncached(B->getRHS());
+    if (!R.isValid())
+      return R;
+    return evaluateBinary(B->getOpcode(), L, R);
+  }
+
+  case Expr::ConditionalOperatorClass: {
+    const ConditionalOperator *C = cast<ConditionalOperator>(E);
+    ConstantValue Cond = evaluateUncached(C->getCond());
+    if (!Cond.isValid())
+      return Cond;
+    // Only the selected arm is evaluated, so that it may guard the other.
+    int T = getTruth(Cond);
+    if (T == 1)
+      return evaluateUncached(C->getTrueExpr());
+    if (T == 0)
+      return evaluateUncached(C->getFalseExpr());
+
+    // An X condition merges the arms: bits that agree are kept, the others
+    // become X.
+    ConstantValue L = evaluateUncached(C->getTrueExpr());
+    ConstantValue R = evaluateUncached(C->getFalseExpr());
+    if (!L.isValid() || !R.isValid())
+      return ConstantValue();
+    bool Signed = unify(L, R);
+    APInt X = (L.getValue() ^ R.getValue()) | L.getUnknown() | R.getUnknown();
+    return ConstantValue(L.getValue() | X, X, Signed);
+  }
+
+  case Expr::ConcatenationClass: {
+    ArrayRef<Expr *> Exprs = cast<Concatenation>(E)->getExprs();
+    SmallVector<ConstantValue, 8> Parts;
+    unsigned Width = 0;
+    for (unsigned i = 0, e = Exprs.size(); i != e; ++i) {
+      Parts.push_back(evaluateUncached(Exprs[i]));
+      if (!Parts.back().isValid())
+        return ConstantValue();
+      Width += Parts.back().getWidth();
+    }
+    if (!Width)
+      return ConstantValue();
+
+    // The first operand is the most significant.
+    APInt Val(Width, 0), Unk(Width, 0);
+    unsigned Pos = Width;
+    for (unsigned i = 0, e = Parts.size(); i != e; ++i) {
+      Pos -= Parts[i].getWidth();
+      Val |= Parts[i].getValue().zext(Width).shl(Pos);
+      Unk |= Parts[i].getUnknown().zext(Width).shl(Pos);
+    }
+    return ConstantValue(Val, Unk, false);
+  }
+
+  case Expr::MultipleConcatenationClass: {
+    const MultipleConcatenation *M = cast<MultipleConcatenation>(E);
+    int64_t Count;
+    if (!getIndex(evaluateUncached(M->getCount()), Count) || Count <= 0)
+      return ConstantValue();
+    ConstantValue Inner = evaluateUncached(M->getConcatenation());
+    // Divide rather than multiply, which could overflow for a huge count.
+    if (!Inner.isValid() || Inner.getWidth() == 0 ||
+        Count > (1 << 24) / Inner.getWidth())
+      return ConstantValue();
+
+    unsigned InnerWidth = Inner.getWidth(), Width = Count * InnerWidth;
+    APInt Val(Width, 0), Unk(Width, 0);
+    APInt InnerVal = Inner.getValue().zext(Width);
+    APInt InnerUnk = Inner.getUnknown().zext(Width);
+    for (int64_t i = 0; i != Count; ++i) {
+      Val |= InnerVal.shl(i * InnerWidth);
+      Unk |= InnerUnk.shl(i * InnerWidth);
+    }
+    return ConstantValue(Val, Unk, false);
+  }
+
+  case Expr::CallExprClass:
+    return evaluateCall(cast<CallExpr>(E));
+
+  case Expr::MinTypMaxExprClass:
+    return evaluateUncached(cast<MinTypMaxExpr>(E)->getTyp());
+
+  case Expr::MemberExprClass:
+    // Hierarchical references are not constant.
+    return ConstantValue();
+  }
+  return ConstantValue();
+}
+
+/// evaluateCall - The constant system functions.  Constant user functions
+/// are not evaluated.
+ConstantValue ConstantEvaluator::evaluateCall(const CallExpr *E) {
+  const NameExpr *Callee = dyn_cast<NameExpr>(E->getCallee());
+  if (!Callee || E->getNumArgs() != 1 || !E->getArgs()[0])
+    return ConstantValue();
+  StringRef Name = Callee->getName()->getName();
+  ConstantValue Arg = evaluateUncached(E->getArgs()[0]);
+  if (!Arg.isValid())
+    return Arg;
+
+  // $clog2 and $bits return an integer.
+  if (Name == "$clog2") {
+    if (Arg.hasUnknownBits())
+      return ConstantValue::getAllX(32, true);
+    const APInt &V = Arg.getValue();
+    return ConstantValue(APInt(32, !V ? 0 : V.ceilLogBase2()), true);
+  }
+  if (Name == "$bits")
+    return ConstantValue(APInt(32, Arg.getWidth()), true);
+  if (Name == "$signed" || Name == "$unsigned") {
+    Arg.setSigned(Name == "$signed");
+    return Arg;
+  }
+  return ConstantValue();
+}
+
+void ConstantEvaluator::PrintStats(raw_ostream &OS) const {
+  OS << NumEvaluations << " constant expressions evaluated, "
+     << NumCacheHits << " cache hits.\n";
+}
+
+void ConstantEvaluator::ReportStats(StatisticsReport &R) const {
+  R.add("constant_evaluator", "evaluations", NumEvaluations);
+  R.add("constant_evaluator", "cache_hits", NumCacheHits);
+}
@@ -13,6 +13,7 @@
 //===----------------------------------------------------------------------===//
 
 #include "vlang/Basic/FileManager.h"
+#include "vlang/Basic/Statistics.h"
 #include "vlang/Diag/PartialDiagnostic.h"
 #include "vlang/Lex/CodeCompletionHandler.h"
 #include "vlang/Lex/HeaderSearch.h"
@@ -27,7 +28,9 @@ Sema::Sema(Preprocessor &pp, TranslationUnitKind TUKind,
   : LangOpts(pp.getLangOpts()), PP(pp),
     Diags(PP.getDiagnostics()), SourceMgr(PP.getSourceManager()),
     CollectStats(false), CodeCompleter(CodeCompleter),
-    CurScope(0)
+    Consumer(0), NumConsumedUnits(0), CurUnitKeyword(tok::unknown),
+    CurUnitFirstInstance(0), CurUnitFirstParameter(0),
+    CurUnitHasParameterPorts(false), CurScope(0)
 {
   TUScope = 0;
 }
@@ -40,16 +43,51 @@ Sema::~Sema() {
 }
 
 /// \brief Print out statistics about the semantic analysis.
-void Sema::PrintStats() const {
-  llvm::errs() << "\n*** Semantic Analysis Stats:\n";
+void Sema::PrintStats(raw_ostream &OS) const {
+  OS << "\n*** Semantic Analysis Stats:\n";
+
+  unsigned NumDirect = 0;
+  for (unsigned i = 0, e = PortConnections.size(); i != e; ++i)
+    if (PortConnections[i].getKind() != PortConnection::Expression)
+      ++NumDirect;
+  OS << Instances.size() << " instances, "
+     << PortConnections.size() << " port connections ("
+     << NumDirect << " without expressions).\n";
+  OS << Parameters.size() << " parameters.\n";
+  ConstEval.PrintStats(OS);
+  if (Consumer)
+    OS << NumConsumedUnits << " design units handed to the "
+       << "consumer; the counts are for the last one.\n";
+
+  OS << BumpAlloc.getTotalMemory() << " bytes allocated for design units.\n";
+}
 
-  BumpAlloc.PrintStats();
+void Sema::ReportStats(StatisticsReport &R) const {
+  unsigned NumDirect = 0;
+  for (unsigned i = 0, e = PortConnections.size(); i != e; ++i)
+    if (PortConnections[i].getKind() != PortConnection::Expression)
+      ++NumDirect;
+  R.add("sema", "instances", Instances.size());
+  R.add("sema", "port_connections", PortConnections.size());
+  R.add("sema", "direct_port_connections", NumDirect);
+  R.add("sema", "parameters", Parameters.size());
+  if (Consumer)
+    R.add("sema", "consumed_design_units", NumConsumedUnits);
+  R.add("sema", "memory_bytes", BumpAlloc.getTotalMemory());
+  ConstEval.ReportStats(R);
 }
 
 //===----------------------------------------------------------------------===//
 // Helper functions.
 //===----------------------------------------------------------------------===//
 
+StringRef Sema::copyString(StringRef Str) {
+  if (Str.empty())
+    return StringRef();
+  char *Mem = static_cast<char *>(BumpAlloc.Allocate(Str.size(), 1));
+  memcpy(Mem, Str.data(), Str.size());
+  return StringRef(Mem, Str.size());
+}
 
 void Sema::EmitCurrentDiagnostic(unsigned DiagID) {
 
@@ -0,0 +1,76 @@
+//===--- SemaDecl.cpp - Semantic Analysis for Declarations ----------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+//  This file implements the actions for design unit and parameter
+//  declarations, and hands finished design units to the DesignUnitConsumer.
+//
+//===----------------------------------------------------------------------===//
+
+#include "vlang/AST/DesignUnitConsumer.h"
+#include "vlang/Sema/Sema.h"
+using namespace vlang;
+
+DesignUnitConsumer::~DesignUnitConsumer() {}
+
+void Sema::ActOnStartOfDesignUnit(tok::TokenKind Keyword,
+                                  SourceLocation Loc) {
+  assert(CurUnitKeyword == tok::unknown && "Design units do not nest");
+  CurUnitKeyword = Keyword;
+  CurUnitLoc = Loc;
+  CurUnitFirstInstance = Instances.size();
+  CurUnitFirstParameter = Parameters.size();
+  CurUnitHasParameterPorts = false;
+}
+
+void Sema::ActOnEndOfDesignUnit(IdentifierInfo *Name, SourceLocation EndLoc) {
+  assert(CurUnitKeyword != tok::unknown && "No design unit to end");
+  tok::TokenKind Keyword = CurUnitKeyword;
+  CurUnitKeyword = tok::unknown;
+  if (!Consumer)
+    return;
+
+  DesignUnit Unit;
+  Unit.Keyword = Keyword;
+  Unit.Name = Name;
+  Unit.Loc = CurUnitLoc;
+  Unit.EndLoc = EndLoc;
+  Unit.Instances = ArrayRef<InstanceRecord>(Instances).slice(
+      CurUnitFirstInstance);
+  Unit.Parameters = ArrayRef<ParameterDecl>(Parameters).slice(
+      CurUnitFirstParameter);
+  Unit.PortConnections = PortConnections;
+  ConstEval.setParameters(Unit.Parameters);
+  Consumer->HandleDesignUnit(Unit);
+  ++NumConsumedUnits;
+
+  // Nothing built for a design unit is referenced after it, so start the
+  // next one from empty buffers.  The vectors keep their capacity.
+  Instances.clear();
+  PortConnections.clear();
+  Parameters.clear();
+  ConstEval.clear();
+  BumpAlloc.Reset();
+}
+
+void Sema::ActOnParameter(SourceLocation Loc, IdentifierInfo *Name,
+                          Expr *Init, unsigned Flags) {
+  // Once a unit has a parameter port list, the parameters of its body can
+  // no longer be overridden (IEEE 1800-2012 6.20.1).
+  if (Flags & ParameterDecl::Port)
+    CurUnitHasParameterPorts = true;
+  else if (CurUnitHasParameterPorts)
+    Flags |= ParameterDecl::Local;
+
+  ParameterDecl P;
+  P.Name = Name;
+  P.Init = Init;
+  P.Loc = Loc;
+  P.Flags = Flags;
+  Parameters.push_back(P);
+}
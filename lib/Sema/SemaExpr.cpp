@@ -0,0 +1,121 @@
+//===--- SemaExpr.cpp - Semantic Analysis for Expressions -----------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+//  This file implements the expression building actions.  Every node is
+//  allocated from BumpAlloc, and the text of literals is copied there too so
+//  that the AST does not depend on the lifetime of the source buffers.
+//
+//===----------------------------------------------------------------------===//
+
+#include "vlang/AST/Expr.h"
+#include "vlang/Lex/LexDiagnostic.h"
+#include "vlang/Lex/LiteralSupport.h"
+#include "vlang/Sema/Sema.h"
+#include <algorithm>
+using namespace vlang;
+
+Expr *Sema::ActOnNumberLiteral(SourceLocation Loc, StringRef Digits,
+                               unsigned Width, unsigned Radix,
+                               unsigned Flags) {
+  NumberLiteral *Lit = new (BumpAlloc) NumberLiteral(Loc, copyString(Digits),
+                                                     Width, Radix, Flags);
+
+  // Real numbers are only recognized, not decoded.
+  if (!(Flags & NumberLiteral::Based) && !(Flags & NumberLiteral::Unbased) &&
+      Digits.find_first_of(".eE") != StringRef::npos)
+    return Lit;
+
+  if (Flags & NumberLiteral::Unbased)
+    Width = 1;
+  else if (!(Flags & NumberLiteral::Sized))
+    Width = std::max(32U, getIntegralLiteralWidth(Digits, Radix));
+  if (!Width)
+    return Lit;
+
+  // Decode straight into the arena: the value words, then the unknown words.
+  unsigned NumWords = (Width + 63) / 64;
+  uint64_t *Words = BumpAlloc.Allocate<uint64_t>(2 * NumWords);
+  char BadDigit;
+  if (!decodeIntegralLiteral(Digits, Radix, Width, Words, Words + NumWords,
+                             BadDigit)) {
+    unsigned DiagID = Radix == 2 ? diag::err_invalid_binary_digit :
+                      Radix == 8 ? diag::err_invalid_octal_digit :
+                      Radix == 16 ? diag::err_invalid_hex_digit :
+                      diag::err_invalid_decimal_digit;
+    if (BadDigit)
+      Diag(Loc, DiagID) << StringRef(&BadDigit, 1);
+    return Lit;
+  }
+
+  bool HasXZ = false;
+  for (unsigned i = 0; i != NumWords && !HasXZ; ++i)
+    HasXZ = Words[NumWords + i] != 0;
+  Lit->setValue(Width, Words, HasXZ);
+  return Lit;
+}
+
+Expr *Sema::ActOnStringLiteral(SourceLocation Loc, StringRef Text) {
+  return new (BumpAlloc) StringLiteral(Loc, copyString(Text));
+}
+
+Expr *Sema::ActOnIdentifierExpr(SourceLocation Loc, IdentifierInfo *II) {
+  return new (BumpAlloc) NameExpr(Loc, II);
+}
+
+Expr *Sema::ActOnMemberExpr(Expr *Base, SourceLocation MemberLoc,
+                            IdentifierInfo *Member) {
+  return new (BumpAlloc) MemberExpr(Base, MemberLoc, Member);
+}
+
+Expr *Sema::ActOnSelectExpr(Expr *Base, SourceLocation LBracketLoc,
+                            SelectExpr::SelectKind Kind, Expr *Index,
+                            Expr *Width) {
+  assert((Kind == SelectExpr::BitSelect) == (Width == 0) &&
+         "Only a bit select has no second operand");
+  return new (BumpAlloc) SelectExpr(Base, LBracketLoc, Kind, Index, Width);
+}
+
+Expr *Sema::ActOnUnaryOp(SourceLocation OpLoc, tok::TokenKind Op,
+                         Expr *Operand) {
+  return new (BumpAlloc) UnaryOperator(OpLoc, Op, Operand);
+}
+
+Expr *Sema::ActOnBinaryOp(SourceLocation OpLoc, tok::TokenKind Op,
+                          Expr *LHS, Expr *RHS) {
+  return new (BumpAlloc) BinaryOperator(OpLoc, Op, LHS, RHS);
+}
+
+Expr *Sema::ActOnConditionalOp(SourceLocation QuestionLoc, Expr *Cond,
+                               Expr *LHS, Expr *RHS) {
+  return new (BumpAlloc) ConditionalOperator(QuestionLoc, Cond, LHS, RHS);
+}
+
+Expr *Sema::ActOnConcatenation(SourceLocation LBraceLoc,
+                               ArrayRef<Expr *> Exprs) {
+  void *Mem = BumpAlloc.Allocate(Concatenation::totalSizeToAlloc(Exprs.size()),
+                                 llvm::alignOf<Expr *>());
+  return new (Mem) Concatenation(LBraceLoc, Exprs);
+}
+
+Expr *Sema::ActOnMultipleConcatenation(SourceLocation LBraceLoc, Expr *Count,
+                                       Expr *Inner) {
+  return new (BumpAlloc) MultipleConcatenation(LBraceLoc, Count,
+                                               cast<Concatenation>(Inner));
+}
+
+Expr *Sema::ActOnCallExpr(Expr *Callee, SourceLocation LParenLoc,
+                          ArrayRef<Expr *> Args) {
+  void *Mem = BumpAlloc.Allocate(CallExpr::totalSizeToAlloc(Args.size()),
+                                 llvm::alignOf<CallExpr>());
+  return new (Mem) CallExpr(Callee, LParenLoc, Args);
+}
+
+Expr *Sema::ActOnMinTypMaxExpr(Expr *Min, Expr *Typ, Expr *Max) {
+  return new (BumpAlloc) MinTypMaxExpr(Min, Typ, Max);
+}
@@ -0,0 +1,32 @@
+//===--- SemaInstance.cpp - Semantic Analysis for Instantiations ----------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+//  This file implements the actions for module, primitive and gate
+//  instantiations.
+//
+//===----------------------------------------------------------------------===//
+
+#include "vlang/AST/Instance.h"
+#include "vlang/Sema/Sema.h"
+using namespace vlang;
+
+void Sema::ActOnInstance(SourceLocation Loc, tok::TokenKind GateKind,
+                         IdentifierInfo *Definition, IdentifierInfo *Name,
+                         ArrayRef<PortConnection> Connections) {
+  InstanceRecord I;
+  I.Definition = Definition;
+  I.Name = Name;
+  I.Loc = Loc;
+  I.GateKind = GateKind;
+  I.FirstConnection = PortConnections.size();
+  I.NumConnections = Connections.size();
+  Instances.push_back(I);
+  PortConnections.insert(PortConnections.end(), Connections.begin(),
+                         Connections.end());
+}
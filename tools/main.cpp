@@ -10,7 +10,14 @@
 #include <cstdio>
 #include <cstdlib>
 #include <cassert>
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
 
+#include "llvm/ADT/SmallString.h"
 #include "llvm/Support/CommandLine.h"
 
 //===----------------------------------------------------------------------===//
@@ -18,20 +25,30 @@
 //===----------------------------------------------------------------------===//
 #include "vlang/Lex/Preprocessor.h"
 #include "vlang/Lex/Lexer.h"
+#include "vlang/AST/DesignUnitConsumer.h"
 #include "vlang/Diag/Diagnostic.h"
 #include "vlang/Diag/DiagnosticOptions.h"
 #include "vlang/Diag/TextDiagnosticPrinter.h"
+#include "vlang/Basic/CharScan.h"
 #include "vlang/Basic/FileManager.h"
+#include "vlang/Basic/FileSystemStatCache.h"
+#include "vlang/Basic/JSON.h"
 #include "vlang/Basic/SourceManager.h"
+#include "vlang/Basic/Statistics.h"
 #include "vlang/Basic/TargetInfo.h"
 #include "vlang/Basic/TargetOptions.h"
+#include "vlang/Basic/TimeTrace.h"
 #include "vlang/Lex/PreprocessorOptions.h"
 #include "vlang/Lex/HeaderSearchOptions.h"
 #include "vlang/Lex/HeaderSearch.h"
+#include "vlang/Lex/PTHManager.h"
 #include "vlang/Parse/Parser.h"
 #include "vlang/Sema/Sema.h"
+#include <llvm/Support/PathV2.h>
 #include <llvm/Support/system_error.h>
 #include <llvm/Support/raw_ostream.h>
+#include "vlang/Frontend/DependencyOutputOptions.h"
+#include "vlang/Frontend/PreprocessorOutputOptions.h"
 #include "vlang/Frontend/Utils.h"
 #include "vlang/Basic/TokenKinds.h"
 
@@ -47,53 +64,693 @@ static cl::list<std::string> InputFilenames(cl::Positional, cl::OneOrMore,
 static cl::list<std::string> HeaderSearchPaths("I", cl::NormalFormatting, cl::ZeroOrMore,
                                  cl::desc("Path to Headers"));
 
+static cl::opt<unsigned> NumJobs("j", cl::desc("Number of input files to parse in parallel"),
+                                 cl::value_desc("N"), cl::init(1));
+
+static cl::opt<std::string> StatCacheFile("stat-cache",
+                                 cl::desc("Remember failed file system probes across runs in <file>"),
+                                 cl::value_desc("file"));
+
+static cl::opt<std::string> EmitTokenCache("emit-token-cache",
+                                 cl::desc("Write the tokens of the input and every file it includes to <file>"),
+                                 cl::value_desc("file"));
+
+static cl::opt<std::string> IncludeTokenCache("include-token-cache",
+                                 cl::desc("Replay tokens from <file> instead of re-lexing cached files"),
+                                 cl::value_desc("file"));
+
+static cl::opt<std::string> PrintStats("print-stats", cl::ValueOptional,
+                                 cl::desc("Print preprocessor, `include and semantic analysis statistics for each input; with =json, print them as one JSON document after all inputs"),
+                                 cl::value_desc("json"));
+
+static cl::opt<unsigned> SplitSize("split-size",
+                                 cl::desc("With -j, parse inputs larger than N bytes in chunks of at least N bytes, split at design unit boundaries"),
+                                 cl::value_desc("N"), cl::init(16 << 20));
+
+static cl::opt<bool> SkipBodies("skip-bodies",
+                                 cl::desc("Only scan design unit headers and print the design units of each input"));
+
+static cl::opt<bool> StreamUnits("stream-units",
+                                 cl::desc("Print the instance counts of each design unit as soon as it is parsed, and release its memory"));
+
+static cl::opt<std::string> TimeTraceFile("ftime-trace",
+                                 cl::desc("Write a Chrome trace of the files, macro expansions and design units of each input to <file>"),
+                                 cl::value_desc("file"));
+
+static cl::opt<unsigned> TimeTraceGranularity("ftime-trace-granularity",
+                                 cl::desc("Leave regions shorter than N microseconds out of the time trace"),
+                                 cl::value_desc("N"), cl::init(500));
+
+static cl::opt<bool> PreprocessOnly("E",
+                                 cl::desc("Only run the preprocessor, and write its output to stdout or to -o"));
+
+static cl::opt<bool> NoLineMarkers("P",
+                                 cl::desc("With -E, do not write `line markers"));
+
+static cl::opt<std::string> OutputFilename("o",
+                                 cl::desc("With -E, write the output to <file>"),
+                                 cl::value_desc("file"));
+
+static cl::opt<bool> DependencyFile("MD",
+                                 cl::desc("Write a make rule listing the `include files of each input to the input with a .d extension"));
+
+static cl::opt<std::string> DependencyOutputFile("MF",
+                                 cl::desc("Write the dependency rule of the input to <file>; implies -MD"),
+                                 cl::value_desc("file"));
+
+static cl::list<std::string> DependencyTargets("MT", cl::ZeroOrMore,
+                                 cl::desc("Target of the dependency rule of the input (default: the input with a .o extension)"),
+                                 cl::value_desc("target"));
+
+static cl::opt<bool> DependencyPhonyTargets("MP",
+                                 cl::desc("Add an empty rule for each `include file to the dependency file"));
+
+static cl::opt<bool> DependencyMissingHeaders("MG",
+                                 cl::desc("List `include files that do not exist as dependencies instead of failing"));
+
+static cl::opt<bool> ScanDependencies("scan-deps",
+                                 cl::desc("Only write the dependency file of each input, as -MD would, finding `include files by scanning directives instead of preprocessing"));
+
+static cl::opt<MacroArgLocationKind> MacroArgLocations("fmacro-arg-locs",
+                                 cl::desc("How tokens substituted for macro arguments are located (default: full)"),
+                                 cl::values(
+                                    clEnumValN(MacroArgLocs_Full, "full", "Report the argument and the macro it was passed to"),
+                                    clEnumValN(MacroArgLocs_Ranges, "ranges", "One location entry per argument; uses more source location space when arguments contain long comments"),
+                                    clEnumValN(MacroArgLocs_Collapsed, "collapsed", "Report where the argument was written only"),
+                                    clEnumValEnd),
+                                 cl::init(MacroArgLocs_Full));
+
+static cl::list<std::string> Defines("D", cl::Prefix, cl::ZeroOrMore,
+                                 cl::desc("Define <macro> as 1, or as <value> with <macro>=<value>; +define+<macro>[=<value>][+...] is accepted too"),
+                                 cl::value_desc("macro"));
+
+static cl::list<std::string> Variants("variant", cl::ZeroOrMore,
+                                 cl::desc("Process every input once for each variant, with the +-separated macros of <defines> defined on top of -D.  Variants run as parallel jobs, or one after another with -E.  They share file contents and `include lookups, and each file is lexed once into an in-memory token cache that the other variants replay"),
+                                 cl::value_desc("defines"));
+
+namespace {
+/// ParseJob - The state of a single input file, or of one chunk of a large
+/// input.  Everything a job prints is captured here so that the output of
+/// parallel jobs can be replayed in command-line and source order.
+struct ParseJob {
+   std::string File;
+   std::string Variant;       // Macros of the -variant, or empty.
+   unsigned BeginOffset;      // First byte of the chunk.
+   unsigned EndOffset;        // Start of the next chunk, or ~0U.
+   std::string Preamble;      // Directives replayed before the chunk.
+   std::string Diagnostics;   // Rendered diagnostics, goes to stderr.
+   std::string Output;        // Driver output, goes to stdout.
+   std::string TraceEvents;   // Time trace events, for -ftime-trace.
+   std::string Stats;         // Statistics, in the -print-stats format.
+   raw_ostream *Preprocessed; // Where -E writes, directly and in order.
+   unsigned Tid;              // Time trace track.
+   bool HadError;
+   bool Done;
+
+   explicit ParseJob(const std::string &F, const std::string &V,
+                     unsigned Begin = 0, unsigned End = ~0U)
+      : File(F), Variant(V), BeginOffset(Begin), EndOffset(End),
+        Preprocessed(0), Tid(0), HadError(false), Done(false) {}
+};
+
+/// JobTimeTrace - Profiles a job if -ftime-trace is given, and renders its
+/// events into the job on every path the job returns on.
+class JobTimeTrace {
+   ParseJob &Job;
+   OwningPtr<TimeTraceProfiler> Profiler;
+
+public:
+   explicit JobTimeTrace(ParseJob &J) : Job(J) {
+      if (TimeTraceFile.empty())
+         return;
+      Profiler.reset(new TimeTraceProfiler(TimeTraceGranularity));
+      Profiler->begin("ParseFile", Job.File);
+   }
+
+   ~JobTimeTrace() {
+      if (!Profiler)
+         return;
+      Profiler->endAll();
+      raw_string_ostream OS(Job.TraceEvents);
+      Profiler->writeEvents(OS, Job.Tid);
+   }
+
+   TimeTraceProfiler *get() const { return Profiler.get(); }
+};
+}
+
+/// StatsFormat - What -print-stats asks for.
+enum StatsFormat { NoStats, TextStats, JSONStats };
+
+static StatsFormat getStatsFormat() {
+   if (!PrintStats.getNumOccurrences())
+      return NoStats;
+   return PrintStats == "json" ? JSONStats : TextStats;
+}
+
+/// getVariantDefines - The macros of a -variant, or of a +define+ argument
+/// with its leading "+define+".
+static void getVariantDefines(StringRef Variant,
+                              SmallVectorImpl<StringRef> &Macros) {
+   StringRef Prefix("+define+");
+   if (Variant.startswith(Prefix))
+      Variant = Variant.substr(Prefix.size());
+   Variant.split(Macros, "+", -1, false);
+}
+
+/// AddCommandLineMacros - Define the -D macros, then those of \p Variant.
+static void AddCommandLineMacros(PreprocessorOptions &PPopts,
+                                 StringRef Variant) {
+   for (auto &D : Defines)
+      PPopts.addMacroDef(D);
+   SmallVector<StringRef, 8> Macros;
+   getVariantDefines(Variant, Macros);
+   for (StringRef M : Macros)
+      PPopts.addMacroDef(M);
+}
+
+/// getJobName - The input of \p Job, with its variant and chunk if any.
+static std::string getJobName(const ParseJob &Job) {
+   std::string Name = Job.File;
+   if (Variants.getNumOccurrences())
+      Name += " [" + Job.Variant + "]";
+   if (Job.BeginOffset || Job.EndOffset != ~0U)
+      Name += " (from byte " + std::to_string(Job.BeginOffset) + ")";
+   return Name;
+}
+
+/// getDependencyOutputOptions - The dependency file options for \p Input,
+/// which default to the rule "dir/top.o: ..." in "dir/top.d" for the input
+/// "dir/top.v", so that inputs with the same name in different directories
+/// do not share a dependency file.
+static DependencyOutputOptions getDependencyOutputOptions(StringRef Input) {
+   DependencyOutputOptions Opts;
+   SmallString<128> Path(Input);
+   sys::path::replace_extension(Path, "d");
+   Opts.OutputFile = DependencyOutputFile.empty() ? Path.str().str()
+                                                  : DependencyOutputFile;
+   Opts.Targets.assign(DependencyTargets.begin(), DependencyTargets.end());
+   if (Opts.Targets.empty()) {
+      sys::path::replace_extension(Path, "o");
+      Opts.Targets.push_back(Path.str());
+   }
+   Opts.UsePhonyTargets = DependencyPhonyTargets;
+   Opts.AddMissingHeaderDeps = DependencyMissingHeaders;
+   return Opts;
+}
+
+static const char *getDesignTypeName(DesignType Type) {
+   switch (Type) {
+   case DesignType::Interface: return "interface";
+   case DesignType::Program:   return "program";
+   default:                    return "module";
+   }
+}
+
+static const char *getPortKindName(PortKind Kind) {
+   switch (Kind) {
+   case PortKind::Input:  return "input ";
+   case PortKind::Output: return "output ";
+   case PortKind::Inout:  return "inout ";
+   case PortKind::Ref:    return "ref ";
+   default:               return "";
+   }
+}
+
+/// PrintDesignUnits - Print one line per design unit: where it is declared,
+/// followed by its header in Verilog syntax.
+static void PrintDesignUnits(ArrayRef<DesignUnitSummary> Units,
+                             SourceManager &SM, raw_ostream &OS) {
+   for (auto &Unit : Units) {
+      PresumedLoc PLoc = SM.getPresumedLoc(Unit.Loc);
+      if (PLoc.isValid())
+         OS << PLoc.getFilename() << ":" << PLoc.getLine() << ": ";
+      OS << getDesignTypeName(Unit.Kind) << " " << Unit.Name;
+      if (!Unit.Parameters.empty()) {
+         OS << " #(";
+         for (unsigned I = 0, E = Unit.Parameters.size(); I != E; ++I)
+            OS << (I ? ", " : "") << Unit.Parameters[I];
+         OS << ")";
+      }
+      OS << " (";
+      for (unsigned I = 0, E = Unit.Ports.size(); I != E; ++I)
+         OS << (I ? ", " : "") << getPortKindName(Unit.Ports[I].Direction)
+            << Unit.Ports[I].Name;
+      OS << ");\n";
+   }
+}
+
+namespace {
+/// UnitStatsPrinter - Prints one line per design unit as soon as the unit
+/// is parsed, after which Sema releases it, followed by the default values
+/// of its parameters.
+class UnitStatsPrinter : public DesignUnitConsumer {
+   SourceManager &SM;
+   ConstantEvaluator &Eval;
+   raw_ostream &OS;
+
+public:
+   UnitStatsPrinter(SourceManager &SM, ConstantEvaluator &Eval, raw_ostream &OS)
+      : SM(SM), Eval(Eval), OS(OS) {}
+
+   virtual void HandleDesignUnit(const DesignUnit &Unit) {
+      unsigned NumDirect = 0;
+      for (auto &Conn : Unit.PortConnections)
+         if (Conn.getKind() != PortConnection::Expression)
+            ++NumDirect;
+
+      PresumedLoc PLoc = SM.getPresumedLoc(Unit.Loc);
+      if (PLoc.isValid())
+         OS << PLoc.getFilename() << ":" << PLoc.getLine() << ": ";
+      switch (Unit.Keyword) {
+      case tok::kw_interface: OS << "interface "; break;
+      case tok::kw_program:   OS << "program ";   break;
+      default:                OS << "module ";    break;
+      }
+      OS << (Unit.Name ? Unit.Name->getName() : StringRef("<unnamed>"))
+         << ": " << Unit.Instances.size() << " instances, "
+         << Unit.PortConnections.size() << " port connections ("
+         << NumDirect << " without expressions)\n";
+
+      for (auto &Param : Unit.Parameters) {
+         OS << (Param.isLocal() ? "  localparam " : "  parameter ")
+            << Param.Name->getName() << " = ";
+         Eval.evaluateParameter(Param.Name).print(OS);
+         OS << "\n";
+      }
+   }
+};
+}
+
+/// ParseInputFile - Preprocess and parse a single file.  Each job owns its
+/// whole pipeline except for the FileManager, which is shared by all jobs so
+/// that common `include files are only looked up and read once per run.
+static void ParseInputFile(ParseJob &Job, FileManager &FileMgr,
+                           PTHManager *PTH) {
+   JobTimeTrace Trace(Job);
+   raw_string_ostream DiagOS(Job.Diagnostics);
+   raw_string_ostream OutOS(Job.Output);
+
+   IntrusiveRefCntPtr<DiagnosticIDs> DiagID(new DiagnosticIDs());
+   LangOptions LangOpts;
+   HeaderSearchOptions HeadSearch;
+   TextDiagnosticPrinter *DiagPrinter = new TextDiagnosticPrinter(DiagOS, new DiagnosticOptions());
+   DiagnosticsEngine Diags(DiagID, new DiagnosticOptions, DiagPrinter);
+   SourceManager SourceMgr(Diags,FileMgr);
+   IntrusiveRefCntPtr<TargetOptions> TargetOpts(new TargetOptions);
+   IntrusiveRefCntPtr<TargetInfo> Target;
+
+   const FileEntry *MainFile = FileMgr.getFile(Job.File);
+   if (!MainFile) {
+      DiagOS << "error: no such file or directory: '" << Job.File << "'\n";
+      Job.HadError = true;
+      return;
+   }
+   SourceMgr.createMainFileID(MainFile);
+
+   // Add search paths for `include
+   for( auto header : HeaderSearchPaths){
+      HeadSearch.AddPath(header.c_str(), frontend::Quoted, true);
+   }
+
+   HeaderSearch HeaderInfo(&HeadSearch, FileMgr, Diags, LangOpts);
+
+   PreprocessorOptions PPopts;
+   PPopts.MacroArgLocations = MacroArgLocations;
+   AddCommandLineMacros(PPopts, Job.Variant);
+
+   if (ScanDependencies) {
+      ApplyHeaderSearchOptions(HeaderInfo, HeadSearch, LangOpts);
+      DiagPrinter->BeginSourceFile(LangOpts, 0);
+      ScanDependencyFile(HeaderInfo, MainFile, PPopts,
+                         getDependencyOutputOptions(Job.File), Diags);
+      DiagPrinter->EndSourceFile();
+      Job.HadError = Diags.hasErrorOccurred();
+      return;
+   }
+
+   Preprocessor PP(&PPopts, Diags, LangOpts, SourceMgr, HeaderInfo,0, false, false);
+   PP.setTimeTraceProfiler(Trace.get());
+   PP.setCountSkippedLines(getStatsFormat() != NoStats);
+
+   InitializePreprocessor(PP, PPopts, HeadSearch);
+   PP.setPTHManager(PTH);
+   if (Job.BeginOffset) {
+      PP.setSkipMainFilePreamble(Job.BeginOffset, true);
+      // The skipped part of the file can still set a `timescale the chunk's
+      // design units inherit; it runs ahead of the chunk with the -D macros.
+      PP.setPredefines(PP.getPredefines() + Job.Preamble);
+   }
+
+   if (!EmitTokenCache.empty()) {
+      std::string ErrorInfo;
+      raw_fd_ostream CacheOS(EmitTokenCache.c_str(), ErrorInfo, raw_fd_ostream::F_Binary);
+      if (!ErrorInfo.empty()) {
+         DiagOS << "error: unable to open token cache '" << EmitTokenCache
+                << "': " << ErrorInfo << "\n";
+         Job.HadError = true;
+         return;
+      }
+      DiagPrinter->BeginSourceFile(LangOpts, &PP);
+      CacheTokens(PP, &CacheOS);
+      DiagPrinter->EndSourceFile();
+      Job.HadError = Diags.hasErrorOccurred();
+      return;
+   }
+
+   // Every `include of a chunked input is in its last chunk, which writes
+   // the dependency file for the whole input.
+   if ((DependencyFile || !DependencyOutputFile.empty()) &&
+       Job.EndOffset == ~0U)
+      AttachDependencyFileGen(PP, getDependencyOutputOptions(Job.File));
+
+   if (PreprocessOnly) {
+      PreprocessorOutputOptions PPOutOpts;
+      PPOutOpts.ShowCPP = 1;
+      PPOutOpts.ShowLineMarkers = !NoLineMarkers;
+      DiagPrinter->BeginSourceFile(LangOpts, &PP);
+      if (Variants.getNumOccurrences() && !Job.BeginOffset)
+         *Job.Preprocessed << "// variant: " << Job.Variant << "\n";
+      DoPrintPreprocessedInput(PP, Job.Preprocessed, PPOutOpts);
+      PP.EndSourceFile();
+      DiagPrinter->EndSourceFile();
+      Job.HadError = Diags.hasErrorOccurred();
+      return;
+   }
+
+   DiagPrinter->BeginSourceFile(LangOpts, &PP);
+   PP.EnterMainSourceFile();
+   Sema Actions(PP, TU_Complete, nullptr);
+   UnitStatsPrinter UnitPrinter(SourceMgr, Actions.getConstantEvaluator(), OutOS);
+   if (StreamUnits)
+      Actions.setDesignUnitConsumer(&UnitPrinter);
+   Parser P(PP, Actions, SkipBodies);
+   P.Initialize();
+   while(!P.ParseTopLevelDecl()){
+      // A chunk ends where the next one starts.  Chunks are only split in
+      // macro-free regions, so the boundary token is in the main file.
+      SourceLocation Loc = P.getCurToken().getLocation();
+      if (Job.EndOffset != ~0U && Loc.isFileID() &&
+          SourceMgr.isFromMainFile(Loc) &&
+          SourceMgr.getFileOffset(Loc) >= Job.EndOffset)
+         break;
+   }
+   PP.EndSourceFile();
+   DiagPrinter->EndSourceFile();
+
+   if (SkipBodies)
+      PrintDesignUnits(P.getDesignUnits(), SourceMgr, OutOS);
+
+   if (getStatsFormat() == JSONStats) {
+      StatisticsReport Report;
+      PP.ReportStats(Report);
+      HeaderInfo.ReportStats(Report);
+      Actions.ReportStats(Report);
+      SourceManager::MemoryBufferSizes Buffers = SourceMgr.getMemoryBufferSizes();
+      Report.add("source_manager", "content_cache_bytes",
+                 SourceMgr.getContentCacheSize());
+      Report.add("source_manager", "buffer_malloc_bytes", Buffers.malloc_bytes);
+      Report.add("source_manager", "buffer_mmap_bytes", Buffers.mmap_bytes);
+      Report.add("source_manager", "data_structure_bytes",
+                 SourceMgr.getDataStructureSizes());
+      Report.add("diagnostics", "warnings", DiagPrinter->getNumWarnings());
+      Report.add("diagnostics", "errors", DiagPrinter->getNumErrors());
+
+      raw_string_ostream StatsOS(Job.Stats);
+      Report.printJSON(StatsOS, 6);
+   } else if (getStatsFormat() == TextStats) {
+      raw_string_ostream StatsOS(Job.Stats);
+      StatsOS << "\n*** Statistics for '" << getJobName(Job) << "':\n";
+      StatsOS << "Character scanning: " << charscan::getImplementationName() << "\n";
+      PP.PrintStats(StatsOS);
+      HeaderInfo.PrintStats(StatsOS);
+      Actions.PrintStats(StatsOS);
+   }
+
+   if (Job.EndOffset == ~0U) {
+      OutOS << "\nFINISHED parsing";
+      if (Variants.getNumOccurrences())
+         OutOS << " variant '" << Job.Variant << "'";
+      OutOS << "\n";
+   }
+   Job.HadError = Diags.hasErrorOccurred();
+}
+
 int main( int argc, char *argv[] )
 {
-	cl::ParseCommandLineOptions(argc, argv, " Vlang Parser\n");
+   // Verilog tools take +define+<macro>[=<value>][+...]; hand each macro to
+   // the option parser as a -D.
+   std::vector<std::string> ArgStrings;
+   for (int I = 0; I != argc; ++I) {
+      SmallVector<StringRef, 8> Macros;
+      if (I && StringRef(argv[I]).startswith("+define+"))
+         getVariantDefines(argv[I], Macros);
+      else
+         ArgStrings.push_back(argv[I]);
+      for (StringRef M : Macros)
+         ArgStrings.push_back("-D" + M.str());
+   }
+   std::vector<const char *> Args;
+   for (auto &A : ArgStrings)
+      Args.push_back(A.c_str());
+	cl::ParseCommandLineOptions(Args.size(), Args.data(), " Vlang Parser\n");
 
 	if( InputFilenames.size() == 0 ){
 		printf("ERROR: Expected at least on input\n");
 		exit(1);
 	}
+   if (PrintStats.getNumOccurrences() && !PrintStats.empty() &&
+       PrintStats != "json") {
+      errs() << "error: unknown statistics format '" << PrintStats << "'\n";
+      return 1;
+   }
+   if (!EmitTokenCache.empty() && InputFilenames.size() != 1) {
+      errs() << "error: -emit-token-cache expects exactly one input\n";
+      return 1;
+   }
+   if (ScanDependencies && (PreprocessOnly || !EmitTokenCache.empty())) {
+      errs() << "error: -scan-deps cannot be combined with -E or -emit-token-cache\n";
+      return 1;
+   }
+   if (!OutputFilename.empty() && !PreprocessOnly) {
+      errs() << "error: -o is only supported with -E\n";
+      return 1;
+   }
+   if (!DependencyOutputFile.empty() && InputFilenames.size() != 1) {
+      errs() << "error: -MF expects exactly one input\n";
+      return 1;
+   }
+   if (DependencyTargets.getNumOccurrences() && InputFilenames.size() != 1) {
+      errs() << "error: -MT expects exactly one input\n";
+      return 1;
+   }
+   if (Variants.size() > 1 &&
+       (!EmitTokenCache.empty() || ScanDependencies || DependencyFile ||
+        !DependencyOutputFile.empty())) {
+      errs() << "error: -emit-token-cache, -scan-deps, -MD and -MF take at most one -variant\n";
+      return 1;
+   }
 
+   FileSystemOptions FileMgrOpts;
+   FileManager       FileMgr(FileMgrOpts);
+   FileMgr.setShareFileBuffers();
 
-   std::string errString;
-   for (auto file : InputFilenames) {
-      FileSystemOptions FileMgrOpts;
-      FileManager       FileMgr(FileMgrOpts);
+   PersistentStatCache *StatCache = 0;
+   if (!StatCacheFile.empty()) {
+      StatCache = new PersistentStatCache();
+      StatCache->load(StatCacheFile);
+      FileMgr.addStatCache(StatCache);
+   }
 
+   // The token cache is read-only once mapped, so all jobs share it.
+   OwningPtr<PTHManager> PTH;
+   if (!IncludeTokenCache.empty()) {
       IntrusiveRefCntPtr<DiagnosticIDs> DiagID(new DiagnosticIDs());
-      LangOptions LangOpts;
-      HeaderSearchOptions HeadSearch;
-      TextDiagnosticPrinter *DiagPrinter = new TextDiagnosticPrinter(llvm::errs(), new DiagnosticOptions());
-      DiagnosticsEngine Diags(DiagID, new DiagnosticOptions, DiagPrinter);
-      SourceManager SourceMgr(Diags,FileMgr);
-      IntrusiveRefCntPtr<TargetOptions> TargetOpts(new TargetOptions);
-      IntrusiveRefCntPtr<TargetInfo> Target;
-
-      auto buf = FileMgr.getBufferForFile(file.c_str(), &errString);
-      SourceMgr.createMainFileIDForMemBuffer(buf);
-      
-      // Add search paths for `include
-      for( auto header : HeaderSearchPaths){
-         HeadSearch.AddPath(header.c_str(), frontend::Quoted, true);
+      DiagnosticsEngine Diags(DiagID, new DiagnosticOptions,
+                              new TextDiagnosticPrinter(errs(), new DiagnosticOptions()));
+      PTH.reset(PTHManager::Create(IncludeTokenCache, Diags));
+      if (!PTH)
+         return 1;
+   }
+
+   // Every file is preprocessed once per variant, so the first job to enter
+   // a file lexes it into memory and the others replay its tokens.
+   if (Variants.size() > 1) {
+      if (PTH)
+         PTH->setLexFiles(LangOptions());
+      else
+         PTH.reset(PTHManager::CreateInMemory(LangOptions()));
+   }
+
+   // -E output can be gigabytes, so rather than buffering it per job, the
+   // inputs are preprocessed one after another straight into the output.
+   OwningPtr<raw_fd_ostream> PreprocessedFile;
+   raw_ostream *PreprocessedOS = &outs();
+   if (PreprocessOnly && !OutputFilename.empty()) {
+      std::string ErrorInfo;
+      PreprocessedFile.reset(new raw_fd_ostream(OutputFilename.c_str(), ErrorInfo));
+      if (!ErrorInfo.empty()) {
+         errs() << "error: unable to open output file '" << OutputFilename
+                << "': " << ErrorInfo << "\n";
+         return 1;
       }
+      PreprocessedOS = PreprocessedFile.get();
+   }
 
-      HeaderSearch HeaderInfo(&HeadSearch, FileMgr, Diags, LangOpts);
-      PreprocessorOptions PPopts;
-      Preprocessor PP(&PPopts, Diags, LangOpts, SourceMgr, HeaderInfo,0, false, false);
+   unsigned NumWorkers = NumJobs;
+   if (NumWorkers == 0)
+      NumWorkers = std::max(1u, std::thread::hardware_concurrency());
+   if (PreprocessOnly)
+      NumWorkers = 1;
 
-      InitializePreprocessor(PP, PPopts, HeadSearch);
+   // Each input is processed once per variant.  The variants of an input
+   // share its buffer, its `include lookups and its tokens through the
+   // FileManager and PTHManager, so only the preprocessing and parsing are
+   // repeated.  They run in parallel, except under -E.
+   std::vector<std::string> JobVariants(Variants.begin(), Variants.end());
+   if (JobVariants.empty())
+      JobVariants.push_back(std::string());
 
-      DiagPrinter->BeginSourceFile(LangOpts, &PP);
-      PP.EnterMainSourceFile();
-      Parser P(PP, Sema(PP, TU_Complete, nullptr),false);
-      P.Initialize();
-      while(!P.ParseTopLevelDecl()){}
-      printf("\nFINISHED parsing\n");
+   // With more than one worker, large inputs are split at top-level design
+   // unit boundaries so that even a single huge netlist is parsed in
+   // parallel.
+   std::vector<ParseJob> Jobs;
+   Jobs.reserve(InputFilenames.size() * JobVariants.size());
+   for (auto file : InputFilenames) {
+      const FileEntry *FE = 0;
+      const MemoryBuffer *Buf = 0;
+      SmallVector<DesignUnitBoundary, 64> Boundaries;
+      if (NumWorkers > 1 && SplitSize && EmitTokenCache.empty() && !ScanDependencies &&
+          (FE = FileMgr.getFile(file)) && FE->getSize() >= 2 * (off_t)SplitSize &&
+          (Buf = FileMgr.getSharedBufferForFile(FE)))
+         FindDesignUnitBoundaries(Buf, LangOptions(), SplitSize, Boundaries);
+
+      for (auto &V : JobVariants) {
+         unsigned Begin = 0;
+         std::string Preamble;
+         for (auto &B : Boundaries) {
+            Jobs.push_back(ParseJob(file, V, Begin, B.Offset));
+            Jobs.back().Preamble = Preamble;
+            Begin = B.Offset;
+            Preamble = B.Preamble;
+         }
+         Jobs.push_back(ParseJob(file, V, Begin));
+         Jobs.back().Preamble = Preamble;
+      }
+   }
+   for (unsigned I = 0, E = Jobs.size(); I != E; ++I) {
+      Jobs[I].Tid = I + 1;
+      if (PreprocessOnly)
+         Jobs[I].Preprocessed = PreprocessedOS;
+   }
+
+   if (NumWorkers > Jobs.size())
+      NumWorkers = Jobs.size();
+
+   // Workers pull the next unclaimed file; the main thread prints finished
+   // jobs strictly in command-line order so output is deterministic
+   // regardless of which file finishes first.
+   std::atomic<unsigned> NextJob(0);
+   std::mutex DoneLock;
+   std::condition_variable DoneCond;
+
+   auto Worker = [&]() {
+      for (unsigned I = NextJob++; I < Jobs.size(); I = NextJob++) {
+         ParseInputFile(Jobs[I], FileMgr, PTH.get());
+         std::lock_guard<std::mutex> Guard(DoneLock);
+         Jobs[I].Done = true;
+         DoneCond.notify_all();
+      }
+   };
+
+   std::vector<std::thread> Workers;
+   if (NumWorkers > 1)
+      for (unsigned I = 0; I != NumWorkers; ++I)
+         Workers.push_back(std::thread(Worker));
+
+   bool HadError = false;
+   for (auto &Job : Jobs) {
+      if (NumWorkers > 1) {
+         std::unique_lock<std::mutex> Guard(DoneLock);
+         DoneCond.wait(Guard, [&Job]() { return Job.Done; });
+      } else {
+         ParseInputFile(Job, FileMgr, PTH.get());
+      }
+      if (Variants.getNumOccurrences() && !Job.Diagnostics.empty())
+         errs() << "In variant '" << Job.Variant << "' of '" << Job.File << "':\n";
+      errs() << Job.Diagnostics;
+      // JSON statistics are printed as one document after all jobs.
+      if (getStatsFormat() == TextStats) {
+         errs() << Job.Stats;
+         std::string().swap(Job.Stats);
+      }
+      errs().flush();
+      outs() << Job.Output;
+      outs().flush();
+      HadError |= Job.HadError;
+
+      // Release the buffered text as soon as it has been printed.
+      std::string().swap(Job.Diagnostics);
+      std::string().swap(Job.Output);
+   }
+
+   for (auto &W : Workers)
+      W.join();
+
+   if (getStatsFormat() == JSONStats) {
+      // One document for the whole run, after all diagnostics, so scripts
+      // can parse it from the end of stderr.
+      raw_ostream &OS = errs();
+      OS << "{\n  \"character_scanning\": \""
+         << charscan::getImplementationName() << "\",\n  \"inputs\": [";
+      for (unsigned I = 0, E = Jobs.size(); I != E; ++I) {
+         const ParseJob &Job = Jobs[I];
+         OS << (I ? ",\n" : "\n") << "    {\n      \"file\": ";
+         writeJSONString(OS, Job.File);
+         if (Variants.getNumOccurrences()) {
+            OS << ",\n      \"variant\": ";
+            writeJSONString(OS, Job.Variant);
+         }
+         if (Job.BeginOffset || Job.EndOffset != ~0U)
+            OS << ",\n      \"begin_offset\": " << Job.BeginOffset;
+         if (!Job.Stats.empty())
+            OS << ",\n      \"stats\": " << Job.Stats;
+         OS << "\n    }";
+      }
+      OS << "\n  ]\n}\n";
+      OS.flush();
+   }
+
+   if (!TimeTraceFile.empty()) {
+      std::string ErrorInfo;
+      raw_fd_ostream TraceOS(TimeTraceFile.c_str(), ErrorInfo);
+      if (!ErrorInfo.empty()) {
+         errs() << "error: unable to open time trace '" << TimeTraceFile
+                << "': " << ErrorInfo << "\n";
+         HadError = true;
+      } else {
+         // Every job gets its own track, named after its input.
+         TraceOS << "{\"traceEvents\":[\n{\"pid\":1,\"tid\":0,\"ph\":\"M\","
+                    "\"name\":\"process_name\",\"args\":{\"name\":\"vlang\"}}";
+         for (auto &Job : Jobs) {
+            std::string Name = getJobName(Job);
+            TraceOS << ",\n{\"pid\":1,\"tid\":" << Job.Tid
+                    << ",\"ph\":\"M\",\"name\":\"thread_name\",\"args\":{\"name\":";
+            writeJSONString(TraceOS, Name);
+            TraceOS << "}}" << Job.TraceEvents;
+         }
+         TraceOS << "\n]}\n";
+      }
+   }
+
+   if (StatCache) {
+      std::string Error;
+      if (StatCache->save(StatCacheFile, Error))
+         errs() << "warning: unable to write stat cache '" << StatCacheFile
+                << "': " << Error << "\n";
    }
 
-    return 0;
+    return HadError ? 1 : 0;
 }
 
 
@@ -25,7 +25,8 @@ using namespace vlang;
 enum ActionType {
   GenVlangDiagsDefs,
   GenVlangDiagGroups,
-  GenVlangDiagsIndexName
+  GenVlangDiagsIndexName,
+  GenVlangKeywordHash
 };
 
 namespace {
@@ -38,6 +39,8 @@ namespace {
                     clEnumValN(GenVlangDiagsIndexName,
                                "gen-vlang-diags-index-name",
                                "Generate Vlang diagnostic name index"),
+                    clEnumValN(GenVlangKeywordHash, "gen-vlang-keyword-hash",
+                               "Generate Vlang keyword perfect hash table"),
                     clEnumValEnd));
 
   cl::opt<std::string>
@@ -56,6 +59,9 @@ bool VlangTableGenMain(raw_ostream &OS, RecordKeeper &Records) {
   case GenVlangDiagsIndexName:
     EmitVlangDiagsIndexName(Records, OS);
     break;
+  case GenVlangKeywordHash:
+    EmitVlangKeywordHash(Records, OS);
+    break;
   }
 
   return false;
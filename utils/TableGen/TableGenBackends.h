@@ -30,6 +30,8 @@ void EmitVlangDiagsDefs(RecordKeeper &Records, raw_ostream &OS,
 void EmitVlangDiagGroups(RecordKeeper &Records, raw_ostream &OS);
 void EmitVlangDiagsIndexName(RecordKeeper &Records, raw_ostream &OS);
 
+void EmitVlangKeywordHash(RecordKeeper &Records, raw_ostream &OS);
+
 void EmitOptParser(RecordKeeper &Records, raw_ostream &OS, bool GenDefs);
 
 } // end namespace vlang
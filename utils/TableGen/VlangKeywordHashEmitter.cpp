@@ -0,0 +1,171 @@
+//===- VlangKeywordHashEmitter.cpp - Generate the keyword hash table ------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This tablegen backend emits a minimal perfect hash over the keywords and
+// directive names of TokenKinds.def, together with the language version
+// flags defined in Keywords.td.
+//
+// The table is built by hash and displace: keywords are grouped into buckets
+// by their first level hash, and, largest bucket first, each bucket gets the
+// smallest displacement that sends all of its keywords to free slots.  The
+// table has one slot per keyword, so it ends up full.
+//
+//===----------------------------------------------------------------------===//
+
+#include "vlang/Basic/KeywordTable.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/Support/Format.h"
+#include "llvm/TableGen/Error.h"
+#include "llvm/TableGen/Record.h"
+#include "llvm/TableGen/TableGenBackend.h"
+#include <algorithm>
+#include <cstring>
+#include <vector>
+using namespace llvm;
+using namespace vlang;
+
+namespace {
+/// KeywordDesc - One KEYWORD, ALIAS or PPKEYWORD entry of TokenKinds.def.
+struct KeywordDesc {
+  const char *Spelling;
+  const char *Kind;
+  const char *Flags;
+};
+
+/// Bucket - The keywords sharing one first level hash bucket.
+struct Bucket {
+  unsigned Index;
+  std::vector<unsigned> Keywords;
+
+  bool operator<(const Bucket &RHS) const {
+    if (Keywords.size() != RHS.Keywords.size())
+      return Keywords.size() > RHS.Keywords.size();
+    return Index < RHS.Index;
+  }
+};
+} // end anonymous namespace
+
+// The same entries IdentifierTable::AddKeywords walks.
+static const KeywordDesc Keywords[] = {
+#define KEYWORD(NAME, FLAGS) { #NAME, "kw_" #NAME, #FLAGS },
+#define ALIAS(NAME, TOK, FLAGS) { NAME, "kw_" #TOK, #FLAGS },
+#define PPKEYWORD(NAME, FLAGS) { "`" #NAME, "pp_" #NAME, #FLAGS },
+#define TESTING_KEYWORD(NAME, FLAGS)
+#include "vlang/Basic/TokenKinds.def"
+};
+
+static const unsigned NumKeywords = sizeof(Keywords) / sizeof(Keywords[0]);
+
+/// placeBucket - Try to place every keyword of \p B with displacement \p D.
+static bool placeBucket(const Bucket &B, uint32_t D,
+                        const std::vector<uint32_t> &Hashes,
+                        std::vector<int> &Slots) {
+  unsigned TableSize = Slots.size();
+  unsigned Placed = 0;
+  for (; Placed != B.Keywords.size(); ++Placed) {
+    unsigned K = B.Keywords[Placed];
+    unsigned S = keywords::reduce(keywords::hashSlot(Hashes[K], D), TableSize);
+    if (Slots[S] != -1)
+      break;
+    Slots[S] = K;
+  }
+  if (Placed == B.Keywords.size())
+    return true;
+
+  // Undo the partial placement.
+  for (unsigned i = 0; i != Placed; ++i)
+    Slots[keywords::reduce(keywords::hashSlot(Hashes[B.Keywords[i]], D),
+                           TableSize)] = -1;
+  return false;
+}
+
+namespace vlang {
+void EmitVlangKeywordHash(RecordKeeper &Records, raw_ostream &OS) {
+  emitSourceFileHeader("Keyword perfect hash table", OS);
+
+  // Collect the version flags.
+  std::vector<Record*> Flags = Records.getAllDerivedDefinitions("KeywordFlag");
+  StringMap<Record*> FlagsByName;
+  for (unsigned i = 0, e = Flags.size(); i != e; ++i)
+    FlagsByName[Flags[i]->getName()] = Flags[i];
+
+  OS << "#ifdef GET_KEYWORD_FLAGS\n#undef GET_KEYWORD_FLAGS\n";
+  OS << "enum {\n";
+  for (unsigned i = 0, e = Flags.size(); i != e; ++i)
+    OS << "  " << Flags[i]->getName() << " = "
+       << format("0x%x", (unsigned)Flags[i]->getValueAsInt("Mask")) << ",\n";
+  OS << "};\n#endif // GET_KEYWORD_FLAGS\n\n";
+
+  // Check the keywords and hash them.
+  std::vector<uint32_t> Hashes(NumKeywords);
+  StringMap<unsigned> Seen;
+  unsigned MaxLength = 0;
+  for (unsigned i = 0; i != NumKeywords; ++i) {
+    StringRef Spelling = Keywords[i].Spelling;
+    if (!FlagsByName.count(Keywords[i].Flags))
+      PrintFatalError("Keyword '" + Spelling + "' uses unknown flag '" +
+                      Keywords[i].Flags + "'");
+    if (Seen.count(Spelling))
+      PrintFatalError("Keyword '" + Spelling + "' is defined twice");
+    Seen[Spelling] = i;
+    Hashes[i] = keywords::hashName(Spelling);
+    MaxLength = std::max(MaxLength, (unsigned)Spelling.size());
+  }
+
+  // Use about two keywords per bucket; even the last buckets, placed into an
+  // almost full table, then find a displacement within a few hundred tries.
+  unsigned TableSize = NumKeywords;
+  unsigned NumBuckets = std::max(1U, NumKeywords / 2);
+
+  std::vector<Bucket> Buckets(NumBuckets);
+  for (unsigned i = 0; i != NumBuckets; ++i)
+    Buckets[i].Index = i;
+  for (unsigned i = 0; i != NumKeywords; ++i)
+    Buckets[keywords::reduce(Hashes[i], NumBuckets)].Keywords.push_back(i);
+  std::sort(Buckets.begin(), Buckets.end());
+
+  std::vector<int> Slots(TableSize, -1);
+  std::vector<uint32_t> Displacements(NumBuckets, 0);
+  for (unsigned i = 0; i != NumBuckets && !Buckets[i].Keywords.empty(); ++i) {
+    uint32_t D = 0;
+    while (!placeBucket(Buckets[i], D, Hashes, Slots))
+      if (++D > 0xFFFF)
+        PrintFatalError("Unable to build the keyword perfect hash");
+    Displacements[Buckets[i].Index] = D;
+  }
+
+  OS << "#ifdef GET_KEYWORD_TABLE\n#undef GET_KEYWORD_TABLE\n";
+  OS << "static unsigned getLangOptsKeywordMask(const LangOptions &LangOpts) {\n"
+     << "  unsigned Mask = 0;\n";
+  for (unsigned i = 0, e = Flags.size(); i != e; ++i) {
+    std::string LangOpt = Flags[i]->getValueAsString("LangOpt");
+    if (!LangOpt.empty())
+      OS << "  if (LangOpts." << LangOpt << ") Mask |= "
+         << Flags[i]->getName() << ";\n";
+  }
+  OS << "  return Mask;\n}\n\n";
+
+  OS << "static const unsigned KeywordMaxLength = " << MaxLength << ";\n";
+  OS << "static const unsigned KeywordTableSize = " << TableSize << ";\n";
+  OS << "static const unsigned KeywordNumBuckets = " << NumBuckets << ";\n\n";
+
+  OS << "static const uint16_t KeywordDisplacements[KeywordNumBuckets] = {";
+  for (unsigned i = 0; i != NumBuckets; ++i)
+    OS << (i % 12 ? " " : "\n  ") << Displacements[i] << ',';
+  OS << "\n};\n\n";
+
+  OS << "static const KeywordEntry KeywordEntries[KeywordTableSize] = {\n";
+  for (unsigned i = 0; i != TableSize; ++i) {
+    const KeywordDesc &K = Keywords[Slots[i]];
+    OS << "  { \"" << K.Spelling << "\", " << strlen(K.Spelling)
+       << ", tok::" << K.Kind << ", " << K.Flags << " },\n";
+  }
+  OS << "};\n#endif // GET_KEYWORD_TABLE\n";
+}
+} // end namespace vlang
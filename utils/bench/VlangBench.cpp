@@ -0,0 +1,271 @@
+//===--- VlangBench.cpp - Lexer, preprocessor and parser benchmarks -------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// Measures the throughput of each stage of the frontend on its own:
+//
+//   lex    the raw Lexer over the input file alone, as used for scanning
+//   scan   the DependencyScanner, which only looks at directives
+//   pp     Preprocessor::Lex, including `includes and macro expansion
+//   parse  the full Parser and Sema, as the vlang driver runs them
+//
+// Bytes are those of the input for lex, and of every file entered for scan,
+// pp and parse.  Tokens are those the raw lexer returns for lex, the
+// directives scan looks at, those Preprocessor::Lex returns after expansion
+// for pp, and those lexed from all source files for parse.  Each measurement
+// is the best of -iterations runs.
+// File contents are shared between runs, so only the first run of an input
+// reads them from disk.
+//
+// The inputs are usually generated with gen-corpus.py in this directory.
+//
+//===----------------------------------------------------------------------===//
+
+#include "vlang/Basic/FileManager.h"
+#include "vlang/Basic/SourceManager.h"
+#include "vlang/Diag/Diagnostic.h"
+#include "vlang/Diag/DiagnosticOptions.h"
+#include "vlang/Diag/TextDiagnosticPrinter.h"
+#include "vlang/Frontend/Utils.h"
+#include "vlang/Lex/DependencyScanner.h"
+#include "vlang/Lex/HeaderSearch.h"
+#include "vlang/Lex/HeaderSearchOptions.h"
+#include "vlang/Lex/Lexer.h"
+#include "vlang/Lex/Preprocessor.h"
+#include "vlang/Lex/PreprocessorOptions.h"
+#include "vlang/Parse/Parser.h"
+#include "vlang/Sema/Sema.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/PathV2.h"
+#include "llvm/Support/raw_ostream.h"
+#include <algorithm>
+#include <chrono>
+
+using namespace llvm;
+using namespace vlang;
+
+namespace {
+enum BenchMode { LexMode, ScanMode, PreprocessMode, ParseMode };
+}
+
+static cl::list<std::string> InputFilenames(cl::Positional, cl::OneOrMore,
+                                 cl::desc("<input files>"));
+
+static cl::list<std::string> HeaderSearchPaths("I", cl::NormalFormatting, cl::ZeroOrMore,
+                                 cl::desc("Path to Headers"));
+
+static cl::list<BenchMode> Modes("mode", cl::CommaSeparated,
+                                 cl::desc("Stages to measure (default: all)"),
+                                 cl::values(
+                                    clEnumValN(LexMode, "lex", "Raw lexer"),
+                                    clEnumValN(ScanMode, "scan", "Directive-only dependency scanner"),
+                                    clEnumValN(PreprocessMode, "pp", "Preprocessor::Lex"),
+                                    clEnumValN(ParseMode, "parse", "Parser and Sema"),
+                                    clEnumValEnd));
+
+static cl::opt<unsigned> Iterations("iterations",
+                                 cl::desc("Runs of each measurement; the fastest is reported"),
+                                 cl::value_desc("N"), cl::init(3));
+
+static cl::opt<bool> CSV("csv",
+                                 cl::desc("Print comma separated values instead of a table"));
+
+namespace {
+/// BenchResult - One run of one stage over one input.
+struct BenchResult {
+   uint64_t Bytes;
+   uint64_t Tokens;
+   double Seconds;
+   unsigned Errors;
+
+   BenchResult() : Bytes(0), Tokens(0), Seconds(0), Errors(0) {}
+};
+}
+
+typedef std::chrono::steady_clock Clock;
+
+static double getSecondsSince(Clock::time_point Start) {
+   return std::chrono::duration<double>(Clock::now() - Start).count();
+}
+
+/// RunLexer - Raw lex the input file, without a preprocessor.
+static BenchResult RunLexer(const MemoryBuffer *Buf) {
+   BenchResult R;
+   LangOptions LangOpts;
+   Clock::time_point Start = Clock::now();
+   Lexer L(SourceLocation(), LangOpts, Buf->getBufferStart(),
+           Buf->getBufferStart(), Buf->getBufferEnd());
+   Token Tok;
+   do {
+      L.LexFromRawLexer(Tok);
+      ++R.Tokens;
+   } while (Tok.isNot(tok::eof));
+   R.Seconds = getSecondsSince(Start);
+   R.Bytes = Buf->getBufferSize();
+   return R;
+}
+
+/// RunScanner - Find the `include files of the input with the directive-only
+/// scanner.
+static BenchResult RunScanner(const FileEntry *File, FileManager &FileMgr) {
+   BenchResult R;
+   IntrusiveRefCntPtr<DiagnosticIDs> DiagID(new DiagnosticIDs());
+   LangOptions LangOpts;
+   HeaderSearchOptions HeadSearch;
+   TextDiagnosticPrinter *DiagPrinter = new TextDiagnosticPrinter(nulls(), new DiagnosticOptions());
+   DiagnosticsEngine Diags(DiagID, new DiagnosticOptions, DiagPrinter);
+
+   for (unsigned I = 0, E = HeaderSearchPaths.size(); I != E; ++I)
+      HeadSearch.AddPath(HeaderSearchPaths[I].c_str(), frontend::Quoted, true);
+
+   HeaderSearch HeaderInfo(&HeadSearch, FileMgr, Diags, LangOpts);
+   ApplyHeaderSearchOptions(HeaderInfo, HeadSearch, LangOpts);
+   DiagPrinter->BeginSourceFile(LangOpts, 0);
+
+   Clock::time_point Start = Clock::now();
+   DependencyScanner Scanner(HeaderInfo, Diags);
+   Scanner.scan(File);
+   R.Seconds = getSecondsSince(Start);
+
+   DiagPrinter->EndSourceFile();
+   R.Bytes = Scanner.getNumBytesScanned();
+   R.Tokens = Scanner.getNumDirectives();
+   R.Errors = DiagPrinter->getNumErrors();
+   return R;
+}
+
+/// RunFrontend - Preprocess, and for ParseMode parse, the input file with
+/// the same pipeline the vlang driver builds.
+static BenchResult RunFrontend(BenchMode Mode, const FileEntry *File,
+                               FileManager &FileMgr) {
+   BenchResult R;
+   IntrusiveRefCntPtr<DiagnosticIDs> DiagID(new DiagnosticIDs());
+   LangOptions LangOpts;
+   HeaderSearchOptions HeadSearch;
+   TextDiagnosticPrinter *DiagPrinter = new TextDiagnosticPrinter(nulls(), new DiagnosticOptions());
+   DiagnosticsEngine Diags(DiagID, new DiagnosticOptions, DiagPrinter);
+   SourceManager SourceMgr(Diags, FileMgr);
+   SourceMgr.createMainFileID(File);
+
+   for (unsigned I = 0, E = HeaderSearchPaths.size(); I != E; ++I)
+      HeadSearch.AddPath(HeaderSearchPaths[I].c_str(), frontend::Quoted, true);
+
+   HeaderSearch HeaderInfo(&HeadSearch, FileMgr, Diags, LangOpts);
+   PreprocessorOptions PPopts;
+   Preprocessor PP(&PPopts, Diags, LangOpts, SourceMgr, HeaderInfo, 0, false, false);
+   InitializePreprocessor(PP, PPopts, HeadSearch);
+   DiagPrinter->BeginSourceFile(LangOpts, &PP);
+
+   Clock::time_point Start = Clock::now();
+   PP.EnterMainSourceFile();
+   if (Mode == PreprocessMode) {
+      Token Tok;
+      do {
+         PP.Lex(Tok);
+         ++R.Tokens;
+      } while (Tok.isNot(tok::eof));
+   } else {
+      Sema Actions(PP, TU_Complete, 0);
+      Parser P(PP, Actions, false);
+      P.Initialize();
+      while (!P.ParseTopLevelDecl())
+         ;
+      R.Tokens = PP.getNumTokensLexed();
+   }
+   R.Seconds = getSecondsSince(Start);
+
+   DiagPrinter->EndSourceFile();
+   R.Bytes = PP.getNumBytesEntered();
+   R.Errors = DiagPrinter->getNumErrors();
+   return R;
+}
+
+static const char *getModeName(BenchMode Mode) {
+   switch (Mode) {
+   case LexMode:        return "lex";
+   case ScanMode:       return "scan";
+   case PreprocessMode: return "pp";
+   default:             return "parse";
+   }
+}
+
+static void PrintResult(StringRef Input, BenchMode Mode, const BenchResult &R,
+                        raw_ostream &OS) {
+   double MB = R.Bytes / (1024.0 * 1024.0);
+   double MTokens = R.Tokens / 1e6;
+   double Seconds = R.Seconds > 0 ? R.Seconds : 1e-9;
+   if (CSV) {
+      OS << Input << "," << getModeName(Mode) << "," << R.Bytes << ","
+         << R.Tokens << "," << format("%.6f", R.Seconds) << ","
+         << format("%.2f", MB / Seconds) << ","
+         << format("%.2f", MTokens / Seconds) << "," << R.Errors << "\n";
+      return;
+   }
+   OS << format("%-28s %-6s %9.2f %9.3f %10.2f %9.1f %8.2f %7u\n",
+                Input.str().c_str(), getModeName(Mode), MB, MTokens,
+                R.Seconds * 1000, MB / Seconds, MTokens / Seconds, R.Errors);
+}
+
+int main(int argc, char **argv) {
+   cl::ParseCommandLineOptions(argc, argv, " Vlang lexer, preprocessor and parser benchmarks\n");
+
+   SmallVector<BenchMode, 4> Stages(Modes.begin(), Modes.end());
+   if (Stages.empty()) {
+      Stages.push_back(LexMode);
+      Stages.push_back(ScanMode);
+      Stages.push_back(PreprocessMode);
+      Stages.push_back(ParseMode);
+   }
+   unsigned Runs = std::max(1u, (unsigned)Iterations);
+
+   // Share file buffers so that each file, headers included, is read once
+   // and every run after the first finds it in memory.
+   FileSystemOptions FileMgrOpts;
+   FileManager FileMgr(FileMgrOpts);
+   FileMgr.setShareFileBuffers();
+
+   raw_ostream &OS = outs();
+   if (CSV)
+      OS << "input,stage,bytes,tokens,seconds,mb_per_s,mtokens_per_s,errors\n";
+   else
+      OS << format("%-28s %-6s %9s %9s %10s %9s %8s %7s\n", "input", "stage",
+                   "MB", "Mtokens", "best ms", "MB/s", "Mtok/s", "errors");
+
+   int Status = 0;
+   for (unsigned I = 0, E = InputFilenames.size(); I != E; ++I) {
+      const std::string &Input = InputFilenames[I];
+      const FileEntry *File = FileMgr.getFile(Input);
+      const MemoryBuffer *Buf = File ? FileMgr.getSharedBufferForFile(File) : 0;
+      if (!Buf) {
+         errs() << "error: unable to read '" << Input << "'\n";
+         Status = 1;
+         continue;
+      }
+      StringRef Name = sys::path::filename(Input);
+
+      for (unsigned S = 0, SE = Stages.size(); S != SE; ++S) {
+         BenchResult Best;
+         for (unsigned Run = 0; Run != Runs; ++Run) {
+            BenchResult R;
+            if (Stages[S] == LexMode)
+               R = RunLexer(Buf);
+            else if (Stages[S] == ScanMode)
+               R = RunScanner(File, FileMgr);
+            else
+               R = RunFrontend(Stages[S], File, FileMgr);
+            if (Run == 0 || R.Seconds < Best.Seconds)
+               Best = R;
+         }
+         PrintResult(Name, Stages[S], Best, OS);
+      }
+      OS.flush();
+   }
+   return Status;
+}
@@ -0,0 +1,350 @@
+#!/usr/bin/env python
+
+"""
+gen-corpus.py - Generate synthetic inputs for vlang-bench.
+
+Writes one top-level file per corpus kind and size into OUTDIR, the headers
+of the `include tree into OUTDIR/inc, and OUTDIR/corpus.rsp, a response file
+that passes all of them to vlang-bench:
+
+    gen-corpus.py -s 1M,16M build/bench
+    vlang-bench @build/bench/corpus.rsp
+
+The corpora cover the shapes that stress different parts of the frontend:
+
+  netlist     flat gate-level netlists: gates and cell instances whose ports
+              connect to bit selects of buses
+  includes    a deep `include tree with guarded, multiply included headers
+              and the macros they define used throughout the design
+  uvm         UVM-style classes built from multi-line function-like macros
+  wideports   modules with thousands of ANSI ports, and named connections
+  casetables  always blocks with large case tables of based literals
+
+Output is deterministic for a given seed, so runs on different releases
+measure the same inputs.
+"""
+
+import optparse
+import os
+import random
+import sys
+
+KINDS = ['netlist', 'includes', 'uvm', 'wideports', 'casetables']
+
+# Include tree shape: INCLUDE_DEPTH levels, each header including
+# INCLUDE_FANOUT headers of the next level.  Headers are shared between
+# parents, so most `includes hit an include guard.
+INCLUDE_DEPTH = 8
+INCLUDE_FANOUT = 3
+INCLUDE_WIDTH = 24
+
+
+def parse_size(text):
+    """Parse a size such as 512K, 16M or 1G into bytes."""
+    text = text.strip().upper()
+    scale = 1
+    if text[-1:] in ('K', 'M', 'G'):
+        scale = 1 << {'K': 10, 'M': 20, 'G': 30}[text[-1]]
+        text = text[:-1]
+    return int(float(text) * scale)
+
+
+def size_name(size):
+    for suffix, shift in (('G', 30), ('M', 20), ('K', 10)):
+        if size >= 1 << shift and size % (1 << shift) == 0:
+            return '%d%s' % (size >> shift, suffix)
+    return str(size)
+
+
+class Writer(object):
+    """Collects lines and tracks how many bytes have been written."""
+
+    def __init__(self, out):
+        self.out = out
+        self.size = 0
+
+    def line(self, text=''):
+        self.out.write(text)
+        self.out.write('\n')
+        self.size += len(text) + 1
+
+
+def gen_netlist(w, size, rng):
+    cells = [('AND2X1', ['A', 'B'], 'Y'), ('OR2X1', ['A', 'B'], 'Y'),
+             ('NAND3X2', ['A', 'B', 'C'], 'Y'), ('MUX2X1', ['A', 'B', 'S'], 'Y'),
+             ('XOR2X1', ['A', 'B'], 'Y'), ('INVX1', ['A'], 'Y')]
+    for name, inputs, output in cells:
+        w.line('module %s (%s, %s);' % (name, ', '.join(inputs), output))
+        w.line('  input %s;' % ', '.join(inputs))
+        w.line('  output %s;' % output)
+        w.line('endmodule')
+        w.line()
+    w.line('module DFFX1 (D, CK, Q, QN);')
+    w.line('  input D, CK;')
+    w.line('  output Q, QN;')
+    w.line('endmodule')
+    w.line()
+
+    gates = ['and', 'or', 'nand', 'nor', 'xor', 'xnor']
+    unit = 0
+    while w.size < size:
+        buses = 64
+        w.line('module netlist_%d (clk, rst_n, din, dout);' % unit)
+        w.line('  input clk, rst_n;')
+        w.line('  input [255:0] din;')
+        w.line('  output [255:0] dout;')
+        for b in range(buses):
+            w.line('  wire [255:0] n%d;' % b)
+        inst = 0
+        while inst < 20000 and w.size < size:
+            bus = rng.randrange(buses)
+            kind = rng.randrange(10)
+            if kind < 3:
+                w.line('  %s g%d (n%d[%d], n%d[%d], n%d[%d]);' % (
+                    rng.choice(gates), inst, bus, rng.randrange(256),
+                    rng.randrange(buses), rng.randrange(256),
+                    rng.randrange(buses), rng.randrange(256)))
+            elif kind < 5:
+                w.line('  DFFX1 r%d (.D(n%d[%d]), .CK(clk), .Q(n%d[%d]), .QN());'
+                       % (inst, bus, rng.randrange(256), rng.randrange(buses),
+                          rng.randrange(256)))
+            else:
+                name, inputs, output = rng.choice(cells)
+                conns = ['.%s(n%d[%d])' % (pin, rng.randrange(buses),
+                                          rng.randrange(256))
+                         for pin in inputs]
+                conns.append('.%s(n%d[%d])' % (output, bus, rng.randrange(256)))
+                w.line('  %s U%d (%s);' % (name, inst, ', '.join(conns)))
+            inst += 1
+        w.line('  assign dout = n0;')
+        w.line('endmodule')
+        w.line()
+        unit += 1
+
+
+def header_name(level, index):
+    return 'lvl%d_%d.vh' % (level, index)
+
+
+def gen_include_headers(incdir):
+    """Write the headers of the include tree once; they do not depend on the
+    corpus size."""
+    if not os.path.isdir(incdir):
+        os.makedirs(incdir)
+    for level in range(INCLUDE_DEPTH):
+        for index in range(INCLUDE_WIDTH):
+            guard = 'LVL%d_%d_VH' % (level, index)
+            path = os.path.join(incdir, header_name(level, index))
+            f = open(path, 'w')
+            f.write('`ifndef %s\n`define %s\n\n' % (guard, guard))
+            f.write('`include "common.vh"\n')
+            if level + 1 < INCLUDE_DEPTH:
+                for k in range(INCLUDE_FANOUT):
+                    child = (index * INCLUDE_FANOUT + k) % INCLUDE_WIDTH
+                    f.write('`include "%s"\n' % header_name(level + 1, child))
+            f.write('\n')
+            for m in range(16):
+                f.write('`define L%d_%d_W%d %d\n' % (level, index, m, m + 1))
+            f.write('`define L%d_%d_ADD(a, b) ((a) + (b) + `L%d_%d_W0)\n'
+                    % (level, index, level, index))
+            f.write('`define L%d_%d_SEL(v, i) v[(i) * `COMMON_BYTE +: '
+                    '`COMMON_BYTE]\n' % (level, index))
+            f.write('\n`endif // %s\n' % guard)
+            f.close()
+
+    f = open(os.path.join(incdir, 'common.vh'), 'w')
+    f.write('`ifndef COMMON_VH\n`define COMMON_VH\n')
+    f.write('`define COMMON_BYTE 8\n')
+    f.write('`define COMMON_MAX(a, b) ((a) > (b) ? (a) : (b))\n')
+    f.write('`endif\n')
+    f.close()
+
+
+def gen_includes(w, size, rng):
+    for index in range(INCLUDE_WIDTH):
+        w.line('`include "%s"' % header_name(0, index))
+    w.line()
+    unit = 0
+    while w.size < size:
+        w.line('module inc_%d (input [63:0] a, input [63:0] b, '
+               'output [63:0] y);' % unit)
+        for n in range(200):
+            level = rng.randrange(INCLUDE_DEPTH)
+            index = rng.randrange(INCLUDE_WIDTH)
+            w.line('  wire [`L%d_%d_W%d:0] w%d = `L%d_%d_ADD(a[%d], '
+                   '`COMMON_MAX(b[%d], `L%d_%d_SEL(a, %d)));'
+                   % (level, index, rng.randrange(16), n, level, index,
+                      rng.randrange(64), rng.randrange(64), level, index,
+                      rng.randrange(8)))
+        w.line('  assign y = w0;')
+        w.line('endmodule')
+        w.line()
+        unit += 1
+
+
+UVM_MACROS = r'''`define uvm_object_utils_begin(T) \
+  typedef uvm_object_registry #(T, `"T`") type_id; \
+  static function type_id get_type(); \
+    return type_id::get(); \
+  endfunction \
+  virtual function string get_type_name(); \
+    return `"T`"; \
+  endfunction \
+  function void __m_uvm_field_automation(uvm_object tmp_data__, \
+                                         int what__, string str__); \
+    T local_data__;
+
+`define uvm_object_utils_end \
+  endfunction
+
+`define uvm_field_int(ARG, FLAG) \
+  begin \
+    if (what__ == UVM_COPY && (FLAG & UVM_COPY)) \
+      ARG = local_data__.ARG; \
+    else if (what__ == UVM_COMPARE && (FLAG & UVM_COMPARE)) \
+      if (ARG !== local_data__.ARG) \
+        void'(comparer.compare_field(`"ARG`", ARG, local_data__.ARG, $bits(ARG))); \
+  end
+
+`define uvm_info(ID, MSG, VERBOSITY) \
+  begin \
+    if (uvm_report_enabled(VERBOSITY, UVM_INFO, ID)) \
+      uvm_report_info(ID, MSG, VERBOSITY, `__FILE__, `__LINE__); \
+  end
+
+`define uvm_error(ID, MSG) \
+  begin \
+    if (uvm_report_enabled(UVM_NONE, UVM_ERROR, ID)) \
+      uvm_report_error(ID, MSG, UVM_NONE, `__FILE__, `__LINE__); \
+  end
+'''
+
+
+def gen_uvm(w, size, rng):
+    for text in UVM_MACROS.split('\n'):
+        w.line(text)
+    unit = 0
+    while w.size < size:
+        name = 'pkt_%d' % unit
+        fields = rng.randrange(4, 24)
+        w.line('class %s extends uvm_sequence_item;' % name)
+        for f in range(fields):
+            w.line('  rand bit [%d:0] f%d;' % (rng.randrange(1, 64), f))
+        w.line('  `uvm_object_utils_begin(%s)' % name)
+        for f in range(fields):
+            w.line('    `uvm_field_int(f%d, UVM_ALL_ON)' % f)
+        w.line('  `uvm_object_utils_end')
+        w.line()
+        w.line('  function new(string name = "%s");' % name)
+        w.line('    super.new(name);')
+        w.line('  endfunction')
+        w.line()
+        w.line('  function void check();')
+        for f in range(fields):
+            w.line('    if (f%d == 0) `uvm_error("%s", "f%d is zero")'
+                   % (f, name.upper(), f))
+        w.line('    `uvm_info("%s", "checked", UVM_HIGH)' % name.upper())
+        w.line('  endfunction')
+        w.line('endclass')
+        w.line()
+        unit += 1
+
+
+def gen_wideports(w, size, rng):
+    unit = 0
+    while w.size < size:
+        ports = 4000
+        w.line('module wide_%d (' % unit)
+        for p in range(ports):
+            direction = 'input ' if p % 4 else 'output'
+            w.line('  %s wire [%d:0] p%d%s' % (direction, rng.randrange(64),
+                                             p, ',' if p + 1 < ports else ''))
+        w.line(');')
+        w.line('endmodule')
+        w.line()
+        w.line('module wide_top_%d (input [4095:0] bus, output [4095:0] q);'
+               % unit)
+        w.line('  wide_%d u (' % unit)
+        for p in range(ports):
+            net = 'q' if p % 4 == 0 else 'bus'
+            w.line('    .p%d(%s[%d])%s' % (p, net, p, ',' if p + 1 < ports
+                                           else ''))
+        w.line('  );')
+        w.line('endmodule')
+        w.line()
+        unit += 1
+
+
+def gen_casetables(w, size, rng):
+    unit = 0
+    while w.size < size:
+        w.line('module table_%d (input clk, input [11:0] sel, '
+               'output reg [15:0] y);' % unit)
+        w.line('  always @(posedge clk) begin')
+        w.line('    case (sel)')
+        for item in range(4096):
+            w.line("      12'h%03x: y <= 16'h%04x;" % (item,
+                                                    rng.randrange(1 << 16)))
+        w.line("      default: y <= 16'hxxxx;")
+        w.line('    endcase')
+        w.line('  end')
+        w.line('endmodule')
+        w.line()
+        unit += 1
+
+
+GENERATORS = {
+    'netlist': gen_netlist,
+    'includes': gen_includes,
+    'uvm': gen_uvm,
+    'wideports': gen_wideports,
+    'casetables': gen_casetables,
+}
+
+
+def main():
+    parser = optparse.OptionParser(usage='%prog [options] OUTDIR')
+    parser.add_option('-s', '--sizes', default='1M,8M',
+                      help='comma separated sizes of each input '
+                           '[default: %default]')
+    parser.add_option('-k', '--kinds', default=','.join(KINDS),
+                      help='comma separated corpus kinds [default: %default]')
+    parser.add_option('--seed', type='int', default=1,
+                      help='random seed [default: %default]')
+    opts, args = parser.parse_args()
+    if len(args) != 1:
+        parser.error('expected the output directory')
+
+    outdir = os.path.abspath(args[0])
+    kinds = [k for k in opts.kinds.split(',') if k]
+    for kind in kinds:
+        if kind not in GENERATORS:
+            parser.error('unknown corpus kind: %s' % kind)
+    sizes = [parse_size(s) for s in opts.sizes.split(',') if s]
+
+    if not os.path.isdir(outdir):
+        os.makedirs(outdir)
+    incdir = os.path.join(outdir, 'inc')
+    gen_include_headers(incdir)
+
+    inputs = []
+    for size in sizes:
+        for kind in kinds:
+            path = os.path.join(outdir, '%s-%s.sv' % (kind, size_name(size)))
+            rng = random.Random(opts.seed * 1000003 + KINDS.index(kind) * 7919
+                                + size)
+            f = open(path, 'w')
+            GENERATORS[kind](Writer(f), size, rng)
+            f.close()
+            inputs.append(path)
+
+    rsp = open(os.path.join(outdir, 'corpus.rsp'), 'w')
+    rsp.write('-I %s\n' % incdir)
+    for path in inputs:
+        rsp.write('%s\n' % path)
+    rsp.close()
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())